@@ -223,7 +223,8 @@ download_and_manage_libraries() {
         "https://github.com/nothings/stb.git" \
         "${LIBS_DIR}/stb" \
         "master" \
-        "stb_image.h"
+        "stb_image.h" \
+        "stb_image_write.h"
     
     # Verify final library structure
     log_info "Verifying final library structure..."
@@ -235,6 +236,7 @@ download_and_manage_libraries() {
         "${LIBS_DIR}/imgui_backends/imgui_impl_opengl3.h"
         "${LIBS_DIR}/imgui_backends/imgui_impl_opengl3.cpp"
         "${LIBS_DIR}/stb/stb_image.h"
+        "${LIBS_DIR}/stb/stb_image_write.h"
     )
     
     local missing_libs=()
@@ -434,30 +436,30 @@ cleanup_library_folders() {
         log_success "ImGui backends folder cleaned - kept only GLFW and OpenGL3"
     fi
     
-    # Clean up stb folder - keep only stb_image.h
+    # Clean up stb folder - keep only stb_image.h and stb_image_write.h
     if [ -d "${LIBS_DIR}/stb" ]; then
         log_info "Cleaning stb folder..."
         
-        # Remove all files except stb_image.h
-        find "${LIBS_DIR}/stb" -type f ! -name "stb_image.h" -delete
+        # Remove all files except stb_image.h and stb_image_write.h
+        find "${LIBS_DIR}/stb" -type f ! -name "stb_image.h" ! -name "stb_image_write.h" -delete
         
         # Remove all directories (including .git)
         find "${LIBS_DIR}/stb" -type d -mindepth 1 -delete
         
-        # Remove any remaining hidden files except stb_image.h
-        find "${LIBS_DIR}/stb" -type f ! -name "stb_image.h" -delete
+        # Remove any remaining hidden files except stb_image.h and stb_image_write.h
+        find "${LIBS_DIR}/stb" -type f ! -name "stb_image.h" ! -name "stb_image_write.h" -delete
         
-        # Verify stb_image.h still exists
-        if [ ! -f "${LIBS_DIR}/stb/stb_image.h" ]; then
-            log_error "stb_image.h missing after cleanup"
+        # Verify stb_image.h and stb_image_write.h still exist
+        if [ ! -f "${LIBS_DIR}/stb/stb_image.h" ] || [ ! -f "${LIBS_DIR}/stb/stb_image_write.h" ]; then
+            log_error "stb_image.h or stb_image_write.h missing after cleanup"
             exit 1
         fi
         
-        # Verify folder is clean (should only contain stb_image.h)
+        # Verify folder is clean (should only contain stb_image.h and stb_image_write.h)
         local stb_file_count
         stb_file_count=$(find "${LIBS_DIR}/stb" -type f | wc -l)
-        if [ "$stb_file_count" -ne 1 ]; then
-            log_warning "stb folder contains ${stb_file_count} files (expected 1)"
+        if [ "$stb_file_count" -ne 2 ]; then
+            log_warning "stb folder contains ${stb_file_count} files (expected 2)"
         fi
         
         # Remove any hidden files that might remain
@@ -466,7 +468,7 @@ cleanup_library_folders() {
         # Remove any other non-essential files (like .md, .txt, etc.)
         find "${LIBS_DIR}/stb" -type f \( -name "*.md" -o -name "*.txt" -o -name "*.rst" -o -name "*.yml" -o -name "*.yaml" -o -name "*.json" -o -name "*.xml" -o -name "*.html" -o -name "*.css" -o -name "*.js" \) -delete
         
-        log_success "stb folder cleaned - kept only stb_image.h"
+        log_success "stb folder cleaned - kept only stb_image.h and stb_image_write.h"
     fi
     
     # Final verification - check that all folders are clean
@@ -0,0 +1,250 @@
+#include "batch_convert.h"
+#include "cpu_dispatch.h"
+#include "decoded_cache.h"
+#include "image_files.h"
+#include "image_ops.h"
+#include "logger.h"
+#include "thread_pool.h"
+
+#include "stb_image_write.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+enum BatchStage { STAGE_READ, STAGE_DECODE, STAGE_RESIZE, STAGE_ENCODE, STAGE_WRITE, STAGE_COUNT };
+static const char* STAGE_NAMES[STAGE_COUNT] = { "read", "decode", "resize", "encode", "write" };
+
+// One file on its way through the stages, each stage frees what the next ones no longer need
+struct BatchItem {
+    size_t index = 0;
+    std::vector<unsigned char> file;
+    std::shared_ptr<DecodedImage> image;
+    std::vector<unsigned char> encoded;
+};
+
+struct BatchPipeline {
+    const BatchConvertOptions* options = nullptr;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::unique_ptr<BatchItem>> queues[STAGE_COUNT];    // items ready for each stage, STAGE_READ unused
+    size_t next_file = 0;
+    size_t in_flight = 0;
+    size_t max_in_flight = 0;
+    size_t finished = 0;
+
+    std::atomic<uint64_t> busy_us[STAGE_COUNT] = {};
+    std::atomic<int> stage_items[STAGE_COUNT] = {};
+    std::atomic<int> failures{0};
+    std::atomic<uint64_t> input_bytes{0};
+    std::atomic<uint64_t> decoded_bytes{0};
+    std::atomic<uint64_t> output_bytes{0};
+};
+
+
+static void AppendToVector(void* context, void* data, int size) {
+    std::vector<unsigned char>* out = (std::vector<unsigned char>*)context;
+    out->insert(out->end(), (unsigned char*)data, (unsigned char*)data + size);
+}
+
+// Caller holds the mutex. Later stages first so finished work leaves memory before new files are read.
+static int NextStage(const BatchPipeline& pipeline) {
+    for (int stage = STAGE_COUNT - 1; stage > STAGE_READ; stage--) {
+        if (!pipeline.queues[stage].empty()) return stage;
+    }
+    if (pipeline.next_file < pipeline.inputs.size() && pipeline.in_flight < pipeline.max_in_flight) return STAGE_READ;
+    return -1;
+}
+
+// False when the file cannot go on, the reason is logged
+static bool RunStage(BatchPipeline& pipeline, int stage, BatchItem& item) {
+    const std::string& input = pipeline.inputs[item.index];
+    std::string error;
+    switch (stage) {
+    case STAGE_READ:
+        if (!ReadImageFile(input, item.file, error)) {
+            LOG_ERROR("batch", "Failed to read image: %s (%s)", input.c_str(), error.c_str());
+            return false;
+        }
+        pipeline.input_bytes += item.file.size();
+        return true;
+
+    case STAGE_DECODE:
+        item.image = DecodeImage(item.file.data(), item.file.size(), error);
+        std::vector<unsigned char>().swap(item.file);
+        if (!item.image) {
+            LOG_ERROR("batch", "Failed to load image: %s (%s)", input.c_str(), error.c_str());
+            return false;
+        }
+        pipeline.decoded_bytes += item.image->Size();
+        return true;
+
+    case STAGE_RESIZE: {
+        int width, height;
+        FitInside(item.image->width, item.image->height, pipeline.options->max_size, width, height);
+        if (width == item.image->width && height == item.image->height) return true;
+        auto resized = std::make_shared<DecodedImage>();
+        resized->width = width;
+        resized->height = height;
+        resized->pixels = (unsigned char*)malloc(resized->Size());
+        if (!resized->pixels) {
+            LOG_ERROR("batch", "Out of memory resizing %s to %dx%d", input.c_str(), width, height);
+            return false;
+        }
+        DownscaleBox(item.image->pixels, item.image->width, item.image->height, resized->pixels, width, height);
+        item.image = std::move(resized);
+        return true;
+    }
+
+    case STAGE_ENCODE: {
+        const DecodedImage& image = *item.image;
+        bool encoded = pipeline.options->format == "png"
+            ? stbi_write_png_to_func(AppendToVector, &item.encoded, image.width, image.height, 4, image.pixels, image.width * 4) != 0
+            : stbi_write_jpg_to_func(AppendToVector, &item.encoded, image.width, image.height, 4, image.pixels, pipeline.options->quality) != 0;
+        item.image.reset();
+        if (!encoded) {
+            LOG_ERROR("batch", "Failed to encode %s", input.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    case STAGE_WRITE: {
+        const std::string& output = pipeline.outputs[item.index];
+        FILE* file = fopen(output.c_str(), "wb");
+        bool written = file && fwrite(item.encoded.data(), 1, item.encoded.size(), file) == item.encoded.size();
+        if (file && fclose(file) != 0) written = false;
+        if (!written) {
+            LOG_ERROR("batch", "Failed to write %s (%s)", output.c_str(), strerror(errno));
+            return false;
+        }
+        pipeline.output_bytes += item.encoded.size();
+        return true;
+    }
+    }
+    return false;
+}
+
+static void WorkerLoop(BatchPipeline& pipeline) {
+    for (;;) {
+        std::unique_ptr<BatchItem> item;
+        int stage = -1;
+        {
+            std::unique_lock<std::mutex> lock(pipeline.mutex);
+            pipeline.cv.wait(lock, [&] {
+                stage = NextStage(pipeline);
+                return stage >= 0 || pipeline.finished == pipeline.inputs.size();
+            });
+            if (stage < 0) return;
+            if (stage == STAGE_READ) {
+                item = std::make_unique<BatchItem>();
+                item->index = pipeline.next_file++;
+                pipeline.in_flight++;
+            } else {
+                item = std::move(pipeline.queues[stage].front());
+                pipeline.queues[stage].pop_front();
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = RunStage(pipeline, stage, *item);
+        pipeline.busy_us[stage] += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        pipeline.stage_items[stage]++;
+
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            if (ok && stage + 1 < STAGE_COUNT) {
+                pipeline.queues[stage + 1].push_back(std::move(item));
+            } else {
+                if (!ok) pipeline.failures++;
+                pipeline.in_flight--;
+                pipeline.finished++;
+            }
+        }
+        pipeline.cv.notify_all();
+    }
+}
+
+int RunBatchConvert(const BatchConvertOptions& options) {
+    if (options.format != "jpg" && options.format != "png") {
+        LOG_ERROR("batch", "Unknown format %s, expected jpg or png", options.format.c_str());
+        return 1;
+    }
+    if (options.max_size <= 0 || options.quality < 1 || options.quality > 100) {
+        LOG_ERROR("batch", "Invalid --max-size %d or --quality %d", options.max_size, options.quality);
+        return 1;
+    }
+
+    BatchPipeline pipeline;
+    pipeline.options = &options;
+    pipeline.inputs = GetImageFiles(options.input);
+    if (pipeline.inputs.empty()) {
+        LOG_ERROR("batch", "No images in %s", options.input.c_str());
+        return 1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(options.output, error);
+    if (error) {
+        LOG_ERROR("batch", "Cannot create %s (%s)", options.output.c_str(), error.message().c_str());
+        return 1;
+    }
+
+    // Sorted so names that collide (a.png and a.jpg both giving a.jpg) resolve the same way on every run
+    std::sort(pipeline.inputs.begin(), pipeline.inputs.end());
+    std::set<std::string> names;
+    for (const std::string& input : pipeline.inputs) {
+        std::filesystem::path path(input);
+        std::string name = path.stem().string() + "." + options.format;
+        if (!names.insert(name).second) {
+            name = path.stem().string() + "_" + path.extension().string().substr(1) + "." + options.format;
+            names.insert(name);
+        }
+        pipeline.outputs.push_back((std::filesystem::path(options.output) / name).string());
+    }
+
+    size_t threads = options.threads > 0 ? (size_t)options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 4;
+    pipeline.max_in_flight = threads * 2;
+
+    // The calling thread is one of the workers
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads > 1 ? threads - 1 : 1);
+        pool.ParallelFor((int)threads, [&](int) { WorkerLoop(pipeline); });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int converted = (int)pipeline.inputs.size() - pipeline.failures;
+    double thread_us = seconds * 1e6 * threads;
+    printf("batch convert: %d of %zu files in %.2f s on %zu threads (%s kernels), %.1f files/s, %.1f MB/s decoded, %.1f MB in, %.1f MB out\n",
+           converted, pipeline.inputs.size(), seconds, threads, CpuDispatch_LevelName(CpuDispatch_Kernels().level),
+           seconds > 0.0 ? converted / seconds : 0.0, seconds > 0.0 ? pipeline.decoded_bytes / 1e6 / seconds : 0.0,
+           pipeline.input_bytes / 1e6, pipeline.output_bytes / 1e6);
+    printf("%-8s %10s %12s %12s\n", "stage", "busy s", "ms per file", "utilization");
+    double busy_total_us = 0.0;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        double busy_us = (double)pipeline.busy_us[stage];
+        int items = pipeline.stage_items[stage];
+        busy_total_us += busy_us;
+        printf("%-8s %10.2f %12.3f %11.1f%%\n", STAGE_NAMES[stage], busy_us / 1e6,
+               items > 0 ? busy_us / 1e3 / items : 0.0, thread_us > 0.0 ? 100.0 * busy_us / thread_us : 0.0);
+    }
+    printf("%-8s %10.2f %12s %11.1f%%\n", "idle", std::max(0.0, thread_us - busy_total_us) / 1e6, "",
+           thread_us > 0.0 ? 100.0 * std::max(0.0, thread_us - busy_total_us) / thread_us : 0.0);
+    return pipeline.failures ? 1 : 0;
+}
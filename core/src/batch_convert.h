@@ -0,0 +1,28 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Batch conversion of a folder to downscaled JPEG or PNG files, no window or GL
+    Every file goes through read -> decode -> resize -> encode -> write. All threads share one
+    scheduler and take the most advanced stage that has work, so files in flight stay few
+    (bounded memory) while whichever stage is the bottleneck gets every core.
+    Decode and resize are the viewer's: EXIF orientation applied, box filter with the selected
+    pixel kernels. Pixels are written as encoded, embedded ICC profiles are not carried over.
+*/
+
+#pragma once
+
+#include <string>
+
+
+struct BatchConvertOptions {
+    std::string input;          // folder scanned like the viewer's, not recursive
+    std::string output;         // created when missing, files keep their name with the new extension
+    int max_size = 2048;        // longest side, smaller images keep their size
+    std::string format = "jpg"; // jpg (alpha dropped) or png
+    int quality = 90;           // JPEG quality 1-100
+    int threads = 0;            // 0 picks one per hardware thread
+};
+
+// Converts every image of options.input, then prints the throughput and how busy each stage kept
+// the threads. Returns 0 when every file was converted.
+int RunBatchConvert(const BatchConvertOptions& options);
@@ -0,0 +1,109 @@
+#include "cache_prebuild.h"
+#include "decoded_cache.h"
+#include "image_files.h"
+#include "image_ops.h"
+#include "logger.h"
+#include "preview_store.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+
+// Idle I/O class: the disk is only used when nobody else wants it. The setting is per thread.
+static void LowerIoPriority() {
+    static thread_local bool lowered = false;
+    if (lowered) return;
+    lowered = true;
+#if defined(__linux__)
+    const int IOPRIO_WHO_PROCESS = 1, IOPRIO_CLASS_IDLE = 3, IOPRIO_CLASS_SHIFT = 13;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+        LOG_WARNING("prebuild", "Could not lower the I/O priority");
+    }
+#elif defined(__APPLE__)
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, IOPOL_THROTTLE);
+#elif defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+}
+
+int RunCachePrebuild(const std::string& directory, const PreviewStore& store, int threads) {
+    if (!store.Enabled()) {
+        LOG_ERROR("prebuild", "No preview cache directory, nothing to prebuild");
+        return 1;
+    }
+    std::vector<std::string> files = GetImageFilesRecursive(directory);
+    if (files.empty()) {
+        LOG_ERROR("prebuild", "No images in %s", directory.c_str());
+        return 1;
+    }
+    store.RemoveStaleTemporaries();
+
+    std::atomic<int> generated{0}, skipped{0}, failed{0};
+    std::atomic<uint64_t> read_bytes{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        size_t thread_count = threads > 0 ? (size_t)threads : std::thread::hardware_concurrency();
+        if (thread_count == 0) thread_count = 4;
+        ThreadPool pool(thread_count > 1 ? thread_count - 1 : 1);
+        pool.ParallelFor((int)files.size(), [&](int i) {
+            LowerIoPriority();
+            const std::string& path = files[i];
+            bool need_thumbnail = !store.Contains(path, THUMBNAIL_SIZE);
+            bool need_preview = !store.Contains(path, PREVIEW_SIZE);
+            if (!need_thumbnail && !need_preview) {
+                skipped++;
+                return;
+            }
+
+            std::vector<unsigned char> data;
+            std::string error;
+            std::shared_ptr<DecodedImage> image;
+            if (ReadImageFile(path, data, error)) {
+                read_bytes += data.size();
+                image = DecodeImage(data.data(), data.size(), error);
+            }
+            if (!image) {
+                LOG_ERROR("prebuild", "Failed to load image: %s (%s)", path.c_str(), error.c_str());
+                failed++;
+                return;
+            }
+
+            // The thumbnail is taken from the preview, a fraction of the full image's pixels
+            int preview_width, preview_height;
+            FitInside(image->width, image->height, PREVIEW_SIZE, preview_width, preview_height);
+            std::vector<unsigned char> preview((size_t)preview_width * preview_height * 4);
+            DownscaleBox(image->pixels, image->width, image->height, preview.data(), preview_width, preview_height);
+            image.reset();
+            if (need_preview) store.Save(path, preview.data(), preview_width, preview_height, PREVIEW_SIZE);
+            if (need_thumbnail) {
+                int thumbnail_width, thumbnail_height;
+                FitInside(preview_width, preview_height, THUMBNAIL_SIZE, thumbnail_width, thumbnail_height);
+                std::vector<unsigned char> thumbnail((size_t)thumbnail_width * thumbnail_height * 4);
+                DownscaleBox(preview.data(), preview_width, preview_height, thumbnail.data(), thumbnail_width, thumbnail_height);
+                store.Save(path, thumbnail.data(), thumbnail_width, thumbnail_height, THUMBNAIL_SIZE);
+            }
+            generated++;
+        });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("prebuild cache: %zu files in %s, %d generated, %d already cached, %d failed in %.2f s (%.1f files/s, %.1f MB/s read)\n",
+           files.size(), directory.c_str(), generated.load(), skipped.load(), failed.load(), seconds,
+           seconds > 0.0 ? generated / seconds : 0.0, seconds > 0.0 ? read_bytes / 1e6 / seconds : 0.0);
+    return failed ? 1 : 0;
+}
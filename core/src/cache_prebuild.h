@@ -0,0 +1,19 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Offline fill of the preview store, meant for cron after a delivery lands
+    Walks a folder tree and writes the thumbnail and mid-resolution preview of every image the
+    store lacks, on all cores with the threads in the idle I/O class. Entries are keyed by path,
+    size and mtime and written atomically, so an interrupted run simply resumes where it stopped
+    and edited files are redone.
+*/
+
+#pragma once
+
+#include <string>
+
+class PreviewStore;
+
+
+// Prints what was generated, skipped and failed with the throughput. Returns 0 when no file failed.
+int RunCachePrebuild(const std::string& directory, const PreviewStore& store, int threads = 0);
@@ -0,0 +1,122 @@
+#include "codec_bench.h"
+#include "content_hash.h"
+#include "cpu_dispatch.h"
+#include "image_files.h"
+#include "image_ops.h"
+#include "logger.h"
+#include "qoi_codec.h"
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+
+static void AppendToVector(void* context, void* data, int size) {
+    std::vector<unsigned char>* out = (std::vector<unsigned char>*)context;
+    out->insert(out->end(), (unsigned char*)data, (unsigned char*)data + size);
+}
+
+int RunCodecBenchmark(const std::string& directory) {
+    std::vector<std::string> files = GetImageFiles(directory);
+    if (files.empty()) {
+        LOG_ERROR("bench", "No images in %s", directory.c_str());
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto seconds = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+    auto mb_per_s = [](double bytes, double s) { return s > 0.0 ? bytes / 1e6 / s : 0.0; };
+
+    double raw_total = 0, png_total = 0, qoi_total = 0;
+    double png_encode_total = 0, png_decode_total = 0, qoi_encode_total = 0, qoi_decode_total = 0;
+    double downscale_total = 0, hash_total = 0;
+    int failures = 0;
+
+    printf("%-40s %11s | %21s %8s | %21s %8s\n", "file", "size", "PNG enc/dec MB/s", "ratio", "QOI enc/dec MB/s", "ratio");
+    for (const std::string& path : files) {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            LOG_ERROR("bench", "Failed to load image: %s", path.c_str());
+            failures++;
+            continue;
+        }
+        double raw_bytes = (double)width * height * 4;
+
+        std::vector<unsigned char> png;
+        auto start = Clock::now();
+        stbi_write_png_to_func(AppendToVector, &png, width, height, 4, pixels, width * 4);
+        double png_encode = seconds(start);
+
+        start = Clock::now();
+        int w, h, c;
+        unsigned char* png_pixels = stbi_load_from_memory(png.data(), (int)png.size(), &w, &h, &c, 4);
+        double png_decode = seconds(start);
+        stbi_image_free(png_pixels);
+
+        std::vector<unsigned char> qoi;
+        start = Clock::now();
+        QOI_Encode(pixels, width, height, qoi);
+        double qoi_encode = seconds(start);
+
+        std::vector<unsigned char> qoi_pixels((size_t)raw_bytes);
+        start = Clock::now();
+        bool qoi_ok = QOI_Decode(qoi.data(), qoi.size(), qoi_pixels.data(), width, height);
+        double qoi_decode = seconds(start);
+        if (!qoi_ok || memcmp(qoi_pixels.data(), pixels, qoi_pixels.size()) != 0) {
+            LOG_ERROR("bench", "QOI round trip mismatch: %s", path.c_str());
+            failures++;
+        }
+
+        int thumbnail_width, thumbnail_height;
+        FitInside(width, height, THUMBNAIL_SIZE, thumbnail_width, thumbnail_height);
+        std::vector<unsigned char> thumbnail((size_t)thumbnail_width * thumbnail_height * 4);
+        std::vector<unsigned char> reference(thumbnail.size());
+        start = Clock::now();
+        DownscaleBox(pixels, width, height, thumbnail.data(), thumbnail_width, thumbnail_height);
+        downscale_total += seconds(start);
+        DownscaleBox_Scalar(pixels, width, height, reference.data(), thumbnail_width, thumbnail_height);
+        if (thumbnail != reference) {
+            LOG_ERROR("bench", "%s downscale differs from scalar: %s", CpuDispatch_LevelName(CpuDispatch_Kernels().level), path.c_str());
+            failures++;
+        }
+
+        start = Clock::now();
+        uint64_t hash = ContentHash(pixels, (size_t)raw_bytes);
+        hash_total += seconds(start);
+        if (hash != ContentHash_Scalar(pixels, (size_t)raw_bytes)) {
+            LOG_ERROR("bench", "%s content hash differs from scalar: %s", CpuDispatch_LevelName(CpuDispatch_Kernels().level), path.c_str());
+            failures++;
+        }
+        stbi_image_free(pixels);
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", width, height);
+        printf("%-40s %11s | %9.1f / %9.1f %8.3f | %9.1f / %9.1f %8.3f\n",
+               std::filesystem::path(path).filename().string().c_str(), size,
+               mb_per_s(raw_bytes, png_encode), mb_per_s(raw_bytes, png_decode), png.size() / raw_bytes,
+               mb_per_s(raw_bytes, qoi_encode), mb_per_s(raw_bytes, qoi_decode), qoi.size() / raw_bytes);
+
+        raw_total += raw_bytes;
+        png_total += png.size();
+        qoi_total += qoi.size();
+        png_encode_total += png_encode;
+        png_decode_total += png_decode;
+        qoi_encode_total += qoi_encode;
+        qoi_decode_total += qoi_decode;
+    }
+
+    printf("%-40s %11.1f | %9.1f / %9.1f %8.3f | %9.1f / %9.1f %8.3f\n", "total (MB raw)", raw_total / 1e6,
+           mb_per_s(raw_total, png_encode_total), mb_per_s(raw_total, png_decode_total), raw_total > 0 ? png_total / raw_total : 0.0,
+           mb_per_s(raw_total, qoi_encode_total), mb_per_s(raw_total, qoi_decode_total), raw_total > 0 ? qoi_total / raw_total : 0.0);
+    printf("thumbnail downscale (%s kernels): %.1f MB/s\n", CpuDispatch_LevelName(CpuDispatch_Kernels().level),
+           mb_per_s(raw_total, downscale_total));
+    printf("content hash (%s kernels): %.1f MB/s\n", CpuDispatch_LevelName(CpuDispatch_Kernels().level),
+           mb_per_s(raw_total, hash_total));
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Codec and pixel kernel benchmark over a folder of images
+    Shared by the app's --bench-codec and the imgui_app_bench executable.
+*/
+
+#pragma once
+
+#include <string>
+
+
+// Encodes and decodes every image of directory with stb_image's PNG path and with QOI,
+// reporting throughput against the raw RGBA size and the compression ratio. Also times the
+// thumbnail downscale with the selected pixel kernels and checks them against the scalar ones.
+// Returns 0 when every image round-trips.
+int RunCodecBenchmark(const std::string& directory);
@@ -0,0 +1,258 @@
+#include "content_hash.h"
+#include "cpu_dispatch.h"
+#include "decoded_cache.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static const uint64_t PRIME32_1 = 0x9E3779B1U;
+static const uint64_t PRIME32_2 = 0x85EBCA77U;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+alignas(64) static const unsigned char SECRET[CONTENT_HASH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+
+static inline uint64_t Read64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Swap64(uint64_t x) {
+    return ((x << 56) & 0xff00000000000000ULL) | ((x << 40) & 0x00ff000000000000ULL) |
+           ((x << 24) & 0x0000ff0000000000ULL) | ((x << 8) & 0x000000ff00000000ULL) |
+           ((x >> 8) & 0x00000000ff000000ULL) | ((x >> 24) & 0x0000000000ff0000ULL) |
+           ((x >> 40) & 0x000000000000ff00ULL) | ((x >> 56) & 0x00000000000000ffULL);
+}
+
+// Low and high halves of the 128-bit product xor'd together
+static inline uint64_t Mul128Fold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static inline uint64_t XXH64Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t Avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t Mix16(const unsigned char* input, const unsigned char* secret) {
+    return Mul128Fold64(Read64(input) ^ Read64(secret), Read64(input + 8) ^ Read64(secret + 8));
+}
+
+static uint64_t Hash0To16(const unsigned char* input, size_t size) {
+    if (size > 8) {
+        uint64_t low = Read64(input) ^ (Read64(SECRET + 24) ^ Read64(SECRET + 32));
+        uint64_t high = Read64(input + size - 8) ^ (Read64(SECRET + 40) ^ Read64(SECRET + 48));
+        return Avalanche(size + Swap64(low) + high + Mul128Fold64(low, high));
+    }
+    if (size >= 4) {
+        uint64_t combined = Read32(input + size - 4) + ((uint64_t)Read32(input) << 32);
+        uint64_t h = combined ^ (Read64(SECRET + 8) ^ Read64(SECRET + 16));
+        h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+        h *= PRIME_MX2;
+        h ^= (h >> 35) + size;
+        h *= PRIME_MX2;
+        return h ^ (h >> 28);
+    }
+    if (size > 0) {
+        uint32_t combined = ((uint32_t)input[0] << 16) | ((uint32_t)input[size >> 1] << 24) | input[size - 1] | ((uint32_t)size << 8);
+        return XXH64Avalanche(combined ^ (uint64_t)(Read32(SECRET) ^ Read32(SECRET + 4)));
+    }
+    return XXH64Avalanche(Read64(SECRET + 56) ^ Read64(SECRET + 64));
+}
+
+static uint64_t Hash17To128(const unsigned char* input, size_t size) {
+    uint64_t acc = size * PRIME64_1;
+    if (size > 32) {
+        if (size > 64) {
+            if (size > 96) {
+                acc += Mix16(input + 48, SECRET + 96);
+                acc += Mix16(input + size - 64, SECRET + 112);
+            }
+            acc += Mix16(input + 32, SECRET + 64);
+            acc += Mix16(input + size - 48, SECRET + 80);
+        }
+        acc += Mix16(input + 16, SECRET + 32);
+        acc += Mix16(input + size - 32, SECRET + 48);
+    }
+    acc += Mix16(input, SECRET);
+    acc += Mix16(input + size - 16, SECRET + 16);
+    return Avalanche(acc);
+}
+
+static uint64_t Hash129To240(const unsigned char* input, size_t size) {
+    uint64_t acc = size * PRIME64_1;
+    int rounds = (int)size / 16;
+    for (int i = 0; i < 8; i++) {
+        acc += Mix16(input + 16 * i, SECRET + 16 * i);
+    }
+    acc = Avalanche(acc);
+    for (int i = 8; i < rounds; i++) {
+        acc += Mix16(input + 16 * i, SECRET + 16 * (i - 8) + 3);
+    }
+    acc += Mix16(input + size - 16, SECRET + 136 - 17);
+    return Avalanche(acc);
+}
+
+typedef void (*AccumulateFn)(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+
+static uint64_t HashLong(const unsigned char* input, size_t size, AccumulateFn accumulate) {
+    uint64_t acc[8] = { PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1 };
+    accumulate(acc, input, size, SECRET);
+
+    uint64_t result = size * PRIME64_1;
+    for (int i = 0; i < 4; i++) {
+        result += Mul128Fold64(acc[2 * i] ^ Read64(SECRET + 11 + 16 * i), acc[2 * i + 1] ^ Read64(SECRET + 11 + 16 * i + 8));
+    }
+    return Avalanche(result);
+}
+
+
+uint64_t ContentHash(const void* data, size_t size) {
+    const unsigned char* input = (const unsigned char*)data;
+    if (size <= 16) return Hash0To16(input, size);
+    if (size <= 128) return Hash17To128(input, size);
+    if (size <= 240) return Hash129To240(input, size);
+    return HashLong(input, size, CpuDispatch_Kernels().hash_accumulate);
+}
+
+uint64_t ContentHash_Scalar(const void* data, size_t size) {
+    const unsigned char* input = (const unsigned char*)data;
+    if (size <= 240) return ContentHash(data, size);
+    return HashLong(input, size, ContentHash_Accumulate_Scalar);
+}
+
+// One 64 byte stripe: every lane adds its neighbour's input and the 32x32 bit product of its keyed halves
+static inline void Accumulate512(uint64_t* acc, const unsigned char* input, const unsigned char* secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t data = Read64(input + 8 * i);
+        uint64_t keyed = data ^ Read64(secret + 8 * i);
+        acc[i ^ 1] += data;
+        acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+    }
+}
+
+static inline void Scramble(uint64_t* acc, const unsigned char* secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= Read64(secret + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+void ContentHash_Accumulate_Scalar(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret) {
+    const size_t stripes_per_block = (CONTENT_HASH_SECRET_SIZE - 64) / 8;
+    const size_t block_size = 64 * stripes_per_block;
+    const size_t blocks = (size - 1) / block_size;
+    for (size_t b = 0; b < blocks; b++) {
+        for (size_t s = 0; s < stripes_per_block; s++) {
+            Accumulate512(acc, input + b * block_size + s * 64, secret + s * 8);
+        }
+        Scramble(acc, secret + CONTENT_HASH_SECRET_SIZE - 64);
+    }
+    const size_t stripes = ((size - 1) - block_size * blocks) / 64;
+    for (size_t s = 0; s < stripes; s++) {
+        Accumulate512(acc, input + blocks * block_size + s * 64, secret + s * 8);
+    }
+    Accumulate512(acc, input + size - 64, secret + CONTENT_HASH_SECRET_SIZE - 64 - 7);
+}
+
+
+bool ContentHash_File(const std::string& path, uint64_t& hash, std::string& error) {
+#if !defined(_WIN32)
+    // Mapped rather than read, the pages come straight from the page cache without a copy
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = strerror(errno);
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    if (size == 0) {
+        close(fd);
+        hash = ContentHash(nullptr, 0);
+        return true;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = strerror(errno);
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    hash = ContentHash(mapped, size);
+    munmap(mapped, size);
+    return true;
+#else
+    std::vector<unsigned char> data;
+    if (!ReadImageFile(path, data, error)) return false;
+    hash = ContentHash(data.data(), data.size());
+    return true;
+#endif
+}
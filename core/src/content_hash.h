@@ -0,0 +1,35 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Content hashing of image files
+    XXH3 64-bit with seed 0, the same values as xxhsum -H3 / XXH3_64bits() on little-endian hosts.
+    Inputs over 240 bytes run the stripe loop picked by CpuDispatch_Kernels(), which reads
+    memory faster than any disk can deliver; files are hashed through mmap where available.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+uint64_t ContentHash(const void* data, size_t size);
+
+// ContentHash on the scalar loop whatever the CPU, the reference the benchmark checks against
+uint64_t ContentHash_Scalar(const void* data, size_t size);
+
+// Hash of a file's bytes, false with the reason in error when it cannot be read
+bool ContentHash_File(const std::string& path, uint64_t& hash, std::string& error);
+
+
+// Size of XXH3's default secret, the key material of the long input loop
+constexpr size_t CONTENT_HASH_SECRET_SIZE = 192;
+
+// Per instruction set variants of the long input loop for size > 240, all give the same 8 accumulators
+// (acc holds the initial ones). The SIMD ones (content_hash_simd.cpp) do two to eight lanes per instruction.
+void ContentHash_Accumulate_Scalar(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+void ContentHash_Accumulate_SSE2(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+void ContentHash_Accumulate_AVX2(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+void ContentHash_Accumulate_AVX512(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+void ContentHash_Accumulate_NEON(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
@@ -0,0 +1,149 @@
+#include "content_hash.h"
+#include "cpu_dispatch.h"
+
+#include <cstdint>
+
+#if defined(CPU_DISPATCH_X86)
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(CPU_DISPATCH_NEON)
+#include <arm_neon.h>
+#endif
+
+
+// Same walk as the scalar loop: 16 stripes of 64 bytes per block, each keyed by the secret moved
+// on 8 bytes, a scramble after every block, then the partial block and the last 64 bytes.
+// ACCUMULATE(lanes, input, secret) and SCRAMBLE(lanes, secret) are the variant's stripe functions.
+#define CONTENT_HASH_LONG_LOOP(ACCUMULATE, SCRAMBLE, lanes)                                           \
+    const size_t stripes_per_block = (CONTENT_HASH_SECRET_SIZE - 64) / 8;                              \
+    const size_t block_size = 64 * stripes_per_block;                                                  \
+    const size_t blocks = (size - 1) / block_size;                                                     \
+    for (size_t b = 0; b < blocks; b++) {                                                              \
+        for (size_t s = 0; s < stripes_per_block; s++) {                                               \
+            ACCUMULATE(lanes, input + b * block_size + s * 64, secret + s * 8);                        \
+        }                                                                                              \
+        SCRAMBLE(lanes, secret + CONTENT_HASH_SECRET_SIZE - 64);                                       \
+    }                                                                                                  \
+    const size_t stripes = ((size - 1) - block_size * blocks) / 64;                                    \
+    for (size_t s = 0; s < stripes; s++) {                                                             \
+        ACCUMULATE(lanes, input + blocks * block_size + s * 64, secret + s * 8);                       \
+    }                                                                                                  \
+    ACCUMULATE(lanes, input + size - 64, secret + CONTENT_HASH_SECRET_SIZE - 64 - 7)
+
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+
+
+#if defined(CPU_DISPATCH_X86)
+
+// SSE2 is part of x86-64, no target attribute needed. Four registers of two lanes.
+static inline void Accumulate_SSE2(__m128i* lanes, const unsigned char* input, const unsigned char* secret) {
+    for (int i = 0; i < 4; i++) {
+        __m128i data = _mm_loadu_si128((const __m128i*)input + i);
+        __m128i keyed = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret + i));
+        __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, swapped));
+    }
+}
+
+static inline void Scramble_SSE2(__m128i* lanes, const unsigned char* secret) {
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_xor_si128(lanes[i], _mm_srli_epi64(lanes[i], 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)secret + i));
+        __m128i low = _mm_mul_epu32(a, prime);
+        __m128i high = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        lanes[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+    }
+}
+
+void ContentHash_Accumulate_SSE2(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret) {
+    __m128i lanes[4];
+    for (int i = 0; i < 4; i++) lanes[i] = _mm_loadu_si128((const __m128i*)acc + i);
+    CONTENT_HASH_LONG_LOOP(Accumulate_SSE2, Scramble_SSE2, lanes);
+    for (int i = 0; i < 4; i++) _mm_storeu_si128((__m128i*)acc + i, lanes[i]);
+}
+
+// Two registers of four lanes. The shuffles stay within 128-bit halves, as the lane pairs do.
+TARGET_AVX2 static inline void Accumulate_AVX2(__m256i* lanes, const unsigned char* input, const unsigned char* secret) {
+    for (int i = 0; i < 2; i++) {
+        __m256i data = _mm256_loadu_si256((const __m256i*)input + i);
+        __m256i keyed = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret + i));
+        __m256i product = _mm256_mul_epu32(keyed, _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        lanes[i] = _mm256_add_epi64(lanes[i], _mm256_add_epi64(product, swapped));
+    }
+}
+
+TARGET_AVX2 static inline void Scramble_AVX2(__m256i* lanes, const unsigned char* secret) {
+    const __m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 2; i++) {
+        __m256i a = _mm256_xor_si256(lanes[i], _mm256_srli_epi64(lanes[i], 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)secret + i));
+        __m256i low = _mm256_mul_epu32(a, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        lanes[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+    }
+}
+
+TARGET_AVX2 void ContentHash_Accumulate_AVX2(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret) {
+    __m256i lanes[2];
+    for (int i = 0; i < 2; i++) lanes[i] = _mm256_loadu_si256((const __m256i*)acc + i);
+    CONTENT_HASH_LONG_LOOP(Accumulate_AVX2, Scramble_AVX2, lanes);
+    for (int i = 0; i < 2; i++) _mm256_storeu_si256((__m256i*)acc + i, lanes[i]);
+}
+
+// All eight lanes in one register
+TARGET_AVX512 static inline void Accumulate_AVX512(__m512i& lanes, const unsigned char* input, const unsigned char* secret) {
+    __m512i data = _mm512_loadu_si512(input);
+    __m512i keyed = _mm512_xor_si512(data, _mm512_loadu_si512(secret));
+    __m512i product = _mm512_mul_epu32(keyed, _mm512_shuffle_epi32(keyed, (_MM_PERM_ENUM)_MM_SHUFFLE(0, 3, 0, 1)));
+    __m512i swapped = _mm512_shuffle_epi32(data, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2));
+    lanes = _mm512_add_epi64(lanes, _mm512_add_epi64(product, swapped));
+}
+
+TARGET_AVX512 static inline void Scramble_AVX512(__m512i& lanes, const unsigned char* secret) {
+    const __m512i prime = _mm512_set1_epi32((int)PRIME32_1);
+    __m512i a = _mm512_xor_si512(lanes, _mm512_srli_epi64(lanes, 47));
+    a = _mm512_xor_si512(a, _mm512_loadu_si512(secret));
+    __m512i low = _mm512_mul_epu32(a, prime);
+    __m512i high = _mm512_mul_epu32(_mm512_shuffle_epi32(a, (_MM_PERM_ENUM)_MM_SHUFFLE(0, 3, 0, 1)), prime);
+    lanes = _mm512_add_epi64(low, _mm512_slli_epi64(high, 32));
+}
+
+TARGET_AVX512 void ContentHash_Accumulate_AVX512(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret) {
+    __m512i lanes = _mm512_loadu_si512(acc);
+    CONTENT_HASH_LONG_LOOP(Accumulate_AVX512, Scramble_AVX512, lanes);
+    _mm512_storeu_si512(acc, lanes);
+}
+
+#elif defined(CPU_DISPATCH_NEON)
+
+// Four registers of two lanes, the keyed halves split with narrowing moves
+static inline void Accumulate_NEON(uint64x2_t* lanes, const unsigned char* input, const unsigned char* secret) {
+    for (int i = 0; i < 4; i++) {
+        uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(input + 16 * i));
+        uint64x2_t keyed = veorq_u64(data, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        uint64x2_t product = vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+        lanes[i] = vaddq_u64(lanes[i], vaddq_u64(product, vextq_u64(data, data, 1)));
+    }
+}
+
+static inline void Scramble_NEON(uint64x2_t* lanes, const unsigned char* secret) {
+    for (int i = 0; i < 4; i++) {
+        uint64x2_t a = veorq_u64(lanes[i], vshrq_n_u64(lanes[i], 47));
+        a = veorq_u64(a, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        uint64x2_t high = vshlq_n_u64(vmull_n_u32(vshrn_n_u64(a, 32), PRIME32_1), 32);
+        lanes[i] = vmlal_n_u32(high, vmovn_u64(a), PRIME32_1);
+    }
+}
+
+void ContentHash_Accumulate_NEON(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret) {
+    uint64x2_t lanes[4];
+    for (int i = 0; i < 4; i++) lanes[i] = vld1q_u64(acc + 2 * i);
+    CONTENT_HASH_LONG_LOOP(Accumulate_NEON, Scramble_NEON, lanes);
+    for (int i = 0; i < 4; i++) vst1q_u64(acc + 2 * i, lanes[i]);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include "content_index.h"
+#include "content_hash.h"
+#include "logger.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+
+
+bool ContentIndex::Lookup(const std::string& path, uint64_t& hash, bool rehash) {
+    std::error_code error;
+    uint64_t size = (uint64_t)std::filesystem::file_size(path, error);
+    if (error) return false;
+    int64_t mtime = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (!rehash && it != entries.end() && it->second.size == size && it->second.mtime == mtime) {
+            hash = it->second.hash;
+            return true;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string reason;
+    if (!ContentHash_File(path, hash, reason)) {
+        LOG_WARNING("content", "Cannot hash %s (%s)", path.c_str(), reason.c_str());
+        return false;
+    }
+    stats.hash_us += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    stats.files++;
+    stats.bytes += size;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = entries.try_emplace(path);
+    if (!inserted && --paths_per_hash[it->second.hash] > 0) stats.duplicates--;
+    it->second = Entry{ hash, size, mtime };
+    if (paths_per_hash[hash]++ > 0) stats.duplicates++;
+    return true;
+}
+
+bool ContentIndex::Peek(const std::string& path, uint64_t& hash) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) return false;
+    hash = it->second.hash;
+    return true;
+}
+
+void ContentIndex::HashAhead(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::string& path : paths) {
+        if (entries.count(path) || !queued.insert(path).second) continue;
+        workers.Submit([this, path] {
+            if (!stopping) {
+                uint64_t hash;
+                Lookup(path, hash);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.erase(path);
+        });
+    }
+}
+
+std::string ContentIndex::Key(uint64_t hash) {
+    char key[32];
+    snprintf(key, sizeof(key), "xxh3:%016" PRIx64, hash);
+    return key;
+}
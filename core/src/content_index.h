@@ -0,0 +1,68 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Content hashes of image files, the cache key under which byte-identical copies are one entry
+    A hash is computed by the worker threads (HashAhead) or by the thread asking (Lookup), and kept
+    while the file's size and modification time stay the same. Thread safe.
+*/
+
+#pragma once
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+struct ContentIndexStats {
+    std::atomic<int> files{0};          // hashed, including rehashes of changed files
+    std::atomic<int> duplicates{0};     // paths whose content another path already has
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> hash_us{0};
+};
+
+
+class ContentIndex {
+public:
+    explicit ContentIndex(size_t thread_count = 2) : workers(thread_count) {}
+    ~ContentIndex() { stopping = true; }
+
+    ContentIndex(const ContentIndex&) = delete;
+    ContentIndex& operator=(const ContentIndex&) = delete;
+
+    // Hash of path, computed here when unknown or the file changed (always with rehash). False when
+    // it cannot be read.
+    bool Lookup(const std::string& path, uint64_t& hash, bool rehash = false);
+
+    // Hash as last computed, never touches the file; for the render thread
+    bool Peek(const std::string& path, uint64_t& hash) const;
+
+    // Queues the paths not hashed yet on the workers, returns immediately
+    void HashAhead(const std::vector<std::string>& paths);
+
+    // Cache key of content, "xxh3:" and the hash in hex
+    static std::string Key(uint64_t hash);
+
+    ContentIndexStats stats;
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<uint64_t, int> paths_per_hash;
+    std::unordered_set<std::string> queued;
+    std::atomic<bool> stopping{false};      // queued work is dropped once set
+
+    // Declared last so the workers are joined before the maps they write are destroyed
+    ThreadPool workers;
+};
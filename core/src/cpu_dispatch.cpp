@@ -0,0 +1,103 @@
+#include "cpu_dispatch.h"
+#include "content_hash.h"
+#include "image_ops.h"
+#include "logger.h"
+
+#include <atomic>
+#include <cstring>
+
+
+static const PixelKernels g_tables[] = {
+    { CpuLevel::Scalar, DownscaleBox_Scalar, ContentHash_Accumulate_Scalar },
+#if defined(CPU_DISPATCH_X86)
+    { CpuLevel::SSE2, DownscaleBox_SSE2, ContentHash_Accumulate_SSE2 },
+    { CpuLevel::AVX2, DownscaleBox_AVX2, ContentHash_Accumulate_AVX2 },
+    { CpuLevel::AVX512, DownscaleBox_AVX512, ContentHash_Accumulate_AVX512 },
+#elif defined(CPU_DISPATCH_NEON)
+    { CpuLevel::NEON, DownscaleBox_NEON, ContentHash_Accumulate_NEON },
+#endif
+};
+
+static std::atomic<const PixelKernels*> g_kernels{ nullptr };
+
+static const PixelKernels* FindTable(CpuLevel level) {
+    for (const PixelKernels& table : g_tables) {
+        if (table.level == level) return &table;
+    }
+    return &g_tables[0];
+}
+
+
+CpuLevel CpuDispatch_Detect() {
+    static const CpuLevel detected = [] {
+#if defined(CPU_DISPATCH_X86)
+        // Reads CPUID and checks with XGETBV that the OS saves the wide registers
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return CpuLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return CpuLevel::AVX2;
+        return CpuLevel::SSE2;
+#elif defined(CPU_DISPATCH_NEON)
+        return CpuLevel::NEON;
+#else
+        return CpuLevel::Scalar;
+#endif
+    }();
+    return detected;
+}
+
+bool CpuDispatch_Supported(CpuLevel level) {
+    if (level == CpuLevel::Scalar) return true;
+#if defined(CPU_DISPATCH_X86)
+    return level != CpuLevel::NEON && (int)level <= (int)CpuDispatch_Detect();
+#elif defined(CPU_DISPATCH_NEON)
+    return level == CpuLevel::NEON;
+#else
+    return false;
+#endif
+}
+
+bool CpuDispatch_ParseLevel(const char* name, CpuLevel& level) {
+    static const CpuLevel levels[] = { CpuLevel::Scalar, CpuLevel::SSE2, CpuLevel::AVX2, CpuLevel::AVX512, CpuLevel::NEON };
+    if (strcmp(name, "auto") == 0) {
+        level = CpuDispatch_Detect();
+        return true;
+    }
+    for (CpuLevel candidate : levels) {
+        if (strcmp(name, CpuDispatch_LevelName(candidate)) == 0) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* CpuDispatch_LevelName(CpuLevel level) {
+    switch (level) {
+        case CpuLevel::SSE2: return "sse2";
+        case CpuLevel::AVX2: return "avx2";
+        case CpuLevel::AVX512: return "avx512";
+        case CpuLevel::NEON: return "neon";
+        default: return "scalar";
+    }
+}
+
+CpuLevel CpuDispatch_Select(CpuLevel level) {
+    CpuLevel detected = CpuDispatch_Detect();
+    if (!CpuDispatch_Supported(level)) {
+        LOG_WARNING("cpu", "%s kernels are not supported on this CPU, using %s",
+                    CpuDispatch_LevelName(level), CpuDispatch_LevelName(detected));
+        level = detected;
+    }
+    g_kernels.store(FindTable(level), std::memory_order_release);
+    LOG_INFO("cpu", "Pixel kernels: %s (best supported: %s)", CpuDispatch_LevelName(level), CpuDispatch_LevelName(detected));
+    return level;
+}
+
+const PixelKernels& CpuDispatch_Kernels() {
+    const PixelKernels* kernels = g_kernels.load(std::memory_order_acquire);
+    if (!kernels) {
+        static const PixelKernels* best = FindTable(CpuDispatch_Detect());
+        kernels = best;
+    }
+    return *kernels;
+}
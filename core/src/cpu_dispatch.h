@@ -0,0 +1,47 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Runtime selection of the SIMD pixel kernels
+    The kernels are compiled for every instruction set the target architecture can have
+    (function target attributes, the build itself stays generic) and the best one the CPU and
+    OS support is picked from CPUID at startup. --cpu-level forces a lower one to compare paths.
+    Every level gives the same bytes as the scalar kernels.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_DISPATCH_X86
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define CPU_DISPATCH_NEON
+#endif
+
+
+// Ordered by width on x86, NEON is the only level above Scalar on arm64
+enum class CpuLevel : int { Scalar, SSE2, AVX2, AVX512, NEON };
+
+struct PixelKernels {
+    CpuLevel level;
+    void (*downscale_box)(const unsigned char* src, int src_width, int src_height,
+                          unsigned char* dst, int dst_width, int dst_height);
+    // Long input loop of the content hash (content_hash.h)
+    void (*hash_accumulate)(uint64_t* acc, const unsigned char* input, size_t size, const unsigned char* secret);
+};
+
+// Best level of this machine, detected once
+CpuLevel CpuDispatch_Detect();
+bool CpuDispatch_Supported(CpuLevel level);
+
+// Accepts scalar, sse2, avx2, avx512, neon and auto (the detected level)
+bool CpuDispatch_ParseLevel(const char* name, CpuLevel& level);
+const char* CpuDispatch_LevelName(CpuLevel level);
+
+// Switches the kernels to level, or to the detected one when it is not supported here.
+// Call at startup before the loader threads run. Returns the level in use.
+CpuLevel CpuDispatch_Select(CpuLevel level);
+
+// Kernels in use, the detected level until CpuDispatch_Select is called
+const PixelKernels& CpuDispatch_Kernels();
@@ -0,0 +1,283 @@
+#include "decoded_cache.h"
+#include "content_index.h"
+#include "exif_reader.h"
+#include "file_telemetry.h"
+#include "flight_recorder.h"
+#include "icc_profile.h"
+#include "image_ops.h"
+#include "logger.h"
+#include "lz4_block.h"
+#include "metrics.h"
+
+#include "stb_image.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+
+// Read and decode of one file, including the orientation fix-up
+static MetricHistogram& g_decode_seconds = Metrics_Histogram("image_decode_seconds", "Time to read and decode an image file.", Metrics_TimeBuckets());
+static MetricCounter& g_decoded_file_bytes = Metrics_Counter("image_decoded_file_bytes_total", "Bytes of image files decoded.");
+static MetricCounter& g_decoded_pixel_bytes = Metrics_Counter("image_decoded_pixel_bytes_total", "Bytes of RGBA pixels produced by decoding.");
+static MetricCounter& g_decode_failures = Metrics_Counter("image_decode_failures_total", "Image files that could not be read or decoded.");
+
+
+static uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ReadImageFile(const std::string& path, std::vector<unsigned char>& data, std::string& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = strerror(errno);
+        return false;
+    }
+    bool read = fseek(file, 0, SEEK_END) == 0;
+    long size = read ? ftell(file) : -1;
+    if (size > 0 && size <= INT32_MAX && fseek(file, 0, SEEK_SET) == 0) {
+        data.resize((size_t)size);
+        read = fread(data.data(), 1, data.size(), file) == data.size();
+        if (!read) error = "short read";
+    } else {
+        read = false;
+        error = size == 0 ? "empty file" : "file too large";
+    }
+    fclose(file);
+    return read;
+}
+
+std::shared_ptr<DecodedImage> DecodeImage(const unsigned char* data, size_t size, std::string& error) {
+    auto image = std::make_shared<DecodedImage>();
+    int channels;
+    image->pixels = stbi_load_from_memory(data, (int)size, &image->width, &image->height, &channels, 4);
+    if (!image->pixels) {
+        const char* reason = stbi_failure_reason();
+        error = reason ? reason : "unknown";
+        return nullptr;
+    }
+
+    // Camera JPEGs are often stored sideways with an EXIF tag saying how to show them
+    ExifInfo exif;
+    if (Exif_Parse(data, size, exif) && exif.orientation > 1) {
+        unsigned char* upright = (unsigned char*)malloc(image->Size());
+        if (upright) {
+            ApplyOrientation(image->pixels, image->width, image->height, exif.orientation, upright);
+            free(image->pixels);
+            image->pixels = upright;
+            if (OrientationSwapsAxes(exif.orientation)) std::swap(image->width, image->height);
+        }
+    }
+    // Converted to the display's colors when drawn, the pixels stay as encoded
+    image->icc = IccProfile_FromImage(data, size);
+    return image;
+}
+
+
+std::shared_ptr<const DecodedImage> DecodedCache::Load(const std::string& path) {
+    // Hashing first lets a copy of a file decoded before under another name hit its entry
+    std::string key = Key(path, true);
+    {
+        // Waits out a decode of the same content already running (session warm-up, another
+        // viewer), its result is then a hit instead of a second decode
+        std::unique_lock<std::mutex> lock(mutex);
+        decode_done.wait(lock, [&] { return !decoding.count(key); });
+        decoding.insert(key);
+    }
+    std::shared_ptr<const DecodedImage> image = GetKey(key);
+    if (!image) image = Decode(path, key);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decoding.erase(key);
+    }
+    decode_done.notify_all();
+    return image;
+}
+
+std::shared_ptr<const DecodedImage> DecodedCache::Decode(const std::string& path, const std::string& key) {
+    TRACE_ZONE("Decode");
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> data;
+    std::string error;
+    if (!ReadImageFile(path, data, error)) {
+        LOG_ERROR("image", "Failed to read image: %s (%s)", path.c_str(), error.c_str());
+        if (telemetry) telemetry->RecordFailure(path, "read", error, 0, MillisecondsSince(start));
+        g_decode_failures.Add();
+        return nullptr;
+    }
+    double io_ms = MillisecondsSince(start);
+
+    auto decode_start = std::chrono::steady_clock::now();
+    std::shared_ptr<DecodedImage> image = DecodeImage(data.data(), data.size(), error);
+    if (!image) {
+        LOG_ERROR("image", "Failed to load image: %s (%s)", path.c_str(), error.c_str());
+        if (telemetry) telemetry->RecordFailure(path, "decode", error, data.size(), io_ms);
+        g_decode_failures.Add();
+        return nullptr;
+    }
+    uint64_t decode_us = MicrosecondsSince(start);
+    stats.decode_us += decode_us;
+    g_decode_seconds.Observe(decode_us / 1e6);
+    g_decoded_file_bytes.Add(data.size());
+    g_decoded_pixel_bytes.Add(image->Size());
+    if (telemetry) {
+        telemetry->RecordDecode(path, data.size(), io_ms, MillisecondsSince(decode_start), image->width, image->height);
+    }
+
+    PutKey(key, image);
+    return image;
+}
+
+std::shared_ptr<const DecodedImage> DecodedCache::Get(const std::string& path) {
+    return GetKey(Key(path, false));
+}
+
+bool DecodedCache::Contains(const std::string& path) {
+    std::string key = Key(path, false);
+    std::lock_guard<std::mutex> lock(mutex);
+    return raw.count(key) || compressed.count(key);
+}
+
+void DecodedCache::Put(const std::string& path, std::shared_ptr<const DecodedImage> image) {
+    PutKey(Key(path, false), std::move(image));
+}
+
+std::string DecodedCache::Key(const std::string& path, bool hash_now) {
+    uint64_t hash;
+    if (content && (hash_now ? content->Lookup(path, hash) : content->Peek(path, hash))) {
+        return ContentIndex::Key(hash);
+    }
+    return path;
+}
+
+std::shared_ptr<const DecodedImage> DecodedCache::GetKey(const std::string& key) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto raw_it = raw.find(key);
+    if (raw_it != raw.end()) {
+        raw_lru.splice(raw_lru.begin(), raw_lru, raw_it->second.lru);
+        stats.raw_hits++;
+        return raw_it->second.image;
+    }
+
+    auto compressed_it = compressed.find(key);
+    if (compressed_it == compressed.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+
+    // Promote: take the block out of the compressed tier and expand it without holding the lock
+    CompressedEntry entry = std::move(compressed_it->second);
+    compressed_lru.erase(entry.lru);
+    compressed.erase(compressed_it);
+    stats.compressed_bytes -= entry.data.size();
+    stats.compressed_source_bytes -= (size_t)entry.width * entry.height * 4;
+    stats.compressed_hits++;
+    lock.unlock();
+
+    TRACE_ZONE("LZ4 expand");
+    auto start = std::chrono::steady_clock::now();
+    auto image = std::make_shared<DecodedImage>();
+    image->width = entry.width;
+    image->height = entry.height;
+    image->icc = std::move(entry.icc);
+    image->pixels = (unsigned char*)malloc(image->Size());
+    int size = image->pixels ? LZ4Block_Decompress(entry.data.data(), (int)entry.data.size(), image->pixels, (int)image->Size()) : -1;
+    if (size != (int)image->Size()) {
+        LOG_ERROR("cache", "Corrupt compressed cache entry: %s", key.c_str());
+        return nullptr;
+    }
+    stats.decompress_us += MicrosecondsSince(start);
+
+    PutKey(key, image);
+    return image;
+}
+
+void DecodedCache::PutKey(const std::string& key, std::shared_ptr<const DecodedImage> image) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto it = raw.find(key);
+    if (it != raw.end()) {
+        stats.raw_bytes -= it->second.image->Size();
+        raw_lru.erase(it->second.lru);
+        raw.erase(it);
+    }
+    raw_lru.push_front(key);
+    stats.raw_bytes += image->Size();
+    raw[key] = RawEntry{ std::move(image), raw_lru.begin() };
+
+    Rebalance(lock);
+}
+
+void DecodedCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    raw.clear();
+    compressed.clear();
+    raw_lru.clear();
+    compressed_lru.clear();
+    stats.raw_bytes = 0;
+    stats.compressed_bytes = 0;
+    stats.compressed_source_bytes = 0;
+}
+
+void DecodedCache::SetBudgets(size_t new_raw_budget, size_t new_compressed_budget) {
+    std::unique_lock<std::mutex> lock(mutex);
+    raw_budget = new_raw_budget;
+    compressed_budget = new_compressed_budget;
+    Rebalance(lock);
+}
+
+void DecodedCache::Rebalance(std::unique_lock<std::mutex>& lock) {
+    // Demote from raw, always keeping the most recent image even if it alone is over budget
+    while (stats.raw_bytes > raw_budget && raw_lru.size() > 1) {
+        std::string path = raw_lru.back();
+        raw_lru.pop_back();
+        auto it = raw.find(path);
+        std::shared_ptr<const DecodedImage> image = std::move(it->second.image);
+        raw.erase(it);
+        stats.raw_bytes -= image->Size();
+        stats.demotions++;
+
+        if (compressed_budget == 0 || image->Size() > (size_t)INT32_MAX / 2) {
+            stats.evictions++;
+            continue;
+        }
+
+        lock.unlock();
+        uint64_t zone_start = FlightRecorder_Now();
+        auto start = std::chrono::steady_clock::now();
+        CompressedEntry entry;
+        entry.width = image->width;
+        entry.height = image->height;
+        entry.icc = image->icc;
+        entry.data.resize(LZ4Block_Bound((int)image->Size()));
+        entry.data.resize(LZ4Block_Compress(image->pixels, (int)image->Size(), entry.data.data(), (int)entry.data.size()));
+        entry.data.shrink_to_fit();
+        stats.compress_us += MicrosecondsSince(start);
+        FlightRecorder_Zone("LZ4 compress", zone_start, FlightRecorder_Now());
+        lock.lock();
+
+        // Someone may have brought the image back while the lock was released
+        if (raw.count(path) || compressed.count(path)) continue;
+        compressed_lru.push_front(path);
+        entry.lru = compressed_lru.begin();
+        stats.compressed_bytes += entry.data.size();
+        stats.compressed_source_bytes += image->Size();
+        compressed[path] = std::move(entry);
+    }
+
+    while (stats.compressed_bytes > compressed_budget && !compressed_lru.empty()) {
+        auto it = compressed.find(compressed_lru.back());
+        stats.compressed_bytes -= it->second.data.size();
+        stats.compressed_source_bytes -= (size_t)it->second.width * it->second.height * 4;
+        compressed.erase(it);
+        compressed_lru.pop_back();
+        stats.evictions++;
+    }
+}
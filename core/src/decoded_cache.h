@@ -0,0 +1,134 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Decoded RGBA images kept in RAM in two tiers
+    raw:        ready to upload, least recently used images are demoted when over budget
+    compressed: LZ4 block, much cheaper to expand than decoding the file again;
+                a hit is promoted back to raw, the least recently used are evicted
+    Thread safe, used by the loader thread and the render thread's synchronous path
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ContentIndex;
+class FileTelemetry;
+struct IccProfile;
+
+
+struct DecodedImage {
+    DecodedImage() = default;
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+    ~DecodedImage() { free(pixels); }
+
+    size_t Size() const { return (size_t)width * height * 4; }
+
+    int width = 0;
+    int height = 0;
+    unsigned char* pixels = nullptr;    // RGBA, tightly packed, malloc'd like stb_image's output so it is adopted without a copy
+    std::shared_ptr<const IccProfile> icc;  // embedded color profile, nullptr for untagged (sRGB) files
+};
+
+
+// Reads a whole file, false with the reason in error when it cannot be read or is empty
+bool ReadImageFile(const std::string& path, std::vector<unsigned char>& data, std::string& error);
+
+// Decodes a file held in memory to RGBA turned upright for its EXIF orientation, with its embedded
+// color profile. nullptr with stb_image's reason in error when it cannot be decoded. Not cached.
+std::shared_ptr<DecodedImage> DecodeImage(const unsigned char* data, size_t size, std::string& error);
+
+
+struct DecodedCacheStats {
+    std::atomic<int> raw_hits{0};
+    std::atomic<int> compressed_hits{0};
+    std::atomic<int> misses{0};
+    std::atomic<int> demotions{0};
+    std::atomic<int> evictions{0};
+    std::atomic<size_t> raw_bytes{0};
+    std::atomic<size_t> compressed_bytes{0};
+    std::atomic<size_t> compressed_source_bytes{0};     // raw size of what the compressed tier holds
+    std::atomic<uint64_t> decode_us{0};                 // totals, for per-call averages
+    std::atomic<uint64_t> decompress_us{0};
+    std::atomic<uint64_t> compress_us{0};
+};
+
+
+class DecodedCache {
+public:
+    DecodedCache(size_t raw_budget, size_t compressed_budget)
+        : raw_budget(raw_budget), compressed_budget(compressed_budget) {}
+
+    DecodedCache(const DecodedCache&) = delete;
+    DecodedCache& operator=(const DecodedCache&) = delete;
+
+    // Looks path up in both tiers, decodes the file on a miss. nullptr when it cannot be decoded.
+    // Concurrent loads of the same content decode it once.
+    std::shared_ptr<const DecodedImage> Load(const std::string& path);
+
+    // Lookup only, nullptr on a miss
+    std::shared_ptr<const DecodedImage> Get(const std::string& path);
+
+    bool Contains(const std::string& path);
+
+    // Inserts into the raw tier, demoting or evicting older images to stay within the budgets
+    void Put(const std::string& path, std::shared_ptr<const DecodedImage> image);
+
+    void Clear();
+
+    void SetBudgets(size_t raw_budget, size_t compressed_budget);
+
+    DecodedCacheStats stats;
+
+    // Receives read and decode times of every file decoded, and the reason of every failure
+    FileTelemetry* telemetry = nullptr;
+
+    // Keys entries by file content when set, so byte-identical files share one decode. Load hashes
+    // files not hashed yet, the other calls use the hash only once known and the path until then.
+    ContentIndex* content = nullptr;
+
+private:
+    struct RawEntry {
+        std::shared_ptr<const DecodedImage> image;
+        std::list<std::string>::iterator lru;
+    };
+    struct CompressedEntry {
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<const IccProfile> icc;
+        std::vector<uint8_t> data;
+        std::list<std::string>::iterator lru;
+    };
+
+    // Content key of path when content is set and the hash known (or computed when hash_now), else path
+    std::string Key(const std::string& path, bool hash_now);
+    std::shared_ptr<const DecodedImage> GetKey(const std::string& key);
+    // Reads and decodes path, stores the result under key
+    std::shared_ptr<const DecodedImage> Decode(const std::string& path, const std::string& key);
+    void PutKey(const std::string& key, std::shared_ptr<const DecodedImage> image);
+
+    // Caller holds mutex, compression happens with the lock released
+    void Rebalance(std::unique_lock<std::mutex>& lock);
+
+    std::mutex mutex;
+    size_t raw_budget;
+    size_t compressed_budget;
+    std::unordered_map<std::string, RawEntry> raw;
+    std::unordered_map<std::string, CompressedEntry> compressed;
+    std::list<std::string> raw_lru;             // most recently used at the front
+    std::list<std::string> compressed_lru;
+    std::unordered_set<std::string> decoding;   // keys a Load is looking up or decoding
+    std::condition_variable decode_done;
+};
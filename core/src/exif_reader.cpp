@@ -0,0 +1,130 @@
+#include "exif_reader.h"
+#include "image_ops.h"
+
+#include "stb_image.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+
+// APP0 plus the largest possible APP1 segment
+static const size_t EXIF_HEAD_SIZE = 72 * 1024;
+
+static const uint16_t TAG_ORIENTATION = 0x0112;
+static const uint16_t TAG_THUMBNAIL_OFFSET = 0x0201;
+static const uint16_t TAG_THUMBNAIL_LENGTH = 0x0202;
+
+
+// TIFF block inside the APP1 segment, offsets are relative to its start
+struct TiffReader {
+    const unsigned char* data;
+    size_t size;
+    bool big_endian;
+
+    bool Read16(size_t offset, uint16_t& value) const {
+        if (offset + 2 > size) return false;
+        const unsigned char* p = data + offset;
+        value = big_endian ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+        return true;
+    }
+
+    bool Read32(size_t offset, uint32_t& value) const {
+        if (offset + 4 > size) return false;
+        const unsigned char* p = data + offset;
+        value = big_endian ? ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3])
+                           : ((uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0]);
+        return true;
+    }
+};
+
+// Calls fn(tag, value_offset) for every entry of the IFD at offset, returns the next IFD's offset (0 at the end)
+template <typename Fn>
+static uint32_t ReadIFD(const TiffReader& tiff, uint32_t offset, Fn fn) {
+    uint16_t count;
+    if (!tiff.Read16(offset, count)) return 0;
+    size_t entry = (size_t)offset + 2;
+    for (int i = 0; i < count; i++, entry += 12) {
+        uint16_t tag;
+        if (!tiff.Read16(entry, tag)) return 0;
+        fn(tag, entry + 8);
+    }
+    uint32_t next;
+    return tiff.Read32(entry, next) ? next : 0;
+}
+
+bool Exif_Parse(const unsigned char* data, size_t size, ExifInfo& info) {
+    info = ExifInfo();
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+    // Walk the marker segments up to the APP1 one holding "Exif"
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        unsigned char marker = data[pos + 1];
+        size_t length = (size_t)(data[pos + 2] << 8 | data[pos + 3]);
+        if (marker == 0xDA || marker == 0xD9 || length < 2) return false;  // image data reached
+
+        const unsigned char* segment = data + pos + 4;
+        if (marker == 0xE1 && length >= 16 && pos + 4 + 6 + 8 <= size && memcmp(segment, "Exif\0\0", 6) == 0) {
+            size_t tiff_start = pos + 4 + 6;
+            size_t tiff_end = pos + 2 + length < size ? pos + 2 + length : size;   // the head may end inside it
+            TiffReader tiff = { data + tiff_start, tiff_end - tiff_start, segment[6] == 'M' };
+            uint16_t magic;
+            uint32_t ifd0;
+            if (!tiff.Read16(2, magic) || magic != 42 || !tiff.Read32(4, ifd0)) return false;
+
+            uint32_t ifd1 = ReadIFD(tiff, ifd0, [&](uint16_t tag, size_t value) {
+                uint16_t orientation;
+                if (tag == TAG_ORIENTATION && tiff.Read16(value, orientation) && orientation >= 1 && orientation <= 8) {
+                    info.orientation = orientation;
+                }
+            });
+
+            uint32_t thumbnail_offset = 0, thumbnail_length = 0;
+            if (ifd1) {
+                ReadIFD(tiff, ifd1, [&](uint16_t tag, size_t value) {
+                    if (tag == TAG_THUMBNAIL_OFFSET) tiff.Read32(value, thumbnail_offset);
+                    if (tag == TAG_THUMBNAIL_LENGTH) tiff.Read32(value, thumbnail_length);
+                });
+            }
+            if (thumbnail_offset && thumbnail_length && (size_t)thumbnail_offset + thumbnail_length <= tiff.size) {
+                info.thumbnail_offset = tiff_start + thumbnail_offset;
+                info.thumbnail_size = thumbnail_length;
+            }
+            return true;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+bool Exif_LoadThumbnail(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height,
+                        int& full_width, int& full_height) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<unsigned char> head(EXIF_HEAD_SIZE);
+    head.resize(fread(head.data(), 1, head.size(), file));
+    fclose(file);
+
+    ExifInfo info;
+    if (!Exif_Parse(head.data(), head.size(), info) || !info.thumbnail_size) return false;
+
+    int channels;
+    unsigned char* pixels = stbi_load_from_memory(head.data() + info.thumbnail_offset, (int)info.thumbnail_size,
+                                                  &width, &height, &channels, 4);
+    if (!pixels) return false;
+    rgba.resize((size_t)width * height * 4);
+    ApplyOrientation(pixels, width, height, info.orientation, rgba.data());
+    stbi_image_free(pixels);
+    if (OrientationSwapsAxes(info.orientation)) std::swap(width, height);
+
+    // The frame header usually follows the EXIF block closely enough to be in the head
+    full_width = full_height = 0;
+    if (stbi_info_from_memory(head.data(), (int)head.size(), &full_width, &full_height, &channels)) {
+        if (OrientationSwapsAxes(info.orientation)) std::swap(full_width, full_height);
+    } else {
+        full_width = full_height = 0;
+    }
+    return true;
+}
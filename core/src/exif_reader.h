@@ -0,0 +1,29 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    EXIF (APP1) metadata of JPEG files: orientation and the embedded thumbnail
+    Cameras store a ~160x120 JPEG thumbnail near the start of the file, decoding it
+    takes a fraction of a millisecond against tens of milliseconds for the full image.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+struct ExifInfo {
+    int orientation = 1;            // 1-8 as in the TIFF spec, 1 is upright
+    size_t thumbnail_offset = 0;    // from the start of the data passed to Exif_Parse, 0 when there is none
+    size_t thumbnail_size = 0;
+};
+
+// Parses the APP1 segment of a JPEG, data may be just the head of the file.
+// False when data is not a JPEG or has no readable EXIF block.
+bool Exif_Parse(const unsigned char* data, size_t size, ExifInfo& info);
+
+// Reads the head of the file and decodes its EXIF thumbnail upright. full_width and
+// full_height are the upright size of the image itself, 0 when not found in the head.
+bool Exif_LoadThumbnail(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height,
+                        int& full_width, int& full_height);
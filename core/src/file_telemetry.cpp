@@ -0,0 +1,91 @@
+#include "file_telemetry.h"
+
+#include <cstdio>
+
+
+void FileTelemetry::RecordDecode(const std::string& path, size_t file_bytes, double io_ms, double decode_ms, int width, int height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FileRecord& record = records[path];
+    if (!record.error.empty()) failures--;
+    record.path = path;
+    record.file_bytes = file_bytes;
+    record.width = width;
+    record.height = height;
+    record.io_ms = io_ms;
+    record.decode_ms = decode_ms;
+    record.upload_ms = 0.0;
+    record.loads++;
+    record.error.clear();
+}
+
+void FileTelemetry::RecordFailure(const std::string& path, const char* stage, const std::string& reason, size_t file_bytes, double io_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FileRecord& record = records[path];
+    if (record.error.empty()) failures++;
+    record.path = path;
+    record.file_bytes = file_bytes;
+    record.width = 0;
+    record.height = 0;
+    record.io_ms = io_ms;
+    record.decode_ms = 0.0;
+    record.upload_ms = 0.0;
+    record.loads++;
+    record.error = std::string(stage) + ": " + reason;
+}
+
+void FileTelemetry::RecordUpload(const std::string& path, double upload_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = records.find(path);
+    if (it != records.end()) it->second.upload_ms = upload_ms;
+}
+
+std::vector<FileRecord> FileTelemetry::Snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<FileRecord> snapshot;
+    snapshot.reserve(records.size());
+    for (const auto& entry : records) {
+        snapshot.push_back(entry.second);
+    }
+    return snapshot;
+}
+
+int FileTelemetry::Size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)records.size();
+}
+
+int FileTelemetry::FailureCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failures;
+}
+
+void FileTelemetry::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    records.clear();
+    failures = 0;
+}
+
+// Quotes a CSV field when it holds a separator, quote or line break
+static std::string CsvField(const std::string& value) {
+    if (value.find_first_of(",\"\r\n") == std::string::npos) return value;
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+bool FileTelemetry::WriteCSV(const std::string& path) const {
+    std::vector<FileRecord> rows = Snapshot();
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+    fprintf(file, "path,file_bytes,width,height,io_ms,decode_ms,upload_ms,total_ms,loads,error\n");
+    for (const FileRecord& row : rows) {
+        fprintf(file, "%s,%zu,%d,%d,%.3f,%.3f,%.3f,%.3f,%d,%s\n", CsvField(row.path).c_str(), row.file_bytes,
+                row.width, row.height, row.io_ms, row.decode_ms, row.upload_ms, row.TotalMs(), row.loads,
+                CsvField(row.error).c_str());
+    }
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,52 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Per-file load records: read, decode and upload times, file size and dimensions
+    One record per path holding its latest load, failures keep the stage and reason.
+    Thread safe, written by the loader thread and the render thread.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+struct FileRecord {
+    std::string path;
+    size_t file_bytes = 0;
+    int width = 0;
+    int height = 0;
+    double io_ms = 0.0;
+    double decode_ms = 0.0;     // includes orientation fix-up
+    double upload_ms = 0.0;     // full resolution texture, 0 until uploaded
+    int loads = 0;              // decodes of this file so far
+    std::string error;          // "stage: reason", empty when the last load worked
+
+    double TotalMs() const { return io_ms + decode_ms + upload_ms; }
+};
+
+
+class FileTelemetry {
+public:
+    void RecordDecode(const std::string& path, size_t file_bytes, double io_ms, double decode_ms, int width, int height);
+    void RecordFailure(const std::string& path, const char* stage, const std::string& reason, size_t file_bytes, double io_ms);
+    void RecordUpload(const std::string& path, double upload_ms);
+
+    // Copy of every record, in no particular order
+    std::vector<FileRecord> Snapshot() const;
+    int Size() const;
+    int FailureCount() const;
+    void Clear();
+
+    // One row per file, times in ms. False when the file cannot be written.
+    bool WriteCSV(const std::string& path) const;
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, FileRecord> records;
+    int failures = 0;
+};
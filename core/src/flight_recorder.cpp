@@ -0,0 +1,364 @@
+#include "flight_recorder.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+
+// A zone is written field by field while the dump may be reading it, the sequence number
+// tells the reader whether it saw a consistent slot (even and unchanged) or a torn one.
+struct ZoneSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> end{0};
+    std::atomic<const char*> name{nullptr};
+};
+
+// Written only by its thread, overwritten oldest first
+struct ZoneRing {
+    static const size_t CAPACITY = 4096;    // power of two, a few seconds of the render thread
+
+    ZoneSlot slots[CAPACITY];
+    std::atomic<uint64_t> head{0};
+    std::atomic<const char*> thread_name{nullptr};
+    std::atomic<bool> closed{false};
+    int thread = 0;
+};
+
+struct ThreadZoneRing {
+    std::shared_ptr<ZoneRing> ring;
+    ~ThreadZoneRing() {
+        if (ring) ring->closed.store(true, std::memory_order_release);
+    }
+};
+
+struct Annotation {
+    uint64_t time;
+    const char* key;
+    std::string value;
+};
+
+static const size_t ANNOTATION_LIMIT = 256;
+static const int DUMPS_KEPT = 10;
+static const double DUMP_WINDOW_SECONDS = 5.0;
+static const double DUMP_COOLDOWN_SECONDS = 5.0;
+
+static const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+static std::atomic<int> g_thread_count{0};
+
+static std::mutex g_rings_mutex;
+static std::vector<std::shared_ptr<ZoneRing>> g_rings;
+
+static std::mutex g_annotations_mutex;
+static std::deque<Annotation> g_annotations;
+
+// Frame tracking, written by the render thread, read by the watchdog
+static std::atomic<uint64_t> g_frame_start{0};
+static std::atomic<uint64_t> g_hitch_start{0};
+static std::atomic<uint64_t> g_hitch_end{0};
+
+static std::thread g_watchdog;
+static std::mutex g_watchdog_mutex;
+static std::condition_variable g_watchdog_wake;
+static bool g_watchdog_stop = false;
+static bool g_watchdog_running = false;
+static std::atomic<uint64_t> g_hitch_ns{0};    // 0 while the watchdog is off
+static std::string g_dump_directory;
+
+static std::mutex g_dump_mutex;
+static std::atomic<int> g_dump_count{0};
+
+
+uint64_t FlightRecorder_Now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+static ZoneRing* CurrentRing() {
+    static thread_local ThreadZoneRing thread_ring;
+    if (!thread_ring.ring) {
+        std::shared_ptr<ZoneRing> ring = std::make_shared<ZoneRing>();
+        ring->thread = ++g_thread_count;
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        g_rings.push_back(ring);
+        thread_ring.ring = std::move(ring);
+    }
+    return thread_ring.ring.get();
+}
+
+static void WriteZone(ZoneRing* ring, const char* name, uint64_t start_ns, uint64_t end_ns) {
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ZoneSlot& slot = ring->slots[head & (ZoneRing::CAPACITY - 1)];
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.start.store(start_ns, std::memory_order_relaxed);
+    slot.end.store(end_ns, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder_Zone(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    WriteZone(CurrentRing(), name, start_ns, end_ns);
+}
+
+void FlightRecorder_SetThreadName(const char* name) {
+    CurrentRing()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+ZoneRing* FlightRecorder_AddTrack(const char* name) {
+    std::shared_ptr<ZoneRing> ring = std::make_shared<ZoneRing>();
+    ring->thread = ++g_thread_count;
+    ring->thread_name.store(name, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(g_rings_mutex);
+    g_rings.push_back(ring);
+    return ring.get();
+}
+
+void FlightRecorder_TrackZone(ZoneRing* track, const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (track) WriteZone(track, name, start_ns, end_ns);
+}
+
+void FlightRecorder_Annotate(const char* key, const std::string& value) {
+    Annotation annotation = { FlightRecorder_Now(), key, value };
+    std::lock_guard<std::mutex> lock(g_annotations_mutex);
+    g_annotations.push_back(std::move(annotation));
+    if (g_annotations.size() > ANNOTATION_LIMIT) g_annotations.pop_front();
+}
+
+void FlightRecorder_BeginFrame() {
+    uint64_t now = FlightRecorder_Now();
+    uint64_t previous = g_frame_start.exchange(now, std::memory_order_relaxed);
+    if (previous == 0) return;
+    FlightRecorder_Zone("Frame", previous, now);
+    uint64_t hitch_ns = g_hitch_ns.load(std::memory_order_relaxed);
+    if (hitch_ns && now - previous > hitch_ns) {
+        g_hitch_start.store(previous, std::memory_order_relaxed);
+        g_hitch_end.store(now, std::memory_order_release);
+        g_watchdog_wake.notify_one();
+    }
+}
+
+
+static void AppendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; c++) {
+        switch (*c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)*c < 0x20) {
+                    char code[8];
+                    snprintf(code, sizeof(code), "\\u%04x", *c);
+                    out += code;
+                } else {
+                    out += *c;
+                }
+        }
+    }
+}
+
+#if defined(__GNUC__)
+static void AppendEvent(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+#endif
+static void AppendEvent(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += out.empty() ? "" : ",\n";
+    out += line;
+}
+
+bool FlightRecorder_Dump(const std::string& path, double window_seconds, const char* reason) {
+    std::lock_guard<std::mutex> dump_lock(g_dump_mutex);
+    uint64_t now = FlightRecorder_Now();
+    uint64_t window_start = now > window_seconds * 1e9 ? now - (uint64_t)(window_seconds * 1e9) : 0;
+
+    std::vector<std::shared_ptr<ZoneRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        // Rings of exited threads stay until their zones have aged out of any window
+        g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [window_start](const std::shared_ptr<ZoneRing>& ring) {
+            if (!ring->closed.load(std::memory_order_acquire)) return false;
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            return head == 0 || ring->slots[(head - 1) & (ZoneRing::CAPACITY - 1)].end.load(std::memory_order_relaxed) < window_start;
+        }), g_rings.end());
+        rings = g_rings;
+    }
+
+    std::string events;
+    for (const std::shared_ptr<ZoneRing>& ring : rings) {
+        const char* thread_name = ring->thread_name.load(std::memory_order_relaxed);
+        AppendEvent(events, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    ring->thread, thread_name ? thread_name : "worker");
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t count = std::min(head, (uint64_t)ZoneRing::CAPACITY);
+        for (uint64_t i = head - count; i < head; i++) {
+            ZoneSlot& slot = ring->slots[i & (ZoneRing::CAPACITY - 1)];
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            uint64_t start = slot.start.load(std::memory_order_relaxed);
+            uint64_t end = slot.end.load(std::memory_order_relaxed);
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence % 2 != 0 || slot.sequence.load(std::memory_order_relaxed) != sequence || !name) continue;
+            if (end < window_start) continue;
+            AppendEvent(events, "{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        name, ring->thread, start / 1e3, (end - start) / 1e3);
+        }
+    }
+
+    // Annotations inside the window, plus the value each key had when the window opened
+    {
+        std::lock_guard<std::mutex> lock(g_annotations_mutex);
+        std::map<std::string, const Annotation*> before_window;
+        for (const Annotation& annotation : g_annotations) {
+            if (annotation.time < window_start) {
+                before_window[annotation.key] = &annotation;
+                continue;
+            }
+            std::string value;
+            AppendEscaped(value, annotation.value.c_str());
+            events += events.empty() ? "" : ",\n";
+            events += "{\"ph\":\"i\",\"s\":\"g\",\"name\":\"";
+            AppendEscaped(events, annotation.key);
+            events += "\",\"pid\":1,\"tid\":0,\"ts\":" + std::to_string(annotation.time / 1e3) + ",\"args\":{\"value\":\"" + value + "\"}}";
+        }
+        for (const auto& key_annotation : before_window) {
+            std::string value;
+            AppendEscaped(value, key_annotation.second->value.c_str());
+            events += events.empty() ? "" : ",\n";
+            events += "{\"ph\":\"i\",\"s\":\"g\",\"name\":\"";
+            AppendEscaped(events, key_annotation.first.c_str());
+            events += " (earlier)\",\"pid\":1,\"tid\":0,\"ts\":" + std::to_string(window_start / 1e3) + ",\"args\":{\"value\":\"" + value + "\"}}";
+        }
+    }
+
+    std::string reason_text;
+    AppendEscaped(reason_text, reason ? reason : "");
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"reason\":\"%s\"},\"traceEvents\":[\n", reason_text.c_str());
+    fwrite(events.data(), 1, events.size(), file);
+    fputs("\n]}\n", file);
+    bool written = fclose(file) == 0;
+    if (written) g_dump_count++;
+    return written;
+}
+
+int FlightRecorder_DumpCount() {
+    return g_dump_count;
+}
+
+const std::string& FlightRecorder_RunTag() {
+    static const std::string tag = [] {
+        std::time_t now = std::time(nullptr);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+        return std::string(stamp) + "_" + std::to_string(getpid());
+    }();
+    return tag;
+}
+
+
+static void WriteHitchDump(int index, const char* reason) {
+    std::error_code error;
+    std::filesystem::create_directories(g_dump_directory, error);
+    std::string prefix = g_dump_directory + "/hitch_" + FlightRecorder_RunTag() + "_";
+    std::string path = prefix + std::to_string(index) + ".json";
+    if (FlightRecorder_Dump(path, DUMP_WINDOW_SECONDS, reason)) {
+        LOG_WARNING("trace", "%s, trace written to %s", reason, path.c_str());
+    } else {
+        LOG_ERROR("trace", "Failed to write trace: %s", path.c_str());
+    }
+    if (index >= DUMPS_KEPT) {
+        std::filesystem::remove(prefix + std::to_string(index - DUMPS_KEPT) + ".json", error);
+    }
+}
+
+static void WatchdogMain() {
+    FlightRecorder_SetThreadName("watchdog");
+    int dumps = 0;
+    uint64_t last_dump = 0;
+    uint64_t reported_hitch = 0;
+    uint64_t reported_stall = 0;
+    std::unique_lock<std::mutex> lock(g_watchdog_mutex);
+    while (!g_watchdog_stop) {
+        g_watchdog_wake.wait_for(lock, std::chrono::milliseconds(100));
+        if (g_watchdog_stop) break;
+        lock.unlock();
+
+        uint64_t now = FlightRecorder_Now();
+        bool cooled_down = last_dump == 0 || now - last_dump > DUMP_COOLDOWN_SECONDS * 1e9;
+        uint64_t hitch_end = g_hitch_end.load(std::memory_order_acquire);
+        uint64_t frame_start = g_frame_start.load(std::memory_order_relaxed);
+        char reason[128];
+        if (hitch_end != reported_hitch) {
+            // A long frame has just finished, the whole of it is in the rings
+            reported_hitch = hitch_end;
+            if (cooled_down) {
+                snprintf(reason, sizeof(reason), "Frame took %.1f ms", (hitch_end - g_hitch_start.load(std::memory_order_relaxed)) / 1e6);
+                WriteHitchDump(dumps++, reason);
+                last_dump = now;
+            }
+        } else if (frame_start && frame_start != reported_stall && now - frame_start > std::max<uint64_t>(g_hitch_ns.load() * 10, 1000000000ull)) {
+            // The frame has not finished at all, dump what led up to it while it is stuck
+            reported_stall = frame_start;
+            if (cooled_down) {
+                snprintf(reason, sizeof(reason), "Frame still running after %.0f ms", (now - frame_start) / 1e6);
+                WriteHitchDump(dumps++, reason);
+                last_dump = now;
+            }
+        }
+        lock.lock();
+    }
+}
+
+void FlightRecorder_StartWatchdog(double hitch_ms, const std::string& directory) {
+    if (g_watchdog_running || hitch_ms <= 0) return;
+    g_hitch_ns = (uint64_t)(hitch_ms * 1e6);
+    g_dump_directory = directory.empty() ? "." : directory;
+    g_watchdog_stop = false;
+    g_watchdog = std::thread(WatchdogMain);
+    g_watchdog_running = true;
+
+    static bool exit_hook = false;
+    if (!exit_hook) {
+        exit_hook = true;
+        atexit(FlightRecorder_StopWatchdog);
+    }
+}
+
+void FlightRecorder_StopWatchdog() {
+    if (!g_watchdog_running) return;
+    {
+        std::lock_guard<std::mutex> lock(g_watchdog_mutex);
+        g_watchdog_stop = true;
+    }
+    g_watchdog_wake.notify_one();
+    g_watchdog.join();
+    g_watchdog_running = false;
+    g_hitch_ns = 0;
+}
@@ -0,0 +1,71 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Always-on flight recorder
+    TRACE_ZONE records a named span into a ring owned by the calling thread, old spans are
+    overwritten so only the last few seconds are kept. Annotations record what the app was
+    working on (file being loaded, decoded). A watchdog thread writes the recent window to a
+    Chrome trace file (chrome://tracing, Perfetto) when a frame runs past the hitch threshold.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct ZoneRing;
+
+
+// Nanoseconds on the recorder's clock
+uint64_t FlightRecorder_Now();
+
+// name must be a string literal or otherwise outlive the process
+void FlightRecorder_Zone(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+// Shown as the thread's name in the trace
+void FlightRecorder_SetThreadName(const char* name);
+
+// A track of its own in the trace, not tied to a thread, for work timed after the fact such as
+// GPU passes. Only one thread may write to a track.
+ZoneRing* FlightRecorder_AddTrack(const char* name);
+void FlightRecorder_TrackZone(ZoneRing* track, const char* name, uint64_t start_ns, uint64_t end_ns);
+
+// Records that key now has value, e.g. ("loading", path). Takes a lock, call when it changes.
+void FlightRecorder_Annotate(const char* key, const std::string& value);
+
+// Called by the render thread at the start of every frame. The watchdog dumps the recent
+// window when the previous frame took longer than the hitch threshold.
+void FlightRecorder_BeginFrame();
+
+// Starts the watchdog; hitch_ms <= 0 leaves recording on but never dumps on its own.
+// Dumps go to directory as hitch_<run>_<n>.json, the last few of this run are kept.
+void FlightRecorder_StartWatchdog(double hitch_ms, const std::string& directory);
+void FlightRecorder_StopWatchdog();
+
+// Writes the last window_seconds of every thread to path, false when it cannot be written
+bool FlightRecorder_Dump(const std::string& path, double window_seconds, const char* reason);
+
+// Written by FlightRecorder_Dump, 0 while none
+int FlightRecorder_DumpCount();
+
+// Start time and process id (20240131-093005_4242), so dumps of different runs sharing a directory keep apart
+const std::string& FlightRecorder_RunTag();
+
+
+// Records the enclosing scope
+class TraceZone {
+public:
+    explicit TraceZone(const char* name) : name(name), start(FlightRecorder_Now()) {}
+    ~TraceZone() { FlightRecorder_Zone(name, start, FlightRecorder_Now()); }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
@@ -0,0 +1,90 @@
+#include "folder_counts.h"
+#include "image_files.h"
+
+
+bool FolderCounter::Find(const std::string& directory, FolderCount& count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = counts.find(directory);
+    if (it != counts.end()) {
+        count = it->second;
+        return true;
+    }
+    StartWalk(directory);
+    return false;
+}
+
+bool FolderCounter::Subfolders(const std::string& directory, std::vector<std::string>& names) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = subfolders.find(directory);
+    if (it != subfolders.end()) {
+        names = it->second;
+        return true;
+    }
+    StartWalk(directory);
+    return false;
+}
+
+void FolderCounter::StartWalk(const std::string& directory) {
+    if (!walking.insert(directory).second) return;
+    auto node = std::make_shared<Node>();
+    node->path = directory;
+    node->generation = generation;
+    workers.Submit([this, node] { Walk(node); });
+}
+
+void FolderCounter::Invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+    counts.clear();
+    subfolders.clear();
+    walking.clear();
+}
+
+void FolderCounter::Walk(std::shared_ptr<Node> node) {
+    if (node->generation != generation) return;
+
+    FolderListing listing;
+    if (ListFolder(node->path, listing)) {
+        node->count.images = (int)listing.images.size();
+        node->count.folders = (int)listing.folders.size();
+    }
+    folders_listed++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (node->generation == generation) subfolders[node->path] = listing.folders;
+    }
+
+    // Counted before any subfolder can finish, so the folder cannot complete early
+    node->pending += (int)listing.folders.size();
+    for (const std::string& name : listing.folders) {
+        auto child = std::make_shared<Node>();
+        child->path = JoinPath(node->path, name);
+        child->parent = node;
+        child->generation = node->generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            walking.insert(child->path);
+        }
+        workers.Submit([this, child] { Walk(child); });
+    }
+    Complete(std::move(node));
+}
+
+void FolderCounter::Complete(std::shared_ptr<Node> node) {
+    // Walks up as far as this was the last piece missing
+    while (node && --node->pending == 0) {
+        node->count.total_images = node->count.images + node->child_images;
+        node->count.total_folders = node->count.folders + node->child_folders;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (node->generation != generation) return;
+            counts[node->path] = node->count;
+            walking.erase(node->path);
+        }
+        if (node->parent) {
+            node->parent->child_images += node->count.total_images;
+            node->parent->child_folders += node->count.total_folders;
+        }
+        node = node->parent;
+    }
+}
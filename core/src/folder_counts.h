@@ -0,0 +1,78 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Image and folder counts of whole folder trees, computed in the background
+    A walk lists each folder once (ListFolder, no per-entry stat) and runs every subfolder as its own
+    task, so deep shot/take/frame hierarchies spread over all workers. A folder's totals are final
+    once its last subtree reports back; every folder below the one asked for is cached on the way,
+    and so are the subfolder names of each listing, so a tree view never lists a folder itself.
+*/
+
+#pragma once
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+struct FolderCount {
+    int images = 0;             // directly in the folder
+    int folders = 0;
+    int total_images = 0;       // in the folder and every folder below it
+    int total_folders = 0;
+};
+
+
+class FolderCounter {
+public:
+    // thread_count == 0 picks one worker per hardware thread, metadata reads overlap well on SSDs and network shares
+    explicit FolderCounter(size_t thread_count = 0) : workers(thread_count) {}
+    ~FolderCounter() { generation++; }
+
+    FolderCounter(const FolderCounter&) = delete;
+    FolderCounter& operator=(const FolderCounter&) = delete;
+
+    // Counts of directory once its walk finished. The first call starts the walk, unless a walk of
+    // a folder above already covers it.
+    bool Find(const std::string& directory, FolderCount& count);
+
+    // Names of the folders in directory once it was listed, which is long before its counts are final.
+    // Starts a walk like Find.
+    bool Subfolders(const std::string& directory, std::vector<std::string>& names);
+
+    // Forgets every count, walks in flight are dropped; after files were added or moved
+    void Invalidate();
+
+    std::atomic<int> folders_listed{0};
+
+private:
+    struct Node {
+        std::string path;
+        std::shared_ptr<Node> parent;
+        int generation = 0;
+        FolderCount count;
+        std::atomic<int> pending{1};        // own listing plus the subfolders not done yet
+        std::atomic<int> child_images{0};
+        std::atomic<int> child_folders{0};
+    };
+
+    // Called with mutex held
+    void StartWalk(const std::string& directory);
+    void Walk(std::shared_ptr<Node> node);
+    void Complete(std::shared_ptr<Node> node);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, FolderCount> counts;
+    std::unordered_map<std::string, std::vector<std::string>> subfolders;
+    std::unordered_set<std::string> walking;       // queued or waiting for subfolders
+    std::atomic<int> generation{0};
+
+    // Declared last so the workers are joined before the maps they write are destroyed
+    ThreadPool workers;
+};
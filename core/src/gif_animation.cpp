@@ -0,0 +1,332 @@
+#include "gif_animation.h"
+#include "flight_recorder.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+
+AnimationStats animation_stats;
+
+
+static inline int Read16LE(const unsigned char* p) {
+    return p[0] | (p[1] << 8);
+}
+
+// Skips a chain of data sub-blocks, false when it runs past the end
+static bool SkipSubBlocks(const unsigned char* data, size_t size, size_t& pos) {
+    while (pos < size) {
+        size_t length = data[pos++];
+        if (length == 0) return true;
+        pos += length;
+    }
+    return false;
+}
+
+bool GifScan(const unsigned char* data, size_t size, int& width, int& height, std::vector<int>& delays_ms) {
+    delays_ms.clear();
+    if (size < 13 || memcmp(data, "GIF8", 4) != 0) return false;
+    width = Read16LE(data + 6);
+    height = Read16LE(data + 8);
+    size_t pos = 13;
+    if (data[10] & 0x80) pos += 3 << ((data[10] & 7) + 1);   // global color table
+
+    // A graphic control extension applies to the next image only
+    int delay = 0;
+    while (pos < size) {
+        unsigned char block = data[pos++];
+        if (block == 0x3B) break;   // trailer
+
+        if (block == 0x21) {
+            if (pos >= size) break;
+            unsigned char label = data[pos++];
+            if (label == 0xF9 && pos + 5 <= size && data[pos] == 4) {
+                delay = Read16LE(data + pos + 2) * 10;
+            }
+            if (!SkipSubBlocks(data, size, pos)) break;
+        } else if (block == 0x2C) {
+            if (pos + 10 > size) break;
+            unsigned char flags = data[pos + 8];
+            pos += 9;
+            if (flags & 0x80) pos += 3 << ((flags & 7) + 1);    // local color table
+            pos++;  // LZW minimum code size
+            if (!SkipSubBlocks(data, size, pos)) break;     // a truncated last frame is left out
+            delays_ms.push_back(delay);
+            delay = 0;
+        } else {
+            break;
+        }
+    }
+    return width > 0 && height > 0 && !delays_ms.empty();
+}
+
+
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Frame decoding
+
+// Decodes the LZW data sub-blocks at pos into up to pixel_count color indices, pos ends past the
+// block terminator. A corrupt code ends the frame early, the pixels it leaves out stay at index 0.
+// False when the data runs past the end of the file.
+static bool DecodeLZW(const unsigned char* data, size_t size, size_t& pos, int min_code_size,
+                      unsigned char* out, size_t pixel_count) {
+    if (min_code_size < 1 || min_code_size > 11) return false;
+    const int clear = 1 << min_code_size;
+    const int end = clear + 1;
+    uint16_t prefix[4096];
+    unsigned char suffix[4096];
+    unsigned char stack[4097];
+
+    int code_size = min_code_size + 1;
+    int next_code = end + 1;
+    int previous = -1;
+    unsigned char previous_first = 0;
+    uint32_t bits = 0;
+    int bit_count = 0;
+    size_t block_left = 0;
+    size_t written = 0;
+    for (;;) {
+        while (bit_count < code_size) {
+            if (block_left == 0) {
+                if (pos >= size) return false;
+                block_left = data[pos++];
+                if (block_left == 0) return true;   // terminator without an end code
+            }
+            if (pos >= size) return false;
+            bits |= (uint32_t)data[pos++] << bit_count;
+            bit_count += 8;
+            block_left--;
+        }
+        const int code = (int)(bits & ((1u << code_size) - 1));
+        bits >>= code_size;
+        bit_count -= code_size;
+
+        if (code == clear) {
+            code_size = min_code_size + 1;
+            next_code = end + 1;
+            previous = -1;
+            continue;
+        }
+        if (code == end || code > next_code || (code == next_code && previous < 0)) break;
+
+        // The string of a code is read back to front, a code not in the table yet is the previous
+        // string plus its own first color
+        int top = 0;
+        int chain = code;
+        if (code == next_code) {
+            stack[top++] = previous_first;
+            chain = previous;
+        }
+        while (chain >= clear) {
+            stack[top++] = suffix[chain];
+            chain = prefix[chain];
+        }
+        stack[top++] = (unsigned char)chain;
+        const unsigned char first = (unsigned char)chain;
+        while (top > 0 && written < pixel_count) out[written++] = stack[--top];
+
+        if (previous >= 0 && next_code < 4096) {
+            prefix[next_code] = (uint16_t)previous;
+            suffix[next_code] = first;
+            next_code++;
+            if (next_code == (1 << code_size) && code_size < 12) code_size++;
+        }
+        previous = code;
+        previous_first = first;
+    }
+    pos += block_left;
+    return SkipSubBlocks(data, size, pos);
+}
+
+bool GifDecoder::Open(const std::string& file_path) {
+    std::vector<unsigned char> file_data;
+    FILE* file = fopen(file_path.c_str(), "rb");
+    if (!file) return false;
+    unsigned char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        file_data.insert(file_data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    path = file_path;
+    return Open(std::move(file_data));
+}
+
+bool GifDecoder::Open(std::vector<unsigned char> file_data) {
+    data = std::move(file_data);
+    if (!GifScan(data.data(), data.size(), width, height, delays_ms) || delays_ms.size() < 2) return false;
+    // Past this many pixels the canvas alone would take a gigabyte
+    if ((uint64_t)width * height > (1u << 28)) return false;
+
+    first_block = 13;
+    global_palette.clear();
+    if (data[10] & 0x80) {
+        first_block += (size_t)3 << ((data[10] & 7) + 1);
+        if (first_block > data.size()) return false;
+        global_palette.assign(data.begin() + 13, data.begin() + first_block);
+    }
+
+    // Browsers play 0 and 10 ms delays at 100 ms, files made for them rely on it
+    for (int& delay : delays_ms) {
+        if (delay <= 10) delay = 100;
+    }
+    canvas.resize((size_t)width * height * 4);
+    Rewind();
+    return true;
+}
+
+void GifDecoder::Rewind() {
+    pos = first_block;
+    frame_index = -1;
+    std::fill(canvas.begin(), canvas.end(), (unsigned char)0);
+    dispose = 0;
+}
+
+void GifDecoder::Dispose() {
+    if (dispose == 2) {
+        // Restore to background, shown transparent like browsers do
+        for (int y = dispose_y; y < dispose_y + dispose_height; y++) {
+            memset(&canvas[((size_t)y * width + dispose_x) * 4], 0, (size_t)dispose_width * 4);
+        }
+    } else if (dispose == 3) {
+        canvas.swap(previous);
+    }
+    dispose = 0;
+}
+
+bool GifDecoder::Next() {
+    if (frame_index + 1 >= FrameCount()) Rewind();
+    Dispose();
+
+    // Blocks up to the next image, a graphic control extension applies to that image only
+    const size_t size = data.size();
+    int disposal = 0, transparent = -1;
+    for (;;) {
+        if (pos >= size) return false;
+        unsigned char block = data[pos++];
+        if (block == 0x2C) break;
+        if (block != 0x21 || pos >= size) return false;     // the trailer comes after the last frame GifScan found
+        unsigned char label = data[pos++];
+        if (label == 0xF9 && pos + 5 <= size && data[pos] == 4) {
+            disposal = (data[pos + 1] >> 2) & 7;
+            transparent = (data[pos + 1] & 1) ? data[pos + 4] : -1;
+        }
+        if (!SkipSubBlocks(data.data(), size, pos)) return false;
+    }
+
+    if (pos + 10 > size) return false;
+    const int frame_x = Read16LE(&data[pos]);
+    const int frame_y = Read16LE(&data[pos + 2]);
+    const int frame_width = Read16LE(&data[pos + 4]);
+    const int frame_height = Read16LE(&data[pos + 6]);
+    const unsigned char flags = data[pos + 8];
+    pos += 9;
+    const unsigned char* palette = global_palette.data();
+    int palette_colors = (int)global_palette.size() / 3;
+    if (flags & 0x80) {
+        palette_colors = 2 << (flags & 7);
+        if (pos + (size_t)palette_colors * 3 >= size) return false;
+        palette = &data[pos];
+        pos += (size_t)palette_colors * 3;
+    }
+    const int min_code_size = data[pos++];
+    indices.assign((size_t)frame_width * frame_height, 0);
+    if (!DecodeLZW(data.data(), size, pos, min_code_size, indices.data(), indices.size())) return false;
+
+    if (disposal == 3) previous = canvas;
+
+    // Interlaced frames store rows 0, 8, 16.. then 4, 12.. then 2, 6, 10.. then the odd ones
+    static const int pass_start[4] = { 0, 4, 2, 1 };
+    static const int pass_step[4] = { 8, 8, 4, 2 };
+    const bool interlaced = (flags & 0x40) != 0;
+    const int visible_width = std::max(0, std::min(frame_width, width - frame_x));
+    int row = 0;
+    for (int pass = 0; pass < (interlaced ? 4 : 1); pass++) {
+        const int step = interlaced ? pass_step[pass] : 1;
+        for (int y = interlaced ? pass_start[pass] : 0; y < frame_height; y += step, row++) {
+            if (frame_y + y >= height) continue;
+            const unsigned char* src = &indices[(size_t)row * frame_width];
+            unsigned char* dst = &canvas[((size_t)(frame_y + y) * width + frame_x) * 4];
+            for (int x = 0; x < visible_width; x++, dst += 4) {
+                const int index = src[x];
+                if (index == transparent || index >= palette_colors) continue;
+                dst[0] = palette[index * 3 + 0];
+                dst[1] = palette[index * 3 + 1];
+                dst[2] = palette[index * 3 + 2];
+                dst[3] = 255;
+            }
+        }
+    }
+
+    dispose = disposal;
+    dispose_x = std::min(frame_x, width);
+    dispose_y = std::min(frame_y, height);
+    dispose_width = visible_width;
+    dispose_height = std::max(0, std::min(frame_height, height - frame_y));
+    frame_index++;
+    return true;
+}
+
+
+bool GifRing::Reserve(int& slot, int& frame) const {
+    if (count >= slot_count) return false;
+    slot = (head + count) % slot_count;
+    frame = (head_frame + count) % frame_count;
+    return true;
+}
+
+void GifRing::Push() {
+    count++;
+}
+
+int GifRing::Find(int frame) const {
+    for (int ahead = 0; ahead < count; ahead++) {
+        if ((head_frame + ahead) % frame_count == frame) return (head + ahead) % slot_count;
+    }
+    return -1;
+}
+
+void GifRing::Show(int frame) {
+    for (int ahead = 0; ahead < count; ahead++) {
+        if ((head_frame + ahead) % frame_count != frame) continue;
+        head = (head + ahead) % slot_count;
+        head_frame = frame;
+        count -= ahead;
+        return;
+    }
+}
+
+
+bool Gif_LoadFrames(const std::string& path, size_t frame_budget, GifFrames& frames) {
+    GifDecoder decoder;
+    return decoder.Open(path) && Gif_LoadFrames(decoder, frame_budget, frames);
+}
+
+bool Gif_LoadFrames(GifDecoder& decoder, size_t frame_budget, GifFrames& frames) {
+    // Turned down from the frame table, before any pixel is decoded
+    if (decoder.FramesSize() > frame_budget) {
+        animation_stats.over_budget++;
+        return false;
+    }
+
+    TRACE_ZONE("GIF frames");
+    const size_t frame_size = (size_t)decoder.Width() * decoder.Height() * 4;
+    frames.width = decoder.Width();
+    frames.height = decoder.Height();
+    frames.pixels.resize(decoder.FramesSize());
+    for (int i = 0; i < decoder.FrameCount(); i++) {
+        if (!decoder.Next()) {
+            LOG_ERROR("gif", "Failed to decode frame %d of %s", i + 1, decoder.Path().c_str());
+            return false;
+        }
+        memcpy(&frames.pixels[i * frame_size], decoder.Canvas(), frame_size);
+    }
+    frames.delays_ms = decoder.DelaysMs();
+    animation_stats.files_decoded++;
+    animation_stats.frames_decoded += decoder.FrameCount();
+    return true;
+}
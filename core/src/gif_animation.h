@@ -0,0 +1,128 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Animated GIF frames
+    The frame table (count and delays) comes from a scan of the block structure, so the size of the
+    composited frames is known before any pixel is decoded. Frames are decoded one at a time into a
+    single canvas: animations whose frames fit the budget keep all of them, longer ones stream a few
+    frames ahead of playback through a GifRing.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Logical screen size and per-frame delays in ms, without decoding any pixels.
+// False when data is not a GIF or holds no image.
+bool GifScan(const unsigned char* data, size_t size, int& width, int& height, std::vector<int>& delays_ms);
+
+
+// Shared by all animations, the counters are updated by whichever thread decodes
+struct AnimationStats {
+    std::atomic<int> files_decoded{0};
+    std::atomic<int> frames_decoded{0};
+    std::atomic<int> over_budget{0};    // animated files streamed, their frames would not fit the budget
+    std::atomic<int> frames_streamed{0};
+    int dropped_frames = 0;             // render thread: frames never shown because playback fell behind the clock
+    int stream_stalls = 0;              // render thread: streamed frames shown late, the decoder had not caught up
+};
+
+extern AnimationStats animation_stats;
+
+
+// Frame-by-frame decoder. Every frame is composited into the one canvas in turn, so the memory held
+// is a frame or two whatever the length of the animation.
+class GifDecoder {
+public:
+    // Reads path (or takes data) and scans its frame table. False when it is not a GIF with more than one frame.
+    bool Open(const std::string& path);
+    bool Open(std::vector<unsigned char> data);
+
+    const std::string& Path() const { return path; }    // empty when opened on data
+    int Width() const { return width; }
+    int Height() const { return height; }
+    int FrameCount() const { return (int)delays_ms.size(); }
+    const std::vector<int>& DelaysMs() const { return delays_ms; }     // as played, see GifScan for the raw values
+    size_t FramesSize() const { return (size_t)width * height * 4 * delays_ms.size(); }    // every frame composited
+
+    // Composites the next frame into Canvas(), the first one again after the last.
+    // False when the frame does not decode.
+    bool Next();
+
+    int FrameIndex() const { return frame_index; }  // frame in the canvas, -1 before the first Next()
+    const unsigned char* Canvas() const { return canvas.data(); }   // RGBA, Width() x Height()
+
+private:
+    void Rewind();
+    void Dispose();
+
+    std::string path;
+    std::vector<unsigned char> data;
+    int width = 0;
+    int height = 0;
+    std::vector<int> delays_ms;
+    std::vector<unsigned char> global_palette;  // RGB triplets, empty without a global color table
+    size_t first_block = 0;     // just past the global color table
+    size_t pos = 0;             // next block to read
+
+    int frame_index = -1;
+    std::vector<unsigned char> canvas;
+    std::vector<unsigned char> previous;    // canvas before a frame disposed by restoring it
+    std::vector<unsigned char> indices;     // color indices of the frame being decoded
+
+    // How the frame in the canvas goes away before the next one is drawn (GIF disposal method)
+    int dispose = 0;
+    int dispose_x = 0, dispose_y = 0, dispose_width = 0, dispose_height = 0;
+};
+
+
+// Which frames of a streamed animation sit in a ring of slot_count slots. Frames go in in playback
+// order, back to frame 0 after the last one, and leave once playback has moved past them, so the
+// frame on screen plus slot_count - 1 frames ahead are kept. The slots themselves (pixels, textures)
+// belong to the caller. Not thread safe.
+class GifRing {
+public:
+    GifRing(int frame_count = 0, int slot_count = 0) : frame_count(frame_count), slot_count(slot_count) {}
+
+    int SlotCount() const { return slot_count; }
+
+    // Producer: the slot and frame to decode next, false while every slot holds a frame not played yet.
+    // The slot stays reserved through calls to Show.
+    bool Reserve(int& slot, int& frame) const;
+    void Push();    // the reserved frame is in its slot
+
+    // Consumer: the slot holding frame, -1 while it is not decoded
+    int Find(int frame) const;
+    // Consumer: frame is on screen, the frames before it leave the ring and their slots are reused
+    void Show(int frame);
+
+private:
+    int frame_count;
+    int slot_count;
+    int head = 0;           // slot of the oldest frame kept, the one on screen
+    int head_frame = 0;
+    int count = 0;
+};
+
+
+struct GifFrames {
+    int width = 0;
+    int height = 0;
+    std::vector<int> delays_ms;
+    std::vector<unsigned char> pixels;  // every composited RGBA frame, back to back
+
+    int FrameCount() const { return (int)delays_ms.size(); }
+    const unsigned char* Frame(int index) const { return pixels.data() + (size_t)index * width * height * 4; }
+};
+
+// Reads path and decodes all of its frames. False when it is not a GIF with more than one frame,
+// its frames would take more than frame_budget bytes or it does not decode.
+bool Gif_LoadFrames(const std::string& path, size_t frame_budget, GifFrames& frames);
+
+// Same from a decoder opened and not stepped yet, which is left at its first frame when the
+// frames are over the budget, ready to stream
+bool Gif_LoadFrames(GifDecoder& decoder, size_t frame_budget, GifFrames& frames);
@@ -0,0 +1,362 @@
+#include "icc_profile.h"
+
+#include "stb_image.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+static const size_t ICC_HEADER_SIZE = 128;
+
+// Encoded values resolved per display channel when inverting its tone curves
+static const int INVERSE_CURVE_SIZE = 4096;
+
+
+static uint32_t ReadBE32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint16_t ReadBE16(const unsigned char* p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static float ReadS15Fixed16(const unsigned char* p) {
+    return (int32_t)ReadBE32(p) / 65536.0f;
+}
+
+static uint64_t HashBytes(const unsigned char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+float ToneCurve::Evaluate(float x) const {
+    x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    if (type == Type::Gamma) {
+        return powf(x, params[0]);
+    }
+    if (type == Type::Table) {
+        float position = x * (table.size() - 1);
+        size_t index = (size_t)position;
+        if (index + 1 >= table.size()) return table.back();
+        float t = position - index;
+        return table[index] + (table[index + 1] - table[index]) * t;
+    }
+
+    const float g = params[0], a = params[1], b = params[2], c = params[3], d = params[4], e = params[5], f = params[6];
+    auto power = [g](float base) { return base > 0.0f ? powf(base, g) : 0.0f; };
+    switch (function) {
+        case 0: return power(x);
+        case 1: return x >= -b / a ? power(a * x + b) : 0.0f;
+        case 2: return x >= -b / a ? power(a * x + b) + c : c;
+        case 3: return x >= d ? power(a * x + b) : c * x;
+        default: return x >= d ? power(a * x + b) + e : c * x + f;
+    }
+}
+
+
+// Tag of type curv or para at data[0, size)
+static bool ParseCurve(const unsigned char* data, size_t size, ToneCurve& curve) {
+    if (size < 12) return false;
+    if (memcmp(data, "curv", 4) == 0) {
+        uint32_t count = ReadBE32(data + 8);
+        if (size < 12 + (size_t)count * 2) return false;
+        if (count == 0) {
+            curve.type = ToneCurve::Type::Gamma;
+            curve.params[0] = 1.0f;
+        } else if (count == 1) {
+            curve.type = ToneCurve::Type::Gamma;
+            curve.params[0] = ReadBE16(data + 12) / 256.0f;
+        } else {
+            curve.type = ToneCurve::Type::Table;
+            curve.table.resize(count);
+            for (uint32_t i = 0; i < count; i++) {
+                curve.table[i] = ReadBE16(data + 12 + i * 2) / 65535.0f;
+            }
+        }
+        return true;
+    }
+    if (memcmp(data, "para", 4) == 0) {
+        static const int PARAM_COUNTS[5] = { 1, 3, 4, 5, 7 };
+        int function = ReadBE16(data + 8);
+        if (function > 4 || size < 12 + (size_t)PARAM_COUNTS[function] * 4) return false;
+        curve.type = ToneCurve::Type::Parametric;
+        curve.function = function;
+        for (int i = 0; i < PARAM_COUNTS[function]; i++) {
+            curve.params[i] = ReadS15Fixed16(data + 12 + i * 4);
+        }
+        // a = 0 would divide by zero in the -b/a thresholds
+        return (function != 1 && function != 2) || curve.params[1] != 0.0f;
+    }
+    return false;
+}
+
+// desc (v2) or mluc (v4) tag, first record only
+static std::string ParseDescription(const unsigned char* data, size_t size) {
+    std::string text;
+    if (size >= 12 && memcmp(data, "desc", 4) == 0) {
+        uint32_t count = ReadBE32(data + 8);
+        if (count > 0 && 12 + (size_t)count <= size) text.assign((const char*)data + 12, strnlen((const char*)data + 12, count));
+    } else if (size >= 28 && memcmp(data, "mluc", 4) == 0) {
+        uint32_t length = ReadBE32(data + 20);
+        uint32_t offset = ReadBE32(data + 24);
+        if ((size_t)offset + length <= size) {
+            // UTF-16BE, anything outside ASCII becomes '?'
+            for (uint32_t i = 0; i + 1 < length; i += 2) {
+                uint16_t unit = ReadBE16(data + offset + i);
+                if (unit == 0) break;
+                text.push_back(unit < 128 ? (char)unit : '?');
+            }
+        }
+    }
+    return text;
+}
+
+bool IccProfile_Parse(const unsigned char* data, size_t size, IccProfile& profile) {
+    profile = IccProfile();
+    if (size < ICC_HEADER_SIZE + 4 || memcmp(data + 36, "acsp", 4) != 0) return false;
+    if (memcmp(data + 16, "RGB ", 4) != 0 || memcmp(data + 20, "XYZ ", 4) != 0) return false;
+
+    static const char* const COLORANT_TAGS[3] = { "rXYZ", "gXYZ", "bXYZ" };
+    static const char* const CURVE_TAGS[3] = { "rTRC", "gTRC", "bTRC" };
+    int found = 0;  // one bit per required tag
+
+    uint32_t tag_count = ReadBE32(data + ICC_HEADER_SIZE);
+    for (uint32_t i = 0; i < tag_count; i++) {
+        size_t entry = ICC_HEADER_SIZE + 4 + (size_t)i * 12;
+        if (entry + 12 > size) return false;
+        const unsigned char* signature = data + entry;
+        size_t offset = ReadBE32(data + entry + 4);
+        size_t length = ReadBE32(data + entry + 8);
+        if (offset > size || length > size - offset) continue;
+        const unsigned char* tag = data + offset;
+
+        for (int channel = 0; channel < 3; channel++) {
+            if (memcmp(signature, COLORANT_TAGS[channel], 4) == 0 && length >= 20 && memcmp(tag, "XYZ ", 4) == 0) {
+                for (int row = 0; row < 3; row++) {
+                    profile.to_xyz[row * 3 + channel] = ReadS15Fixed16(tag + 8 + row * 4);
+                }
+                found |= 1 << channel;
+            } else if (memcmp(signature, CURVE_TAGS[channel], 4) == 0 && ParseCurve(tag, length, profile.curves[channel])) {
+                found |= 8 << channel;
+            }
+        }
+        if (memcmp(signature, "desc", 4) == 0) {
+            profile.description = ParseDescription(tag, length);
+        }
+    }
+    if (found != 63) return false;
+
+    profile.hash = HashBytes(data, size);
+    return true;
+}
+
+bool IccProfile_Load(const std::string& path, IccProfile& profile) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<unsigned char> data;
+    unsigned char buffer[16384];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return IccProfile_Parse(data.data(), data.size(), profile);
+}
+
+
+// iCCP chunk: profile name, NUL, compression method 0, zlib stream
+static bool ExtractPNG(const unsigned char* data, size_t size, std::vector<unsigned char>& icc) {
+    size_t pos = 8;
+    while (pos + 12 <= size) {
+        size_t length = ReadBE32(data + pos);
+        const unsigned char* type = data + pos + 4;
+        const unsigned char* chunk = data + pos + 8;
+        if (length > size - pos - 12) return false;
+        if (memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0) return false;   // must come before the image data
+
+        if (memcmp(type, "iCCP", 4) == 0) {
+            const unsigned char* name_end = (const unsigned char*)memchr(chunk, 0, length < 80 ? length : 80);
+            if (!name_end || name_end + 2 > chunk + length || name_end[1] != 0) return false;
+            const unsigned char* stream = name_end + 2;
+            int inflated_size = 0;
+            char* inflated = stbi_zlib_decode_malloc((const char*)stream, (int)(chunk + length - stream), &inflated_size);
+            if (!inflated) return false;
+            icc.assign((unsigned char*)inflated, (unsigned char*)inflated + inflated_size);
+            free(inflated);
+            return true;
+        }
+        pos += length + 12;
+    }
+    return false;
+}
+
+// APP2 segments: "ICC_PROFILE\0", sequence number from 1, segment count, then a slice of the profile
+static bool ExtractJPEG(const unsigned char* data, size_t size, std::vector<unsigned char>& icc) {
+    std::vector<std::vector<unsigned char>> slices;
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        unsigned char marker = data[pos + 1];
+        size_t length = (size_t)(data[pos + 2] << 8 | data[pos + 3]);
+        if (marker == 0xDA || marker == 0xD9 || length < 2 || pos + 2 + length > size) break;
+
+        const unsigned char* segment = data + pos + 4;
+        if (marker == 0xE2 && length >= 16 && memcmp(segment, "ICC_PROFILE\0", 12) == 0) {
+            int sequence = segment[12];
+            int count = segment[13];
+            if (count == 0 || sequence == 0 || sequence > count) return false;
+            slices.resize(count);
+            slices[sequence - 1].assign(segment + 14, segment + length - 2);
+        }
+        pos += 2 + length;
+    }
+    if (slices.empty()) return false;
+
+    icc.clear();
+    for (const std::vector<unsigned char>& slice : slices) {
+        if (slice.empty()) return false;    // a segment is missing
+        icc.insert(icc.end(), slice.begin(), slice.end());
+    }
+    return true;
+}
+
+std::shared_ptr<const IccProfile> IccProfile_FromImage(const unsigned char* data, size_t size) {
+    std::vector<unsigned char> icc;
+    bool found = false;
+    if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        found = ExtractPNG(data, size, icc);
+    } else if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8) {
+        found = ExtractJPEG(data, size, icc);
+    }
+    if (!found) return nullptr;
+
+    auto profile = std::make_shared<IccProfile>();
+    if (!IccProfile_Parse(icc.data(), icc.size(), *profile)) return nullptr;
+    return profile;
+}
+
+const IccProfile& IccProfile_SRGB() {
+    static const IccProfile srgb = [] {
+        IccProfile profile;
+        profile.description = "sRGB IEC61966-2.1 (built in)";
+        // Colorants adapted to D50, as in the ICC's sRGB profile
+        const float to_xyz[9] = {
+            0.4360747f, 0.3850649f, 0.1430804f,
+            0.2225045f, 0.7168786f, 0.0606169f,
+            0.0139322f, 0.0971045f, 0.7141733f,
+        };
+        memcpy(profile.to_xyz, to_xyz, sizeof(to_xyz));
+        for (ToneCurve& curve : profile.curves) {
+            curve.type = ToneCurve::Type::Parametric;
+            curve.function = 3;
+            const float params[7] = { 2.4f, 1.0f / 1.055f, 0.055f / 1.055f, 1.0f / 12.92f, 0.04045f, 0.0f, 0.0f };
+            memcpy(curve.params, params, sizeof(params));
+        }
+        profile.hash = HashBytes((const unsigned char*)profile.description.data(), profile.description.size());
+        return profile;
+    }();
+    return srgb;
+}
+
+
+static bool Invert3x3(const float m[9], float inverse[9]) {
+    float cofactors[9] = {
+        m[4] * m[8] - m[5] * m[7], m[2] * m[7] - m[1] * m[8], m[1] * m[5] - m[2] * m[4],
+        m[5] * m[6] - m[3] * m[8], m[0] * m[8] - m[2] * m[6], m[2] * m[3] - m[0] * m[5],
+        m[3] * m[7] - m[4] * m[6], m[1] * m[6] - m[0] * m[7], m[0] * m[4] - m[1] * m[3],
+    };
+    float determinant = m[0] * cofactors[0] + m[1] * cofactors[3] + m[2] * cofactors[6];
+    if (fabsf(determinant) < 1e-9f) return false;
+    for (int i = 0; i < 9; i++) {
+        inverse[i] = cofactors[i] / determinant;
+    }
+    return true;
+}
+
+// Encoded value whose curve output is each of INVERSE_CURVE_SIZE evenly spaced linear values,
+// by bisection, so any monotonic curve type works
+static std::vector<float> InvertCurve(const ToneCurve& curve) {
+    std::vector<float> inverse(INVERSE_CURVE_SIZE);
+    bool rising = curve.Evaluate(1.0f) >= curve.Evaluate(0.0f);
+    for (int i = 0; i < INVERSE_CURVE_SIZE; i++) {
+        float target = (float)i / (INVERSE_CURVE_SIZE - 1);
+        float low = 0.0f, high = 1.0f;
+        for (int step = 0; step < 24; step++) {
+            float middle = 0.5f * (low + high);
+            if ((curve.Evaluate(middle) < target) == rising) low = middle;
+            else high = middle;
+        }
+        inverse[i] = 0.5f * (low + high);
+    }
+    return inverse;
+}
+
+static float LookupInverse(const std::vector<float>& inverse, float y) {
+    y = y < 0.0f ? 0.0f : (y > 1.0f ? 1.0f : y);
+    float position = y * (INVERSE_CURVE_SIZE - 1);
+    int index = (int)position;
+    if (index >= INVERSE_CURVE_SIZE - 1) return inverse.back();
+    float t = position - index;
+    return inverse[index] + (inverse[index + 1] - inverse[index]) * t;
+}
+
+bool IccProfile_BakeLut(const IccProfile& source, const IccProfile& display, int size, std::vector<uint16_t>& lut) {
+    lut.clear();
+    float from_xyz[9];
+    if (size < 2 || !Invert3x3(display.to_xyz, from_xyz)) return false;
+
+    // Source RGB -> PCS -> display RGB in one matrix
+    float m[9];
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            m[row * 3 + column] = from_xyz[row * 3 + 0] * source.to_xyz[0 * 3 + column] +
+                                  from_xyz[row * 3 + 1] * source.to_xyz[1 * 3 + column] +
+                                  from_xyz[row * 3 + 2] * source.to_xyz[2 * 3 + column];
+        }
+    }
+
+    // Every lattice axis has the same encoded values, linearize them once per channel
+    std::vector<float> linear[3];
+    for (int channel = 0; channel < 3; channel++) {
+        linear[channel].resize(size);
+        for (int i = 0; i < size; i++) {
+            linear[channel][i] = source.curves[channel].Evaluate((float)i / (size - 1));
+        }
+    }
+    std::vector<float> inverse[3];
+    for (int channel = 0; channel < 3; channel++) {
+        inverse[channel] = InvertCurve(display.curves[channel]);
+    }
+
+    lut.resize((size_t)size * size * size * 4);
+    float max_error = 0.0f;
+    uint16_t* out = lut.data();
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++, out += 4) {
+                const int grid[3] = { r, g, b };
+                const float rgb[3] = { linear[0][r], linear[1][g], linear[2][b] };
+                for (int channel = 0; channel < 3; channel++) {
+                    float value = m[channel * 3 + 0] * rgb[0] + m[channel * 3 + 1] * rgb[1] + m[channel * 3 + 2] * rgb[2];
+                    float encoded = LookupInverse(inverse[channel], value);
+                    out[channel] = (uint16_t)lrintf(encoded * 65535.0f);
+                    max_error = fmaxf(max_error, fabsf(encoded - (float)grid[channel] / (size - 1)));
+                }
+                out[3] = 65535;
+            }
+        }
+    }
+
+    // Within half a step of 8-bit output everywhere, drawing through the LUT would change nothing
+    if (max_error < 0.5f / 255.0f) {
+        lut.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    ICC color profiles of images and the display
+    Matrix/TRC RGB profiles (sRGB, Display P3, Adobe RGB, ProPhoto and most camera and
+    monitor profiles) are read: three colorant XYZ values and three tone curves.
+    Profiles built from LUTs only (A2B0 without the matrix tags) are not supported, those
+    images are shown as sRGB.
+    A source -> display transform is baked into a 3D lattice the GPU samples per pixel,
+    so the conversion costs nothing on the CPU per image.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// curv or para tag, maps encoded [0, 1] to linear [0, 1]
+struct ToneCurve {
+    enum class Type : uint8_t { Gamma, Table, Parametric };
+
+    float Evaluate(float x) const;
+
+    Type type = Type::Gamma;
+    int function = 0;           // para function type 0-4
+    float params[7] = { 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };    // g a b c d e f, gamma alone for Type::Gamma
+    std::vector<float> table;
+};
+
+struct IccProfile {
+    std::string description;
+    float to_xyz[9] = {};       // row major, linear RGB -> PCS XYZ (D50)
+    ToneCurve curves[3];
+    uint64_t hash = 0;          // of the profile bytes, identifies the profile in LUT caches
+};
+
+// Parses an ICC profile. False when it is not an RGB matrix/TRC profile.
+bool IccProfile_Parse(const unsigned char* data, size_t size, IccProfile& profile);
+
+// Reads an .icc/.icm file
+bool IccProfile_Load(const std::string& path, IccProfile& profile);
+
+// Profile embedded in a PNG (iCCP chunk) or JPEG (APP2 ICC_PROFILE segments) held in memory.
+// nullptr when the file has none or it cannot be used.
+std::shared_ptr<const IccProfile> IccProfile_FromImage(const unsigned char* data, size_t size);
+
+// sRGB IEC61966-2.1, assumed for untagged images and as the display profile unless one is given
+const IccProfile& IccProfile_SRGB();
+
+// Bakes source -> display into a size^3 lattice of RGBA16, red varying fastest. Out of gamut colors are clipped.
+// False when the transform is the identity at 8 bits per channel, then no LUT is needed.
+bool IccProfile_BakeLut(const IccProfile& source, const IccProfile& display, int size, std::vector<uint16_t>& lut);
@@ -0,0 +1,139 @@
+#include "image_files.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool IsImageFile(const std::string& path) {
+    return EndsWith(path, ".png") || EndsWith(path, ".jpg") || EndsWith(path, ".jpeg") || EndsWith(path, ".gif");
+}
+
+std::vector<std::string> GetImageFiles(const std::string& directory) {
+    std::vector<std::string> image_files;
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error), end;
+    for (; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error)) {
+            std::string path = it->path().string();
+            if (IsImageFile(path)) {
+                image_files.push_back(path);
+            }
+        }
+    }
+    return image_files;
+}
+
+std::vector<std::string> GetImageFilesRecursive(const std::string& directory) {
+    std::vector<std::string> image_files;
+    std::vector<std::string> pending = { directory };
+    FolderListing listing;
+    while (!pending.empty()) {
+        // An unreadable folder skips that folder, not the rest of the walk
+        std::string folder = std::move(pending.back());
+        pending.pop_back();
+        if (!ListFolder(folder, listing)) continue;
+        for (const std::string& name : listing.images) {
+            image_files.push_back(JoinPath(folder, name));
+        }
+        for (const std::string& name : listing.folders) {
+            pending.push_back(JoinPath(folder, name));
+        }
+    }
+    std::sort(image_files.begin(), image_files.end());
+    return image_files;
+}
+
+std::string JoinPath(const std::string& directory, const std::string& name) {
+    if (directory.empty() || directory.back() == '/' || directory.back() == '\\') return directory + name;
+    return directory + "/" + name;
+}
+
+#if defined(__linux__)
+
+// Layout the kernel fills in, glibc only declares it for its own readdir
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+bool ListFolder(const std::string& directory, FolderListing& listing) {
+    listing.folders.clear();
+    listing.images.clear();
+    int fd = openat(AT_FDCWD, directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    // One syscall returns as many entries as fit, 32 KB holds several hundred
+    alignas(8) char buffer[32768];
+    for (;;) {
+        long size = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (size <= 0) break;
+        for (long offset = 0; offset < size;) {
+            const LinuxDirent64* entry = (const LinuxDirent64*)(buffer + offset);
+            offset += entry->d_reclen;
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if (type == DT_DIR) {
+                listing.folders.push_back(name);
+            } else if ((type == DT_REG || type == DT_LNK) && IsImageFile(name)) {
+                // A link counts when it leads to a regular file, like is_regular_file()
+                struct stat st;
+                if (type == DT_REG || (fstatat(fd, name, &st, 0) == 0 && S_ISREG(st.st_mode))) {
+                    listing.images.push_back(name);
+                }
+            }
+        }
+    }
+    close(fd);
+    std::sort(listing.folders.begin(), listing.folders.end());
+    std::sort(listing.images.begin(), listing.images.end());
+    return true;
+}
+
+#else
+
+bool ListFolder(const std::string& directory, FolderListing& listing) {
+    listing.folders.clear();
+    listing.images.clear();
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error), end;
+    if (error) return false;
+    for (; !error && it != end; it.increment(error)) {
+        std::error_code entry_error;
+        std::string name = it->path().filename().string();
+        if (it->is_directory(entry_error) && !it->is_symlink(entry_error)) {
+            listing.folders.push_back(name);
+        } else if (it->is_regular_file(entry_error) && IsImageFile(name)) {
+            listing.images.push_back(name);
+        }
+    }
+    std::sort(listing.folders.begin(), listing.folders.end());
+    std::sort(listing.images.begin(), listing.images.end());
+    return true;
+}
+
+#endif
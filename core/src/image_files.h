@@ -0,0 +1,36 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Image files of a folder
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// Utility function to check if a string ends with a specific suffix
+bool EndsWith(const std::string& str, const std::string& suffix);
+
+// True for the extensions the pipeline decodes (png, jpg, jpeg, gif)
+bool IsImageFile(const std::string& path);
+
+// Function to scan the directory and get a list of image files, empty when it cannot be read
+std::vector<std::string> GetImageFiles(const std::string& directory);
+
+// Same for directory and every folder below it, sorted. Symlinked folders are not followed.
+std::vector<std::string> GetImageFilesRecursive(const std::string& directory);
+
+// Names in one folder, each list sorted. On Linux the entries come from getdents64 and their d_type,
+// so only symlinks and file systems that report no type cost a stat.
+struct FolderListing {
+    std::vector<std::string> folders;   // symlinked folders and "." / ".." left out
+    std::vector<std::string> images;
+};
+
+// False when directory cannot be opened
+bool ListFolder(const std::string& directory, FolderListing& listing);
+
+// directory + "/" + name, without doubling a trailing separator
+std::string JoinPath(const std::string& directory, const std::string& name);
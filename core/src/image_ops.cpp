@@ -0,0 +1,80 @@
+#include "image_ops.h"
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+void FitInside(int width, int height, int max_side, int& out_width, int& out_height) {
+    if (width <= max_side && height <= max_side) {
+        out_width = width;
+        out_height = height;
+    } else if (width >= height) {
+        out_width = max_side;
+        out_height = std::max(1, (int)((long long)height * max_side / width));
+    } else {
+        out_height = max_side;
+        out_width = std::max(1, (int)((long long)width * max_side / height));
+    }
+}
+
+void DownscaleBox(const unsigned char* src, int src_width, int src_height,
+                  unsigned char* dst, int dst_width, int dst_height) {
+    CpuDispatch_Kernels().downscale_box(src, src_width, src_height, dst, dst_width, dst_height);
+}
+
+void DownscaleBox_Scalar(const unsigned char* src, int src_width, int src_height,
+                         unsigned char* dst, int dst_width, int dst_height) {
+    for (int dy = 0; dy < dst_height; dy++) {
+        int y0 = (int)((long long)dy * src_height / dst_height);
+        int y1 = std::max(y0 + 1, (int)((long long)(dy + 1) * src_height / dst_height));
+        for (int dx = 0; dx < dst_width; dx++) {
+            int x0 = (int)((long long)dx * src_width / dst_width);
+            int x1 = std::max(x0 + 1, (int)((long long)(dx + 1) * src_width / dst_width));
+
+            unsigned int sum[4] = { 0, 0, 0, 0 };
+            for (int y = y0; y < y1; y++) {
+                const unsigned char* row = src + ((size_t)y * src_width + x0) * 4;
+                for (int x = x0; x < x1; x++, row += 4) {
+                    sum[0] += row[0];
+                    sum[1] += row[1];
+                    sum[2] += row[2];
+                    sum[3] += row[3];
+                }
+            }
+            unsigned int count = (unsigned int)((y1 - y0) * (x1 - x0));
+            unsigned char* out = dst + ((size_t)dy * dst_width + dx) * 4;
+            for (int c = 0; c < 4; c++) {
+                out[c] = (unsigned char)((sum[c] + count / 2) / count);
+            }
+        }
+    }
+}
+
+void ApplyOrientation(const unsigned char* src, int width, int height, int orientation, unsigned char* dst) {
+    // Source pixel of destination (dx, dy) is origin + dx * step_x + dy * step_y
+    ptrdiff_t w = width, last_row = (ptrdiff_t)(height - 1) * width;
+    ptrdiff_t origin, step_x, step_y;
+    switch (orientation) {
+        case 2: origin = w - 1;             step_x = -1; step_y = w;  break;   // mirrored
+        case 3: origin = last_row + w - 1;  step_x = -1; step_y = -w; break;   // upside down
+        case 4: origin = last_row;          step_x = 1;  step_y = -w; break;   // flipped
+        case 5: origin = 0;                 step_x = w;  step_y = 1;  break;   // transposed
+        case 6: origin = last_row;          step_x = -w; step_y = 1;  break;   // turned 90 CW to show
+        case 7: origin = last_row + w - 1;  step_x = -w; step_y = -1; break;   // transversed
+        case 8: origin = w - 1;             step_x = w;  step_y = -1; break;   // turned 90 CCW to show
+        default: origin = 0;                step_x = 1;  step_y = w;  break;
+    }
+
+    const uint32_t* in = (const uint32_t*)src;
+    uint32_t* out = (uint32_t*)dst;
+    int dst_width = OrientationSwapsAxes(orientation) ? height : width;
+    int dst_height = OrientationSwapsAxes(orientation) ? width : height;
+    for (int dy = 0; dy < dst_height; dy++) {
+        const uint32_t* row = in + origin + dy * step_y;
+        for (int dx = 0; dx < dst_width; dx++, row += step_x) {
+            *out++ = *row;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    CPU pixel operations on 8-bit RGBA images
+*/
+
+#pragma once
+
+
+// Largest side of the thumbnails kept for previews
+constexpr int THUMBNAIL_SIZE = 128;
+
+// Largest side of the mid-resolution previews shown while a file's full decode is in flight
+constexpr int PREVIEW_SIZE = 1024;
+
+// Fits width x height inside max_side keeping the aspect ratio, never upscales
+void FitInside(int width, int height, int max_side, int& out_width, int& out_height);
+
+// Box filter downscale, every destination pixel averages the source pixels it covers.
+// Runs the kernel picked by CpuDispatch_Kernels().
+void DownscaleBox(const unsigned char* src, int src_width, int src_height,
+                  unsigned char* dst, int dst_width, int dst_height);
+
+// True for the EXIF orientations (5-8) that swap width and height
+inline bool OrientationSwapsAxes(int orientation) { return orientation >= 5 && orientation <= 8; }
+
+// Writes src turned upright for an EXIF orientation, dst is height x width when the axes swap
+void ApplyOrientation(const unsigned char* src, int width, int height, int orientation, unsigned char* dst);
+
+
+// Per instruction set variants of DownscaleBox, all give the same bytes. The SIMD ones
+// (image_ops_simd.cpp) add whole source rows into column sums, then sum the columns of a box.
+void DownscaleBox_Scalar(const unsigned char* src, int src_width, int src_height,
+                         unsigned char* dst, int dst_width, int dst_height);
+void DownscaleBox_SSE2(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height);
+void DownscaleBox_AVX2(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height);
+void DownscaleBox_AVX512(const unsigned char* src, int src_width, int src_height,
+                         unsigned char* dst, int dst_width, int dst_height);
+void DownscaleBox_NEON(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height);
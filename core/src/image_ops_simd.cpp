@@ -0,0 +1,179 @@
+#include "image_ops.h"
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(CPU_DISPATCH_X86)
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(CPU_DISPATCH_NEON)
+#include <arm_neon.h>
+#endif
+
+
+#if defined(CPU_DISPATCH_X86) || defined(CPU_DISPATCH_NEON)
+
+// sums[i] = sum of rows[r * stride + i] over row_count rows, for count bytes
+typedef void (*SumRowsFn)(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t count);
+
+static inline void SumRowsTail(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; i++) {
+        uint32_t sum = 0;
+        for (int r = 0; r < row_count; r++) sum += rows[r * stride + i];
+        sums[i] = sum;
+    }
+}
+
+// Sum of the column sums x0..x1 written as one rounded RGBA pixel, same rounding as the scalar kernel
+static inline void ResolvePixel(const uint32_t* sums, int x0, int x1, unsigned int count, unsigned char* out) {
+    alignas(16) uint32_t total[4];
+#if defined(CPU_DISPATCH_X86)
+    __m128i acc = _mm_setzero_si128();
+    for (int x = x0; x < x1; x++) {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i*)(sums + (size_t)x * 4)));
+    }
+    _mm_store_si128((__m128i*)total, acc);
+#else
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (int x = x0; x < x1; x++) {
+        acc = vaddq_u32(acc, vld1q_u32(sums + (size_t)x * 4));
+    }
+    vst1q_u32(total, acc);
+#endif
+    for (int c = 0; c < 4; c++) {
+        out[c] = (unsigned char)((total[c] + count / 2) / count);
+    }
+}
+
+// Column sums over the source rows of a destination row are kept in registers while walking
+// down the rows, so each is stored once. Each box then only adds up x1 - x0 column sums.
+static void DownscaleBoxColumns(SumRowsFn sum_rows, const unsigned char* src, int src_width, int src_height,
+                                unsigned char* dst, int dst_width, int dst_height) {
+    const size_t row_bytes = (size_t)src_width * 4;
+    std::vector<uint32_t> sums(row_bytes);
+    for (int dy = 0; dy < dst_height; dy++) {
+        int y0 = (int)((long long)dy * src_height / dst_height);
+        int y1 = std::max(y0 + 1, (int)((long long)(dy + 1) * src_height / dst_height));
+        sum_rows(src + (size_t)y0 * row_bytes, row_bytes, y1 - y0, sums.data(), row_bytes);
+        unsigned char* out = dst + (size_t)dy * dst_width * 4;
+        for (int dx = 0; dx < dst_width; dx++, out += 4) {
+            int x0 = (int)((long long)dx * src_width / dst_width);
+            int x1 = std::max(x0 + 1, (int)((long long)(dx + 1) * src_width / dst_width));
+            ResolvePixel(sums.data(), x0, x1, (unsigned int)((y1 - y0) * (x1 - x0)), out);
+        }
+    }
+}
+
+#endif
+
+
+#if defined(CPU_DISPATCH_X86)
+
+// SSE2 is part of x86-64, no target attribute needed
+static void SumRows_SSE2(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        const unsigned char* row = rows + i;
+        for (int r = 0; r < row_count; r++, row += stride) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)row);
+            __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            __m128i high = _mm_unpackhi_epi8(bytes, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(low, zero));
+            acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(low, zero));
+            acc2 = _mm_add_epi32(acc2, _mm_unpacklo_epi16(high, zero));
+            acc3 = _mm_add_epi32(acc3, _mm_unpackhi_epi16(high, zero));
+        }
+        __m128i* out = (__m128i*)(sums + i);
+        _mm_storeu_si128(out + 0, acc0);
+        _mm_storeu_si128(out + 1, acc1);
+        _mm_storeu_si128(out + 2, acc2);
+        _mm_storeu_si128(out + 3, acc3);
+    }
+    SumRowsTail(rows, stride, row_count, sums, i, count);
+}
+
+TARGET_AVX2 static void SumRows_AVX2(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i acc[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+        const unsigned char* row = rows + i;
+        for (int r = 0; r < row_count; r++, row += stride) {
+            for (int k = 0; k < 4; k++) {
+                acc[k] = _mm256_add_epi32(acc[k], _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row + k * 8))));
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            _mm256_storeu_si256((__m256i*)(sums + i + k * 8), acc[k]);
+        }
+    }
+    SumRowsTail(rows, stride, row_count, sums, i, count);
+}
+
+TARGET_AVX512 static void SumRows_AVX512(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t count) {
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i acc[4] = { _mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512() };
+        const unsigned char* row = rows + i;
+        for (int r = 0; r < row_count; r++, row += stride) {
+            for (int k = 0; k < 4; k++) {
+                acc[k] = _mm512_add_epi32(acc[k], _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(row + k * 16))));
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            _mm512_storeu_si512(sums + i + k * 16, acc[k]);
+        }
+    }
+    SumRowsTail(rows, stride, row_count, sums, i, count);
+}
+
+void DownscaleBox_SSE2(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height) {
+    DownscaleBoxColumns(SumRows_SSE2, src, src_width, src_height, dst, dst_width, dst_height);
+}
+
+void DownscaleBox_AVX2(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height) {
+    DownscaleBoxColumns(SumRows_AVX2, src, src_width, src_height, dst, dst_width, dst_height);
+}
+
+void DownscaleBox_AVX512(const unsigned char* src, int src_width, int src_height,
+                         unsigned char* dst, int dst_width, int dst_height) {
+    DownscaleBoxColumns(SumRows_AVX512, src, src_width, src_height, dst, dst_width, dst_height);
+}
+
+#elif defined(CPU_DISPATCH_NEON)
+
+static void SumRows_NEON(const unsigned char* rows, size_t stride, int row_count, uint32_t* sums, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint32x4_t acc0 = vdupq_n_u32(0), acc1 = vdupq_n_u32(0), acc2 = vdupq_n_u32(0), acc3 = vdupq_n_u32(0);
+        const unsigned char* row = rows + i;
+        for (int r = 0; r < row_count; r++, row += stride) {
+            uint8x16_t bytes = vld1q_u8(row);
+            uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+            uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+            acc0 = vaddw_u16(acc0, vget_low_u16(low));
+            acc1 = vaddw_u16(acc1, vget_high_u16(low));
+            acc2 = vaddw_u16(acc2, vget_low_u16(high));
+            acc3 = vaddw_u16(acc3, vget_high_u16(high));
+        }
+        vst1q_u32(sums + i + 0, acc0);
+        vst1q_u32(sums + i + 4, acc1);
+        vst1q_u32(sums + i + 8, acc2);
+        vst1q_u32(sums + i + 12, acc3);
+    }
+    SumRowsTail(rows, stride, row_count, sums, i, count);
+}
+
+void DownscaleBox_NEON(const unsigned char* src, int src_width, int src_height,
+                       unsigned char* dst, int dst_width, int dst_height) {
+    DownscaleBoxColumns(SumRows_NEON, src, src_width, src_height, dst, dst_width, dst_height);
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+// Fixed size so a message is formatted straight into its slot, longer text is cut
+struct LogRecord {
+    uint64_t time_us;
+    LogLevel level;
+    char category[15];
+    char text[232];
+};
+
+// Single producer (the owning thread), single consumer (the writer)
+struct LogRing {
+    static const size_t CAPACITY = 1024;    // power of two
+
+    LogRecord records[CAPACITY];
+    alignas(64) std::atomic<size_t> head{0};   // next slot the owner writes
+    alignas(64) std::atomic<size_t> tail{0};   // next slot the writer reads
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> closed{false};            // the owning thread has exited
+    int thread = 0;
+};
+
+// Keeps the calling thread's ring alive and marks it closed when the thread exits
+struct ThreadRing {
+    std::shared_ptr<LogRing> ring;
+    ~ThreadRing() {
+        if (ring) ring->closed.store(true, std::memory_order_release);
+    }
+};
+
+static const size_t HISTORY_LIMIT = 10000;
+static const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+
+static std::atomic<int> g_min_level{(int)LogLevel::Info};
+static std::atomic<bool> g_running{false};
+static std::atomic<int> g_thread_count{0};
+static std::atomic<uint64_t> g_dropped{0};
+
+static std::mutex g_rings_mutex;
+static std::vector<std::shared_ptr<LogRing>> g_rings;
+
+static std::thread g_writer;
+static std::mutex g_writer_mutex;
+static std::condition_variable g_writer_wake;
+static bool g_stopping = false;
+
+// Output side, used by the writer, or by callers directly while the writer is not running
+static std::mutex g_emit_mutex;
+static FILE* g_file = nullptr;
+static std::mutex g_history_mutex;
+static std::deque<LogEntry> g_history;
+static uint64_t g_sequence = 0;
+
+
+static int ThreadId() {
+    static thread_local int id = ++g_thread_count;
+    return id;
+}
+
+static LogRing* CurrentRing() {
+    static thread_local ThreadRing thread_ring;
+    if (!thread_ring.ring) {
+        std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+        ring->thread = ThreadId();
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        g_rings.push_back(ring);
+        thread_ring.ring = std::move(ring);
+    }
+    return thread_ring.ring.get();
+}
+
+static uint64_t MicrosecondsSinceStart() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+static void CopyCategory(char (&dst)[15], const char* category) {
+    strncpy(dst, category ? category : "", sizeof(dst) - 1);
+    dst[sizeof(dst) - 1] = '\0';
+}
+
+// Writes entries out and appends them to the history
+static void Emit(std::vector<LogEntry>& entries) {
+    std::lock_guard<std::mutex> emit_lock(g_emit_mutex);
+    char line[320];
+    for (const LogEntry& entry : entries) {
+        snprintf(line, sizeof(line), "%10.3f %-7s %-10s T%-2d %s\n", entry.time, Log_LevelName(entry.level),
+                 entry.category.c_str(), entry.thread, entry.text.c_str());
+        if (g_file) fputs(line, g_file);
+        if (entry.level >= LogLevel::Warning) fputs(line, stderr);
+    }
+    if (g_file) fflush(g_file);
+
+    std::lock_guard<std::mutex> history_lock(g_history_mutex);
+    for (LogEntry& entry : entries) {
+        entry.sequence = ++g_sequence;
+        g_history.push_back(std::move(entry));
+    }
+    while (g_history.size() > HISTORY_LIMIT) g_history.pop_front();
+}
+
+static void DrainRings() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        rings = g_rings;
+    }
+
+    std::vector<LogEntry> batch;
+    for (const std::shared_ptr<LogRing>& ring : rings) {
+        size_t head = ring->head.load(std::memory_order_acquire);
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            const LogRecord& record = ring->records[tail & (LogRing::CAPACITY - 1)];
+            LogEntry entry;
+            entry.time = record.time_us / 1e6;
+            entry.level = record.level;
+            entry.thread = ring->thread;
+            entry.category = record.category;
+            entry.text = record.text;
+            batch.push_back(std::move(entry));
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        if (uint32_t dropped = ring->dropped.exchange(0)) {
+            g_dropped += dropped;
+            LogEntry entry;
+            entry.time = MicrosecondsSinceStart() / 1e6;
+            entry.level = LogLevel::Warning;
+            entry.thread = ring->thread;
+            entry.category = "log";
+            entry.text = std::to_string(dropped) + " messages dropped, ring full";
+            batch.push_back(std::move(entry));
+        }
+    }
+
+    if (!batch.empty()) {
+        std::stable_sort(batch.begin(), batch.end(), [](const LogEntry& a, const LogEntry& b) { return a.time < b.time; });
+        Emit(batch);
+    }
+
+    // Rings of exited threads go once empty
+    std::lock_guard<std::mutex> lock(g_rings_mutex);
+    g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [](const std::shared_ptr<LogRing>& ring) {
+        return ring->closed.load(std::memory_order_acquire) &&
+               ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+    }), g_rings.end());
+}
+
+static void WriterMain() {
+    std::unique_lock<std::mutex> lock(g_writer_mutex);
+    while (!g_stopping) {
+        g_writer_wake.wait_for(lock, std::chrono::milliseconds(20));
+        lock.unlock();
+        DrainRings();
+        lock.lock();
+    }
+}
+
+
+void Log_Start(const std::string& file_path) {
+    if (g_running) return;
+
+    std::string open_error;
+    if (!file_path.empty()) {
+        std::lock_guard<std::mutex> lock(g_emit_mutex);
+        g_file = fopen(file_path.c_str(), "w");
+        if (!g_file) open_error = strerror(errno);
+    }
+
+    g_stopping = false;
+    g_writer = std::thread(WriterMain);
+    g_running = true;
+
+    static bool exit_hook = false;
+    if (!exit_hook) {
+        exit_hook = true;
+        atexit(Log_Stop);
+    }
+    if (!open_error.empty()) {
+        LOG_WARNING("log", "Cannot open log file %s: %s", file_path.c_str(), open_error.c_str());
+    }
+}
+
+void Log_Stop() {
+    if (!g_running) return;
+    {
+        std::lock_guard<std::mutex> lock(g_writer_mutex);
+        g_stopping = true;
+    }
+    g_writer_wake.notify_one();
+    g_writer.join();
+    g_running = false;
+
+    // Whatever was written while the writer shut down
+    DrainRings();
+    std::lock_guard<std::mutex> lock(g_emit_mutex);
+    if (g_file) {
+        fclose(g_file);
+        g_file = nullptr;
+    }
+}
+
+void Log_SetLevel(LogLevel level) {
+    g_min_level = (int)level;
+}
+
+const char* Log_LevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warning: return "WARNING";
+        default: return "ERROR";
+    }
+}
+
+void Log_Write(LogLevel level, const char* category, const char* format, ...) {
+    if ((int)level < g_min_level.load(std::memory_order_relaxed)) return;
+
+    va_list args;
+    va_start(args, format);
+    if (!g_running.load(std::memory_order_acquire)) {
+        char text[sizeof(LogRecord::text)];
+        vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        std::vector<LogEntry> entries(1);
+        entries[0].time = MicrosecondsSinceStart() / 1e6;
+        entries[0].level = level;
+        entries[0].thread = ThreadId();
+        entries[0].category = category ? category : "";
+        entries[0].text = text;
+        Emit(entries);
+        return;
+    }
+
+    LogRing* ring = CurrentRing();
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LogRing::CAPACITY) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+    LogRecord& record = ring->records[head & (LogRing::CAPACITY - 1)];
+    record.time_us = MicrosecondsSinceStart();
+    record.level = level;
+    CopyCategory(record.category, category);
+    vsnprintf(record.text, sizeof(record.text), format, args);
+    va_end(args);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Log_Fetch(uint64_t after_sequence, std::vector<LogEntry>& out) {
+    std::lock_guard<std::mutex> lock(g_history_mutex);
+    if (g_history.empty() || g_history.back().sequence <= after_sequence) return;
+    // Sequences are contiguous within the history
+    uint64_t first = g_history.front().sequence;
+    size_t start = after_sequence >= first ? (size_t)(after_sequence - first + 1) : 0;
+    out.insert(out.end(), g_history.begin() + start, g_history.end());
+}
+
+uint64_t Log_DroppedCount() {
+    return g_dropped;
+}
@@ -0,0 +1,54 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Asynchronous logger
+    Each thread formats into its own lock-free ring, a writer thread drains the rings every
+    few milliseconds into the log file, stderr (warnings and errors) and an in-memory history
+    read by the log console. A full ring drops the message and counts it, a caller never waits.
+    Before Log_Start and after Log_Stop the calling thread emits each message itself: into the
+    history, and to stderr when it is a warning or an error.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum class LogLevel : uint8_t { Debug, Info, Warning, Error };
+
+struct LogEntry {
+    uint64_t sequence = 0;      // increasing, for Log_Fetch
+    double time = 0.0;          // seconds since start
+    LogLevel level = LogLevel::Info;
+    int thread = 0;             // 1 is the first thread that logged, normally the render thread
+    std::string category;
+    std::string text;
+};
+
+// Starts the writer thread; an empty file_path keeps the log in memory and on stderr only.
+// The writer is drained and stopped at exit.
+void Log_Start(const std::string& file_path);
+void Log_Stop();
+
+// Messages below the level are discarded by the caller
+void Log_SetLevel(LogLevel level);
+const char* Log_LevelName(LogLevel level);
+
+#if defined(__GNUC__)
+void Log_Write(LogLevel level, const char* category, const char* format, ...) __attribute__((format(printf, 3, 4)));
+#else
+void Log_Write(LogLevel level, const char* category, const char* format, ...);
+#endif
+
+// Appends history entries newer than after_sequence to out
+void Log_Fetch(uint64_t after_sequence, std::vector<LogEntry>& out);
+
+// Messages lost to full rings so far
+uint64_t Log_DroppedCount();
+
+#define LOG_DEBUG(category, ...) Log_Write(LogLevel::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) Log_Write(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) Log_Write(LogLevel::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) Log_Write(LogLevel::Error, category, __VA_ARGS__)
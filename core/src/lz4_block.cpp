@@ -0,0 +1,169 @@
+#include "lz4_block.h"
+
+#include <cstring>
+
+
+// Format limits: a match needs 4 bytes, the last 5 bytes are always literals and
+// no match may start in the last 12 bytes
+static const int MIN_MATCH = 4;
+static const int LAST_LITERALS = 5;
+static const int MF_LIMIT = 12;
+static const int MAX_DISTANCE = 65535;
+static const int HASH_BITS = 14;
+
+static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static inline uint32_t Hash4(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 and above continue in extra bytes of 255 each
+static inline uint8_t* WriteLength(uint8_t* op, int length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+
+int LZ4Block_Bound(int size) {
+    return size + size / 255 + 16;
+}
+
+int LZ4Block_Compress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity) {
+    if (dst_capacity < LZ4Block_Bound(src_size)) return 0;
+    if (src_size == 0) {
+        dst[0] = 0;
+        return 1;
+    }
+
+    uint8_t* op = dst;
+    const uint8_t* anchor = src;
+    const uint8_t* ip = src;
+    const uint8_t* const src_end = src + src_size;
+    const uint8_t* const match_limit = src_end - LAST_LITERALS;
+
+    if (src_size >= MF_LIMIT + 1) {
+        static thread_local int32_t table[1 << HASH_BITS];
+        for (int32_t& slot : table) slot = -1;
+
+        const uint8_t* const search_limit = src_end - MF_LIMIT;
+        while (ip < search_limit) {
+            uint32_t sequence = Read32(ip);
+            uint32_t h = Hash4(sequence);
+            int32_t candidate = table[h];
+            int32_t position = (int32_t)(ip - src);
+            table[h] = position;
+
+            // Step further the longer nothing matched, incompressible data passes quickly.
+            // The offset is checked before forming the pointer, src - 1 is not a valid one.
+            if (candidate < 0 || position - candidate > MAX_DISTANCE || Read32(src + candidate) != sequence) {
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            const uint8_t* match = src + candidate;
+
+            // Extend backwards over literals that also match, then forwards
+            while (ip > anchor && match > src && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            const uint8_t* match_end = ip + MIN_MATCH;
+            const uint8_t* ref = match + MIN_MATCH;
+            while (match_end < match_limit && *match_end == *ref) {
+                match_end++;
+                ref++;
+            }
+
+            int literal_length = (int)(ip - anchor);
+            int match_length = (int)(match_end - ip) - MIN_MATCH;
+            uint8_t* token = op++;
+            *token = (uint8_t)((literal_length >= 15 ? 15 : literal_length) << 4);
+            if (literal_length >= 15) op = WriteLength(op, literal_length - 15);
+            memcpy(op, anchor, literal_length);
+            op += literal_length;
+
+            uint16_t offset = (uint16_t)(ip - match);
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+            *token |= (uint8_t)(match_length >= 15 ? 15 : match_length);
+            if (match_length >= 15) op = WriteLength(op, match_length - 15);
+
+            // Seed the table inside the match so runs chain into the next sequence
+            if (match_end - 2 > src && match_end < search_limit) {
+                table[Hash4(Read32(match_end - 2))] = (int32_t)(match_end - 2 - src);
+            }
+            ip = anchor = match_end;
+        }
+    }
+
+    // Trailing literals
+    int literal_length = (int)(src_end - anchor);
+    *op++ = (uint8_t)((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) op = WriteLength(op, literal_length - 15);
+    memcpy(op, anchor, literal_length);
+    op += literal_length;
+    return (int)(op - dst);
+}
+
+int LZ4Block_Decompress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity) {
+    const uint8_t* ip = src;
+    const uint8_t* const src_end = src + src_size;
+    uint8_t* op = dst;
+    uint8_t* const dst_end = dst + dst_capacity;
+
+    while (ip < src_end) {
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            uint8_t extra;
+            do {
+                if (ip >= src_end) return -1;
+                extra = *ip++;
+                literal_length += extra;
+            } while (extra == 255);
+        }
+        if (literal_length > (size_t)(src_end - ip) || literal_length > (size_t)(dst_end - op)) return -1;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        // The last sequence has literals only
+        if (ip == src_end) break;
+
+        if (src_end - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+
+        size_t match_length = token & 15;
+        if (match_length == 15) {
+            uint8_t extra;
+            do {
+                if (ip >= src_end) return -1;
+                extra = *ip++;
+                match_length += extra;
+            } while (extra == 255);
+        }
+        match_length += MIN_MATCH;
+        if (match_length > (size_t)(dst_end - op)) return -1;
+
+        // An overlapping match repeats the last offset bytes. Each copy doubles the distance
+        // to the pattern start, so the copies never overlap.
+        const uint8_t* match = op - offset;
+        while (match_length > 0) {
+            size_t chunk = (size_t)(op - match) < match_length ? (size_t)(op - match) : match_length;
+            memcpy(op, match, chunk);
+            op += chunk;
+            match_length -= chunk;
+        }
+    }
+    return (int)(op - dst);
+}
@@ -0,0 +1,20 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    LZ4 block format codec (no frame header, no checksums)
+    Output is readable by the reference LZ4_decompress_safe and the other way round
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+// Worst case compressed size for size input bytes
+int LZ4Block_Bound(int size);
+
+// Greedy single-pass compressor, returns the compressed size or 0 when dst is too small
+int LZ4Block_Compress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity);
+
+// Returns the decompressed size, -1 on malformed input or when dst_capacity would be exceeded
+int LZ4Block_Decompress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity);
@@ -0,0 +1,239 @@
+#include "manifest_verify.h"
+#include "content_hash.h"
+#include "content_index.h"
+#include "image_files.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+
+const char* VerifyStatus_Name(VerifyStatus status) {
+    switch (status) {
+        case VerifyStatus::Ok: return "ok";
+        case VerifyStatus::Mismatch: return "mismatch";
+        case VerifyStatus::Missing: return "missing";
+        case VerifyStatus::Unlisted: return "not in manifest";
+        case VerifyStatus::Unreadable: return "unreadable";
+    }
+    return "?";
+}
+
+static bool ParseHash(const std::string& text, uint64_t& hash) {
+    std::string digits = text.compare(0, 5, "XXH3_") == 0 ? text.substr(5) : text;
+    if (digits.size() != 16 || digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return false;
+    hash = strtoull(digits.c_str(), nullptr, 16);
+    return true;
+}
+
+static std::string ManifestKey(const std::string& name) {
+    return std::filesystem::path(name).lexically_normal().generic_string();
+}
+
+bool Manifest_Load(const std::string& path, std::map<std::string, uint64_t>& entries, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0, skipped = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::string name, hash_text;
+        size_t tag_end = line.rfind(") = ");
+        if (line.compare(0, 6, "XXH3 (") == 0 && tag_end != std::string::npos) {
+            name = line.substr(6, tag_end - 6);
+            hash_text = line.substr(tag_end + 4);
+        } else {
+            // Two spaces, or a space and the binary mode '*' of md5sum style tools
+            size_t separator = line.find(' ');
+            if (separator != std::string::npos && separator + 2 < line.size() &&
+                (line[separator + 1] == ' ' || line[separator + 1] == '*')) {
+                hash_text = line.substr(0, separator);
+                name = line.substr(separator + 2);
+            }
+        }
+
+        uint64_t hash;
+        if (name.empty() || !ParseHash(hash_text, hash)) {
+            if (skipped++ == 0) {
+                LOG_WARNING("verify", "%s:%d is not an XXH3 64-bit line (xxhsum -H3), skipped", path.c_str(), line_number);
+            }
+            continue;
+        }
+        entries[ManifestKey(name)] = hash;
+    }
+    if (skipped > 1) {
+        LOG_WARNING("verify", "%s: %d lines skipped in total", path.c_str(), skipped);
+    }
+    return true;
+}
+
+
+bool ManifestVerifier::Start(const std::string& directory, const std::string& manifest) {
+    if (running) return false;
+    workers.WaitIdle();
+
+    progress.total = 0;
+    progress.done = 0;
+    progress.mismatches = 0;
+    progress.missing = 0;
+    progress.unlisted = 0;
+    progress.unreadable = 0;
+    progress.bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        problems.clear();
+        error.clear();
+        start = end = std::chrono::steady_clock::now();
+    }
+    cancelled = false;
+    running = true;
+
+    // Scanning a deep tree takes a while too, so it happens on a worker as well
+    workers.Submit([this, directory, manifest] { Prepare(directory, manifest); });
+    return true;
+}
+
+bool ManifestVerifier::Succeeded() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !running && error.empty() && !cancelled &&
+           progress.mismatches == 0 && progress.missing == 0 && progress.unreadable == 0;
+}
+
+std::string ManifestVerifier::Error() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+double ManifestVerifier::Seconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto until = running ? std::chrono::steady_clock::now() : end;
+    return std::chrono::duration<double>(until - start).count();
+}
+
+std::vector<VerifyResult> ManifestVerifier::Problems() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return problems;
+}
+
+void ManifestVerifier::Prepare(const std::string& directory, const std::string& manifest) {
+    std::map<std::string, uint64_t> entries;
+    std::string load_error;
+    if (!Manifest_Load(manifest, entries, load_error)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = load_error;
+        }
+        Finish();
+        return;
+    }
+
+    // Every listed file, then the images the viewer would show that the manifest does not know
+    items.clear();
+    for (const auto& [path, hash] : entries) {
+        items.push_back(Item{ path, true, hash });
+    }
+    for (const std::string& path : GetImageFilesRecursive(directory)) {
+        std::string key = ManifestKey(std::filesystem::path(path).lexically_relative(directory).generic_string());
+        if (!entries.count(key)) items.push_back(Item{ key, false, 0 });
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.path < b.path; });
+    progress.total = (int)items.size();
+    if (items.empty()) {
+        Finish();
+        return;
+    }
+
+    next_item = 0;
+    checking_jobs = (int)std::min(thread_count, items.size());
+    for (int j = checking_jobs; j > 0; j--) {
+        workers.Submit([this, directory] {
+            for (int i = next_item++; i < (int)items.size() && !cancelled; i = next_item++) {
+                Check(directory, items[i]);
+                progress.done++;
+            }
+            if (--checking_jobs == 0) Finish();
+        });
+    }
+}
+
+void ManifestVerifier::Check(const std::string& directory, const Item& item) {
+    // Built like the scanner's paths so the content index entries are the viewer's
+    std::string path = (std::filesystem::path(directory) / item.path).string();
+    VerifyResult result{ item.path, VerifyStatus::Ok, item.expected, 0 };
+
+    std::error_code file_error;
+    uint64_t size = (uint64_t)std::filesystem::file_size(path, file_error);
+    if (file_error) {
+        result.status = std::filesystem::exists(path, file_error) ? VerifyStatus::Unreadable : VerifyStatus::Missing;
+    } else {
+        std::string hash_error;
+        bool hashed = index ? index->Lookup(path, result.actual, true) : ContentHash_File(path, result.actual, hash_error);
+        if (!hashed) {
+            result.status = VerifyStatus::Unreadable;
+        } else {
+            progress.bytes += size;
+            if (!item.listed) {
+                result.status = VerifyStatus::Unlisted;
+            } else if (result.actual != item.expected) {
+                result.status = VerifyStatus::Mismatch;
+            }
+        }
+    }
+
+    switch (result.status) {
+        case VerifyStatus::Ok: return;
+        case VerifyStatus::Mismatch: progress.mismatches++; break;
+        case VerifyStatus::Missing: progress.missing++; break;
+        case VerifyStatus::Unlisted: progress.unlisted++; break;
+        case VerifyStatus::Unreadable: progress.unreadable++; break;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    problems.push_back(std::move(result));
+}
+
+void ManifestVerifier::Finish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::sort(problems.begin(), problems.end(), [](const VerifyResult& a, const VerifyResult& b) { return a.path < b.path; });
+    end = std::chrono::steady_clock::now();
+    running = false;
+}
+
+
+int RunManifestVerify(const std::string& directory, const std::string& manifest, ContentIndex* index) {
+    ManifestVerifier verifier(index);
+    verifier.Start(directory, manifest);
+    verifier.Wait();
+
+    std::string error = verifier.Error();
+    if (!error.empty()) {
+        LOG_ERROR("verify", "Cannot verify %s: %s", directory.c_str(), error.c_str());
+        return 1;
+    }
+    for (const VerifyResult& problem : verifier.Problems()) {
+        printf("%-16s %s", VerifyStatus_Name(problem.status), problem.path.c_str());
+        if (problem.status == VerifyStatus::Mismatch) {
+            printf(" (expected %016" PRIx64 ", found %016" PRIx64 ")", problem.expected, problem.actual);
+        }
+        printf("\n");
+    }
+
+    const VerifyProgress& progress = verifier.progress;
+    double seconds = verifier.Seconds();
+    printf("verify %s against %s: %d files, %d mismatched, %d missing, %d unreadable, %d not in manifest; "
+           "%.1f MB in %.2f s (%.1f MB/s)\n",
+           directory.c_str(), manifest.c_str(), progress.total.load(), progress.mismatches.load(), progress.missing.load(),
+           progress.unreadable.load(), progress.unlisted.load(), progress.bytes / 1e6, seconds,
+           seconds > 0.0 ? progress.bytes / 1e6 / seconds : 0.0);
+    return verifier.Succeeded() ? 0 : 1;
+}
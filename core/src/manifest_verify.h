@@ -0,0 +1,118 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Integrity check of a delivery folder against a checksum manifest
+    The manifest is xxhsum -H3 output, the hash the caches key content by (content_hash.h). Every
+    file it lists and every image found below the folder is read through mmap and hashed with the
+    selected kernels. Hashing outruns any disk, so a few threads are enough to keep the device
+    queue full; more would only make a spinning disk seek. Runs in the background for the panel,
+    or blocking for the command line.
+*/
+
+#pragma once
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ContentIndex;
+
+
+enum class VerifyStatus { Ok, Mismatch, Missing, Unlisted, Unreadable };
+
+const char* VerifyStatus_Name(VerifyStatus status);
+
+struct VerifyResult {
+    std::string path;           // relative to the folder, as written in the manifest
+    VerifyStatus status = VerifyStatus::Ok;
+    uint64_t expected = 0;      // 0 for unlisted files
+    uint64_t actual = 0;        // 0 when missing or unreadable
+};
+
+// Reads "<hash>  <name>" lines, the hash with or without xxhsum's "XXH3_" prefix, and BSD style
+// "XXH3 (<name>) = <hash>" lines (xxhsum --tag). Names are keyed as normalized relative paths.
+// Other lines are skipped with a warning. False when the file cannot be read.
+bool Manifest_Load(const std::string& path, std::map<std::string, uint64_t>& entries, std::string& error);
+
+
+struct VerifyProgress {
+    std::atomic<int> total{0};      // 0 until the manifest is read and the folder scanned
+    std::atomic<int> done{0};
+    std::atomic<int> mismatches{0};
+    std::atomic<int> missing{0};
+    std::atomic<int> unlisted{0};
+    std::atomic<int> unreadable{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+
+class ManifestVerifier {
+public:
+    // Files are hashed through index when set, so the caches reuse the hashes. They are always read
+    // again, a hash remembered from earlier says nothing about the bytes on disk now.
+    explicit ManifestVerifier(ContentIndex* index = nullptr, size_t thread_count = 4)
+        : index(index), thread_count(thread_count), workers(thread_count) {}
+    ~ManifestVerifier() { Cancel(); }
+
+    ManifestVerifier(const ManifestVerifier&) = delete;
+    ManifestVerifier& operator=(const ManifestVerifier&) = delete;
+
+    // Starts verifying directory against manifest, returns immediately. False while a run is going on.
+    bool Start(const std::string& directory, const std::string& manifest);
+
+    // Blocks until the run finished, or stopped after Cancel
+    void Wait() { workers.WaitIdle(); }
+
+    // Asks the run to stop and returns at once, Running() turns false when the workers have stopped
+    void Cancel() { cancelled = true; }
+
+    bool Running() const { return running; }
+    bool Succeeded() const;         // finished without mismatched, missing or unreadable files
+    std::string Error() const;      // why the run could not start (manifest unreadable), else empty
+    double Seconds() const;         // of the current or last run
+
+    // Every file not Ok so far, sorted by path once the run finished. Copies under the lock, the panel
+    // calls it only when progress.done or Running() changed.
+    std::vector<VerifyResult> Problems() const;
+
+    VerifyProgress progress;
+
+private:
+    struct Item {
+        std::string path;
+        bool listed = false;
+        uint64_t expected = 0;
+    };
+
+    void Prepare(const std::string& directory, const std::string& manifest);
+    void Check(const std::string& directory, const Item& item);
+    void Finish();
+
+    ContentIndex* index;
+    size_t thread_count;
+    std::atomic<bool> running{false};
+    std::atomic<bool> cancelled{false};
+    std::vector<Item> items;            // written by Prepare before the checking jobs start
+    std::atomic<int> next_item{0};
+    std::atomic<int> checking_jobs{0};
+
+    mutable std::mutex mutex;
+    std::vector<VerifyResult> problems;
+    std::string error;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+
+    // Declared last so the workers are joined before the state they write is destroyed
+    ThreadPool workers;
+};
+
+
+// Command line mode: verifies, prints every problem and the throughput. Returns 0 when no listed file
+// is missing, differs or cannot be read; unlisted files are reported but do not fail the run.
+int RunManifestVerify(const std::string& directory, const std::string& manifest, ContentIndex* index);
@@ -0,0 +1,377 @@
+#include "metrics.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+// The HTTP endpoint uses BSD sockets, Windows builds only write the file
+#if !defined(_WIN32)
+#define METRICS_HTTP
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(METRICS_HTTP) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0      // macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+
+
+enum class MetricType { Counter, Gauge, Histogram };
+
+struct MetricEntry {
+    std::string name;
+    std::string help;
+    MetricType type;
+    std::unique_ptr<MetricCounter> counter;
+    std::unique_ptr<MetricGauge> gauge;
+    std::unique_ptr<MetricHistogram> histogram;
+};
+
+// Entries are never removed, so references handed out stay valid
+struct MetricRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<MetricEntry>> entries;
+    std::vector<std::function<void()>> collectors;
+};
+
+static MetricRegistry& Registry() {
+    static MetricRegistry registry;
+    return registry;
+}
+
+// Caller holds the registry mutex
+static MetricEntry* FindOrAdd(const std::string& name, const std::string& help, MetricType type, bool& added) {
+    MetricRegistry& registry = Registry();
+    for (const std::unique_ptr<MetricEntry>& entry : registry.entries) {
+        if (entry->name == name) {
+            added = false;
+            return entry->type == type ? entry.get() : nullptr;
+        }
+    }
+    registry.entries.push_back(std::make_unique<MetricEntry>());
+    MetricEntry* entry = registry.entries.back().get();
+    entry->name = name;
+    entry->help = help;
+    entry->type = type;
+    added = true;
+    return entry;
+}
+
+
+MetricHistogram::MetricHistogram(std::vector<double> bucket_bounds)
+    : bounds(std::move(bucket_bounds)), buckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+    std::sort(bounds.begin(), bounds.end());
+    for (size_t i = 0; i <= bounds.size(); i++) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::Observe(double v) {
+    // A dozen bounds at most, a linear scan beats a binary search here
+    size_t i = 0;
+    while (i < bounds.size() && v > bounds[i]) i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    double old_sum = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old_sum, old_sum + v, std::memory_order_relaxed)) {}
+}
+
+double MetricHistogram::Quantile(double q) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i <= bounds.size(); i++) total += BucketCount(i);
+    if (total == 0) return 0.0;
+
+    double rank = q * total;
+    uint64_t below = 0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        uint64_t in_bucket = BucketCount(i);
+        if (below + in_bucket >= rank && in_bucket > 0) {
+            double lower = i > 0 ? bounds[i - 1] : 0.0;
+            return lower + (bounds[i] - lower) * (rank - below) / in_bucket;
+        }
+        below += in_bucket;
+    }
+    return bounds.empty() ? 0.0 : bounds.back();
+}
+
+
+MetricCounter& Metrics_Counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(Registry().mutex);
+    bool added;
+    MetricEntry* entry = FindOrAdd(name, help, MetricType::Counter, added);
+    if (!entry) {
+        // A name reused with another type is a programming error, keep it out of the export
+        static MetricCounter orphan;
+        return orphan;
+    }
+    if (added) entry->counter = std::make_unique<MetricCounter>();
+    return *entry->counter;
+}
+
+MetricGauge& Metrics_Gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(Registry().mutex);
+    bool added;
+    MetricEntry* entry = FindOrAdd(name, help, MetricType::Gauge, added);
+    if (!entry) {
+        static MetricGauge orphan;
+        return orphan;
+    }
+    if (added) entry->gauge = std::make_unique<MetricGauge>();
+    return *entry->gauge;
+}
+
+MetricHistogram& Metrics_Histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(Registry().mutex);
+    bool added;
+    MetricEntry* entry = FindOrAdd(name, help, MetricType::Histogram, added);
+    if (!entry) {
+        static MetricHistogram orphan({});
+        return orphan;
+    }
+    if (added) entry->histogram = std::make_unique<MetricHistogram>(bounds);
+    return *entry->histogram;
+}
+
+std::vector<double> Metrics_TimeBuckets() {
+    return { 0.001, 0.0025, 0.005, 0.0083, 0.0167, 0.025, 0.0333, 0.05, 0.1, 0.25, 0.5, 1.0 };
+}
+
+void Metrics_AddCollector(std::function<void()> collector) {
+    std::lock_guard<std::mutex> lock(Registry().mutex);
+    Registry().collectors.push_back(std::move(collector));
+}
+
+#if defined(__GNUC__)
+static void AppendLine(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+#endif
+static void AppendLine(std::string& out, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) out.append(line, std::min((size_t)length, sizeof(line) - 1));
+    out += '\n';
+}
+
+std::string Metrics_Format() {
+    MetricRegistry& registry = Registry();
+    std::vector<std::function<void()>> collectors;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        collectors = registry.collectors;
+    }
+    for (const std::function<void()>& collector : collectors) collector();
+
+    std::string out;
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<MetricEntry>& entry : registry.entries) {
+        const char* name = entry->name.c_str();
+        AppendLine(out, "# HELP %s %s", name, entry->help.c_str());
+        switch (entry->type) {
+            case MetricType::Counter:
+                AppendLine(out, "# TYPE %s counter", name);
+                AppendLine(out, "%s %llu", name, (unsigned long long)entry->counter->Value());
+                break;
+            case MetricType::Gauge:
+                AppendLine(out, "# TYPE %s gauge", name);
+                AppendLine(out, "%s %.9g", name, entry->gauge->Value());
+                break;
+            case MetricType::Histogram: {
+                // Buckets are cumulative in the exposition format, the count is the +Inf bucket
+                const MetricHistogram& histogram = *entry->histogram;
+                AppendLine(out, "# TYPE %s histogram", name);
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < histogram.Bounds().size(); i++) {
+                    cumulative += histogram.BucketCount(i);
+                    AppendLine(out, "%s_bucket{le=\"%.9g\"} %llu", name, histogram.Bounds()[i], (unsigned long long)cumulative);
+                }
+                cumulative += histogram.BucketCount(histogram.Bounds().size());
+                AppendLine(out, "%s_bucket{le=\"+Inf\"} %llu", name, (unsigned long long)cumulative);
+                AppendLine(out, "%s_sum %.9g", name, histogram.Sum());
+                AppendLine(out, "%s_count %llu", name, (unsigned long long)cumulative);
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+
+static std::thread g_exporter;
+static std::atomic<bool> g_export_stop{false};
+static bool g_exporting = false;
+static int g_listen_socket = -1;
+static std::string g_export_path;
+static double g_export_interval = 10.0;
+
+static bool WriteMetricsFile(const std::string& path) {
+    // Written aside and renamed, a reader never sees half a file
+    std::string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file) return false;
+    std::string text = Metrics_Format();
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = fclose(file) == 0 && ok;
+    // C rename fails on Windows when path exists, std::filesystem::rename replaces it everywhere
+    std::error_code error;
+    if (ok) std::filesystem::rename(temp_path, path, error);
+    return ok && !error;
+}
+
+#if defined(METRICS_HTTP)
+
+static void SendAll(int socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += (size_t)n;
+    }
+}
+
+// One request per connection, only GET /metrics (or /) is answered
+static void ServeConnection(int socket) {
+    timeval timeout = { 1, 0 };
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#if defined(SO_NOSIGPIPE)
+    int no_sigpipe = 1;
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(socket, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, (size_t)n);
+    }
+
+    std::string status = "404 Not Found", body = "Not found\n";
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 21, "GET /metrics?") == 0 ||
+        request.compare(0, 6, "GET / ") == 0) {
+        status = "200 OK";
+        body = Metrics_Format();
+    }
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    SendAll(socket, response);
+}
+
+#endif
+
+static void ExporterMain() {
+    using clock = std::chrono::steady_clock;
+    clock::time_point next_write = clock::now();
+    while (!g_export_stop.load()) {
+        if (!g_export_path.empty() && clock::now() >= next_write) {
+            if (!WriteMetricsFile(g_export_path)) {
+                LOG_WARNING("metrics", "Cannot write %s: %s", g_export_path.c_str(), strerror(errno));
+            }
+            next_write = clock::now() + std::chrono::milliseconds((int)(g_export_interval * 1000));
+        }
+
+        // Short waits so a stop request is noticed quickly
+        if (g_listen_socket < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+#if defined(METRICS_HTTP)
+        pollfd listen_poll = { g_listen_socket, POLLIN, 0 };
+        if (poll(&listen_poll, 1, 100) <= 0) continue;
+        int connection = accept(g_listen_socket, nullptr, nullptr);
+        if (connection < 0) continue;
+        ServeConnection(connection);
+        close(connection);
+#endif
+    }
+}
+
+static double ResidentMemoryBytes() {
+#if defined(__linux__)
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0.0;
+    unsigned long long size = 0, resident = 0;
+    int fields = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    return fields == 2 ? (double)resident * sysconf(_SC_PAGESIZE) : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+bool Metrics_StartExport(int port, const std::string& file_path, double interval_seconds) {
+    if (g_exporting || (port <= 0 && file_path.empty())) return false;
+
+    if (port > 0) {
+#if defined(METRICS_HTTP)
+        g_listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(g_listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);     // local scrapers only
+        if (g_listen_socket < 0 || bind(g_listen_socket, (sockaddr*)&address, sizeof(address)) != 0 ||
+            listen(g_listen_socket, 8) != 0) {
+            LOG_ERROR("metrics", "Cannot listen on 127.0.0.1:%d: %s", port, strerror(errno));
+            if (g_listen_socket >= 0) close(g_listen_socket);
+            g_listen_socket = -1;
+            if (file_path.empty()) return false;
+        } else {
+            LOG_INFO("metrics", "Serving metrics on http://127.0.0.1:%d/metrics", port);
+        }
+#else
+        LOG_WARNING("metrics", "No HTTP endpoint on this platform, use --metrics-file");
+        if (file_path.empty()) return false;
+#endif
+    }
+
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MetricGauge& resident = Metrics_Gauge("process_resident_memory_bytes", "Resident memory size in bytes.");
+        Metrics_AddCollector([&resident]() { resident.Set(ResidentMemoryBytes()); });
+        atexit(Metrics_StopExport);
+    }
+
+    g_export_path = file_path;
+    g_export_interval = std::max(interval_seconds, 0.1);
+    g_export_stop = false;
+    g_exporter = std::thread(ExporterMain);
+    g_exporting = true;
+    return true;
+}
+
+void Metrics_StopExport() {
+    if (!g_exporting) return;
+    g_export_stop = true;
+    g_exporter.join();
+    g_exporting = false;
+#if defined(METRICS_HTTP)
+    if (g_listen_socket >= 0) {
+        close(g_listen_socket);
+        g_listen_socket = -1;
+    }
+#endif
+    // Values of the final moments, e.g. a headless run shorter than the interval
+    if (!g_export_path.empty() && !WriteMetricsFile(g_export_path)) {
+        LOG_WARNING("metrics", "Cannot write %s: %s", g_export_path.c_str(), strerror(errno));
+    }
+}
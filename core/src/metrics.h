@@ -0,0 +1,82 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Metrics registry in Prometheus text format
+    Counters, gauges and fixed-bucket histograms are registered once by name and kept for
+    the life of the process; updating one is a few relaxed atomic operations, no lock.
+    The exporter thread serves them on a local HTTP port and/or rewrites a file periodically.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MetricCounter {
+public:
+    void Add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    // Mirrors a count that is kept elsewhere, must not go backwards
+    void Set(uint64_t count) { value.store(count, std::memory_order_relaxed); }
+    uint64_t Value() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge {
+public:
+    void Set(double v) { value.store(v, std::memory_order_relaxed); }
+    double Value() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value{0.0};
+};
+
+class MetricHistogram {
+public:
+    // bounds are the ascending upper bounds of the buckets, +Inf is implied
+    explicit MetricHistogram(std::vector<double> bounds);
+
+    void Observe(double v);
+
+    // Estimated from the buckets by linear interpolation, 0 without observations
+    double Quantile(double q) const;
+
+    const std::vector<double>& Bounds() const { return bounds; }
+    // Observations in bucket i alone, i == Bounds().size() is the +Inf bucket
+    uint64_t BucketCount(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    double Sum() const { return sum.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<uint64_t> count{0};
+    std::atomic<double> sum{0.0};
+};
+
+// Registration takes a lock, keep the returned reference instead of looking it up per update.
+// Registering a name again returns the existing metric.
+MetricCounter& Metrics_Counter(const std::string& name, const std::string& help);
+MetricGauge& Metrics_Gauge(const std::string& name, const std::string& help);
+MetricHistogram& Metrics_Histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+// Bucket bounds in seconds for durations from 1 ms to 1 s
+std::vector<double> Metrics_TimeBuckets();
+
+// Called on the exporter thread before every export, to copy values kept elsewhere into metrics.
+// Anything it reads must be safe to read from another thread.
+void Metrics_AddCollector(std::function<void()> collector);
+
+// Every registered metric in the Prometheus text exposition format
+std::string Metrics_Format();
+
+// Starts the exporter thread: port > 0 listens on 127.0.0.1:port for GET /metrics, a non-empty
+// file_path is rewritten every interval_seconds. Stopped at exit, the file is written a last time.
+bool Metrics_StartExport(int port, const std::string& file_path, double interval_seconds);
+void Metrics_StopExport();
@@ -0,0 +1,112 @@
+#include "preview_store.h"
+#include "logger.h"
+#include "qoi_codec.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+
+void PreviewStore::SetDirectory(const std::string& new_directory) {
+    directory.clear();
+    if (new_directory.empty()) return;
+
+    std::error_code error;
+    std::filesystem::create_directories(new_directory, error);
+    if (error) {
+        LOG_WARNING("preview", "Preview cache disabled, cannot create %s: %s", new_directory.c_str(), error.message().c_str());
+        return;
+    }
+    directory = new_directory;
+}
+
+std::string PreviewStore::PreviewPath(const std::string& source_path, int max_side) const {
+    // Absolute, so the viewer and --prebuild-cache agree whatever folder they were started from
+    std::error_code error;
+    std::string key = std::filesystem::absolute(source_path, error).lexically_normal().string();
+    if (error) return std::string();
+    uintmax_t size = std::filesystem::file_size(source_path, error);
+    if (error) return std::string();
+    auto mtime = std::filesystem::last_write_time(source_path, error).time_since_epoch().count();
+    if (error) return std::string();
+
+    // FNV-1a over path, size and mtime
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t length) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(key.data(), key.size());
+    mix(&size, sizeof(size));
+    mix(&mtime, sizeof(mtime));
+
+    // <hash>.qoi for thumbnails, the other tiers add their size
+    char name[48];
+    if (max_side == THUMBNAIL_SIZE) {
+        snprintf(name, sizeof(name), "%016" PRIx64 ".qoi", hash);
+    } else {
+        snprintf(name, sizeof(name), "%016" PRIx64 "_%d.qoi", hash, max_side);
+    }
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool PreviewStore::Load(const std::string& source_path, std::vector<unsigned char>& rgba, int& width, int& height,
+                        int max_side) const {
+    if (directory.empty()) return false;
+    std::string preview_path = PreviewPath(source_path, max_side);
+    return !preview_path.empty() && QOI_ReadFile(preview_path, rgba, width, height);
+}
+
+void PreviewStore::Save(const std::string& source_path, const unsigned char* rgba, int width, int height,
+                        int max_side) const {
+    if (directory.empty()) return;
+    std::string preview_path = PreviewPath(source_path, max_side);
+    if (preview_path.empty()) return;
+
+    // Write then rename, a reader never sees a partial file
+    std::error_code error;
+    if (std::filesystem::exists(preview_path, error)) return;
+    // Unique per process and thread, --prebuild-cache and a viewer may write the same file at once
+    std::string temp_path = preview_path + ".tmp" + std::to_string(getpid()) + "_" +
+                            std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    if (QOI_WriteFile(temp_path, rgba, width, height)) {
+        std::filesystem::rename(temp_path, preview_path, error);
+    }
+    if (error || std::filesystem::exists(temp_path)) {
+        std::filesystem::remove(temp_path, error);
+    }
+}
+
+bool PreviewStore::Contains(const std::string& source_path, int max_side) const {
+    if (directory.empty()) return false;
+    std::string preview_path = PreviewPath(source_path, max_side);
+    std::error_code error;
+    return !preview_path.empty() && std::filesystem::exists(preview_path, error);
+}
+
+void PreviewStore::RemoveStaleTemporaries() const {
+    if (directory.empty()) return;
+    auto cutoff = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error), end;
+    for (; !error && it != end; it.increment(error)) {
+        std::error_code entry_error;
+        if (it->path().filename().string().find(".tmp") == std::string::npos) continue;
+        if (it->last_write_time(entry_error) < cutoff && !entry_error) {
+            std::filesystem::remove(it->path(), entry_error);
+        }
+    }
+}
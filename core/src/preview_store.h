@@ -0,0 +1,36 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Thumbnails and mid-resolution previews persisted as QOI files, so previews are instant on the next run
+    Files are keyed by absolute source path, size and modification time; an edited file gets a new key
+*/
+
+#pragma once
+
+#include "image_ops.h"
+
+#include <string>
+#include <vector>
+
+
+class PreviewStore {
+public:
+    // Empty directory disables the store
+    void SetDirectory(const std::string& directory);
+    bool Enabled() const { return !directory.empty(); }
+
+    // All are safe to call from any thread. max_side tells the thumbnail and preview tiers apart.
+    bool Load(const std::string& source_path, std::vector<unsigned char>& rgba, int& width, int& height,
+              int max_side = THUMBNAIL_SIZE) const;
+    void Save(const std::string& source_path, const unsigned char* rgba, int width, int height,
+              int max_side = THUMBNAIL_SIZE) const;
+    bool Contains(const std::string& source_path, int max_side = THUMBNAIL_SIZE) const;
+
+    // Deletes temporaries of writers killed mid-write, only old ones so live writers are not disturbed
+    void RemoveStaleTemporaries() const;
+
+private:
+    std::string PreviewPath(const std::string& source_path, int max_side) const;
+
+    std::string directory;
+};
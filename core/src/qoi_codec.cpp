@@ -0,0 +1,225 @@
+#include "qoi_codec.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QOI_SSE2 1
+#endif
+
+
+static const uint8_t OP_INDEX = 0x00;
+static const uint8_t OP_DIFF = 0x40;
+static const uint8_t OP_LUMA = 0x80;
+static const uint8_t OP_RUN = 0xC0;
+static const uint8_t OP_RGB = 0xFE;
+static const uint8_t OP_RGBA = 0xFF;
+static const uint8_t MASK_2 = 0xC0;
+
+static const int HEADER_SIZE = 14;
+static const uint8_t END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// Pixels are handled as 32-bit words in memory order, r g b a
+union Pixel {
+    struct { uint8_t r, g, b, a; } c;
+    uint32_t v;
+};
+
+static inline int Hash(Pixel p) {
+    return (p.c.r * 3 + p.c.g * 5 + p.c.b * 7 + p.c.a * 11) & 63;
+}
+
+static inline void Write32BE(unsigned char* p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static inline uint32_t Read32BE(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Run lengths are at most 62, fill 4 pixels per store where possible
+static inline uint32_t* FillRun(uint32_t* out, uint32_t value, int count) {
+#ifdef QOI_SSE2
+    __m128i quad = _mm_set1_epi32((int)value);
+    for (; count >= 4; count -= 4, out += 4) {
+        _mm_storeu_si128((__m128i*)out, quad);
+    }
+#endif
+    while (count-- > 0) *out++ = value;
+    return out;
+}
+
+
+bool QOI_ReadHeader(const unsigned char* data, size_t size, int& width, int& height) {
+    if (size < HEADER_SIZE + sizeof(END_MARKER) || memcmp(data, "qoif", 4) != 0) return false;
+    uint32_t w = Read32BE(data + 4);
+    uint32_t h = Read32BE(data + 8);
+    if (w == 0 || h == 0 || (uint64_t)w * h > 400000000ull || data[12] < 3 || data[12] > 4) return false;
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
+
+void QOI_Encode(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& out) {
+    size_t pixel_count = (size_t)width * height;
+    size_t start = out.size();
+    out.resize(start + HEADER_SIZE + pixel_count * 5 + sizeof(END_MARKER));
+    unsigned char* o = out.data() + start;
+
+    memcpy(o, "qoif", 4);
+    Write32BE(o + 4, (uint32_t)width);
+    Write32BE(o + 8, (uint32_t)height);
+    o[12] = 4;  // channels
+    o[13] = 0;  // sRGB with linear alpha
+    o += HEADER_SIZE;
+
+    Pixel index[64];
+    memset(index, 0, sizeof(index));
+    Pixel prev;
+    prev.v = 0;
+    prev.c.a = 255;
+    int run = 0;
+
+    for (size_t i = 0; i < pixel_count; i++) {
+        Pixel px;
+        memcpy(&px.v, rgba + i * 4, 4);
+
+        if (px.v == prev.v) {
+            run++;
+            if (run == 62 || i + 1 == pixel_count) {
+                *o++ = OP_RUN | (uint8_t)(run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            *o++ = OP_RUN | (uint8_t)(run - 1);
+            run = 0;
+        }
+
+        int hash = Hash(px);
+        if (index[hash].v == px.v) {
+            *o++ = OP_INDEX | (uint8_t)hash;
+        } else {
+            index[hash] = px;
+            if (px.c.a == prev.c.a) {
+                int8_t vr = (int8_t)(px.c.r - prev.c.r);
+                int8_t vg = (int8_t)(px.c.g - prev.c.g);
+                int8_t vb = (int8_t)(px.c.b - prev.c.b);
+                int8_t vg_r = (int8_t)(vr - vg);
+                int8_t vg_b = (int8_t)(vb - vg);
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    *o++ = OP_DIFF | (uint8_t)((vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                    *o++ = OP_LUMA | (uint8_t)(vg + 32);
+                    *o++ = (uint8_t)((vg_r + 8) << 4 | (vg_b + 8));
+                } else {
+                    o[0] = OP_RGB;
+                    o[1] = px.c.r;
+                    o[2] = px.c.g;
+                    o[3] = px.c.b;
+                    o += 4;
+                }
+            } else {
+                o[0] = OP_RGBA;
+                memcpy(o + 1, &px.v, 4);
+                o += 5;
+            }
+        }
+        prev = px;
+    }
+
+    memcpy(o, END_MARKER, sizeof(END_MARKER));
+    o += sizeof(END_MARKER);
+    out.resize(o - out.data());
+}
+
+bool QOI_Decode(const unsigned char* data, size_t size, unsigned char* rgba, int width, int height) {
+    int header_width, header_height;
+    if (!QOI_ReadHeader(data, size, header_width, header_height) || header_width != width || header_height != height) return false;
+
+    uint32_t* out = (uint32_t*)rgba;   // rgba comes from malloc/vector storage, 4-byte aligned
+    uint32_t* const out_end = out + (size_t)width * height;
+    const unsigned char* p = data + HEADER_SIZE;
+    // Every op is at most 5 bytes; stop before the end marker
+    const unsigned char* const p_end = data + size - sizeof(END_MARKER);
+
+    Pixel index[64];
+    memset(index, 0, sizeof(index));
+    Pixel px;
+    px.v = 0;
+    px.c.a = 255;
+
+    while (out < out_end) {
+        if (p >= p_end) return false;
+        uint8_t b1 = *p++;
+
+        if (b1 == OP_RGB) {
+            if (p_end - p < 3) return false;
+            px.c.r = p[0];
+            px.c.g = p[1];
+            px.c.b = p[2];
+            p += 3;
+        } else if (b1 == OP_RGBA) {
+            if (p_end - p < 4) return false;
+            memcpy(&px.v, p, 4);
+            p += 4;
+        } else if ((b1 & MASK_2) == OP_INDEX) {
+            px = index[b1];
+            *out++ = px.v;
+            continue;   // already in the index
+        } else if ((b1 & MASK_2) == OP_DIFF) {
+            px.c.r += ((b1 >> 4) & 3) - 2;
+            px.c.g += ((b1 >> 2) & 3) - 2;
+            px.c.b += (b1 & 3) - 2;
+        } else if ((b1 & MASK_2) == OP_LUMA) {
+            if (p >= p_end) return false;
+            uint8_t b2 = *p++;
+            int vg = (b1 & 0x3F) - 32;
+            px.c.r += vg - 8 + ((b2 >> 4) & 0x0F);
+            px.c.g += vg;
+            px.c.b += vg - 8 + (b2 & 0x0F);
+        } else {
+            // The previous pixel repeated, it is in the index already
+            int run = (b1 & 0x3F) + 1;
+            if (run > out_end - out) return false;
+            out = FillRun(out, px.v, run);
+            continue;
+        }
+
+        index[Hash(px)] = px;
+        *out++ = px.v;
+    }
+    return true;
+}
+
+bool QOI_WriteFile(const std::string& path, const unsigned char* rgba, int width, int height) {
+    std::vector<unsigned char> encoded;
+    QOI_Encode(rgba, width, height, encoded);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    return fclose(file) == 0 && written;
+}
+
+bool QOI_ReadFile(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<unsigned char> encoded;
+    unsigned char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        encoded.insert(encoded.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    if (!QOI_ReadHeader(encoded.data(), encoded.size(), width, height)) return false;
+    rgba.resize((size_t)width * height * 4);
+    return QOI_Decode(encoded.data(), encoded.size(), rgba.data(), width, height);
+}
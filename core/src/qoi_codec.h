@@ -0,0 +1,27 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    QOI ("Quite OK Image") lossless codec for the app's own files: persisted previews
+    and captures. Several times faster than PNG both ways at a somewhat larger size.
+    Streams follow the QOI 1.0 spec, always written with 4 channels.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Width and height from the header, false when data is not a QOI stream
+bool QOI_ReadHeader(const unsigned char* data, size_t size, int& width, int& height);
+
+// Appends the encoded RGBA image to out
+void QOI_Encode(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& out);
+
+// Decodes into rgba (width * height * 4 bytes, sizes from QOI_ReadHeader), false on a truncated or malformed stream
+bool QOI_Decode(const unsigned char* data, size_t size, unsigned char* rgba, int width, int height);
+
+// File helpers, rgba is resized to fit
+bool QOI_WriteFile(const std::string& path, const unsigned char* rgba, int width, int height);
+bool QOI_ReadFile(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height);
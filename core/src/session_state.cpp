@@ -0,0 +1,91 @@
+#include "session_state.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+
+static std::vector<std::string> SplitTabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) return fields;
+        start = tab + 1;
+    }
+}
+
+// Five fields from first: x, y, width, height, maximized
+static void ParsePlacement(const std::vector<std::string>& fields, size_t first, WindowPlacement& placement) {
+    if (fields.size() < first + 5) return;
+    placement.x = atoi(fields[first].c_str());
+    placement.y = atoi(fields[first + 1].c_str());
+    placement.width = atoi(fields[first + 2].c_str());
+    placement.height = atoi(fields[first + 3].c_str());
+    placement.maximized = atoi(fields[first + 4].c_str()) != 0;
+}
+
+static void WritePlacement(FILE* file, const WindowPlacement& placement) {
+    fprintf(file, "\t%d\t%d\t%d\t%d\t%d", placement.x, placement.y, placement.width, placement.height, placement.maximized ? 1 : 0);
+}
+
+bool Session_Load(const std::string& path, Session& session) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    session = Session();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = SplitTabs(line);
+        if (fields[0] == "window") {
+            ParsePlacement(fields, 1, session.window);
+        } else if (fields[0] == "root" && fields.size() >= 2) {
+            session.tree_root = fields[1];
+        } else if (fields[0] == "viewer" && fields.size() >= 4) {
+            SessionViewer viewer;
+            viewer.folder = fields[1];
+            viewer.file = fields[2];
+            viewer.index = atoi(fields[3].c_str());
+            ParsePlacement(fields, 4, viewer.placement);
+            session.viewers.push_back(std::move(viewer));
+        } else if (fields[0] == "panel" && fields.size() >= 2) {
+            session.panels.push_back(fields[1]);
+        }
+    }
+    return true;
+}
+
+bool Session_Save(const std::string& path, const Session& session) {
+    std::string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "w");
+    if (!file) return false;
+    fprintf(file, "window");
+    WritePlacement(file, session.window);
+    fprintf(file, "\n");
+    if (!session.tree_root.empty()) fprintf(file, "root\t%s\n", session.tree_root.c_str());
+    for (const SessionViewer& viewer : session.viewers) {
+        fprintf(file, "viewer\t%s\t%s\t%d", viewer.folder.c_str(), viewer.file.c_str(), viewer.index);
+        WritePlacement(file, viewer.placement);
+        fprintf(file, "\n");
+    }
+    for (const std::string& panel : session.panels) {
+        fprintf(file, "panel\t%s\n", panel.c_str());
+    }
+    bool written = !ferror(file);
+    if (fclose(file) != 0 || !written) return false;
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    return !error;
+}
+
+size_t Session_FindIndex(const std::vector<std::string>& files, const std::string& file, int index) {
+    auto it = std::find(files.begin(), files.end(), file);
+    if (it != files.end()) return (size_t)(it - files.begin());
+    if (files.empty() || index < 0) return 0;
+    return std::min((size_t)index, files.size() - 1);
+}
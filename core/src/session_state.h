@@ -0,0 +1,44 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Session persisted between runs: what every viewer showed and where the windows were
+    Tab separated lines, one "viewer" line per viewer with the main one first. Written on exit,
+    read before any window exists so the files shown last can start decoding right away.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+struct WindowPlacement {
+    int x = -1;             // -1 leaves the position to the window manager
+    int y = -1;
+    int width = 0;          // 0 keeps the default size
+    int height = 0;
+    bool maximized = false;
+};
+
+struct SessionViewer {
+    std::string folder;
+    std::string file;       // path shown, the index is found again by it when the folder changed
+    int index = 0;
+    WindowPlacement placement;  // unused for the main viewer
+};
+
+struct Session {
+    WindowPlacement window;
+    std::string tree_root;              // root of the folder tree
+    std::vector<SessionViewer> viewers; // the main viewer first, then the viewer windows
+    std::vector<std::string> panels;    // View menu panels left open
+};
+
+// False when there is no session yet or it cannot be read; unknown lines are skipped
+bool Session_Load(const std::string& path, Session& session);
+
+// Write then rename, an interrupted exit leaves the previous session
+bool Session_Save(const std::string& path, const Session& session);
+
+// Index of file in files, else index clamped to the list
+size_t Session_FindIndex(const std::vector<std::string>& files, const std::string& file, int index);
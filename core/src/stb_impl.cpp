@@ -0,0 +1,5 @@
+// stb_image and stb_image_write are compiled once here for the core library and every app linking it
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
@@ -0,0 +1,96 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::thread::hardware_concurrency();
+        if (thread_count == 0) thread_count = 4;
+    }
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+        workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_cv.notify_one();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& fn) {
+    if (count <= 0) return;
+
+    // Indices are handed out through a shared counter so uneven work balances itself
+    std::atomic<int> next_index(0);
+    std::atomic<int> helpers_running(0);
+    auto drain = [&] {
+        for (int i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+            fn(i);
+        }
+    };
+
+    int helper_count = (int)std::min(workers.size(), (size_t)count - 1);
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    for (int h = 0; h < helper_count; h++) {
+        helpers_running++;
+        Submit([&] {
+            drain();
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--helpers_running == 0) done_cv.notify_one();
+        });
+    }
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&] { return helpers_running.load() == 0; });
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this] { return jobs.empty() && active_jobs == 0; });
+}
+
+bool ThreadPool::Idle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.empty() && active_jobs == 0;
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            active_jobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active_jobs--;
+            if (jobs.empty() && active_jobs == 0) idle_cv.notify_all();
+        }
+    }
+}
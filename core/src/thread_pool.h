@@ -0,0 +1,53 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Small fixed-size worker pool
+    Used by the software rasterizer and the background image work
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+public:
+    // thread_count == 0 picks one worker per hardware thread
+    explicit ThreadPool(size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Size() const { return workers.size(); }
+
+    // Queue a job, returns immediately
+    void Submit(std::function<void()> job);
+
+    // Run fn(i) for i in [0, count) across the workers and the calling thread, returns when all are done
+    void ParallelFor(int count, const std::function<void(int)>& fn);
+
+    // Block until every submitted job has finished
+    void WaitIdle();
+
+    // True when every submitted job has finished, without waiting
+    bool Idle();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable idle_cv;
+    size_t active_jobs = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,601 @@
+// Unit tests of the core image pipeline, no window or GL context needed:
+// codec reference vectors, SIMD kernels against scalar, EXIF parsing, GIF budgets and the decoded cache tiers.
+//
+//   imgui_app_core_tests [name filter]
+//
+// Registered with ctest, a failed check prints its expression and the run exits with 1.
+
+#include "content_hash.h"
+#include "cpu_dispatch.h"
+#include "decoded_cache.h"
+#include "exif_reader.h"
+#include "gif_animation.h"
+#include "icc_profile.h"
+#include "image_ops.h"
+#include "lz4_block.h"
+#include "qoi_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+static int g_failures = 0;
+
+static bool Check(bool ok, const char* expression, const char* file, int line) {
+    if (!ok) {
+        printf("  %s:%d: check failed: %s\n", file, line, expression);
+        g_failures++;
+    }
+    return ok;
+}
+
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+// Same bytes as the generator of the reference values below (64-bit LCG, top byte)
+static std::vector<unsigned char> TestBytes(size_t size) {
+    std::vector<unsigned char> bytes(size);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (unsigned char& byte : bytes) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        byte = (unsigned char)(state >> 56);
+    }
+    return bytes;
+}
+
+// RGBA gradient with some noise, compressible but not trivially
+static std::vector<unsigned char> TestImage(int width, int height, int seed) {
+    std::vector<unsigned char> noise = TestBytes((size_t)width * height + seed);
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char* p = &pixels[((size_t)y * width + x) * 4];
+            unsigned char n = noise[(size_t)y * width + x + seed] & 7;
+            p[0] = (unsigned char)(x * 255 / width + n);
+            p[1] = (unsigned char)(y * 255 / height);
+            p[2] = (unsigned char)((x + y + seed) * 3);
+            p[3] = (unsigned char)(255 - n);
+        }
+    }
+    return pixels;
+}
+
+
+// ---------------------------------------------
+// LZ4
+
+static void Test_LZ4ReferenceBlock() {
+    // Compressed by the reference LZ4_compress_default (liblz4 1.9.4)
+    static const uint8_t block[] = {
+        0xFF, 0x06, 0x4C, 0x5A, 0x34, 0x20, 0x72, 0x65, 0x66, 0x65, 0x72, 0x65, 0x6E, 0x63, 0x65, 0x20,
+        0x62, 0x6C, 0x6F, 0x63, 0x6B, 0x2E, 0x20, 0x15, 0x00, 0x2C, 0xFB, 0x24, 0x00, 0x01, 0x02, 0x03,
+        0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13,
+        0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23,
+        0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x61, 0x62, 0x63, 0x03,
+        0x00, 0xC1, 0x2C, 0x20, 0x74, 0x68, 0x65, 0x20, 0x65, 0x6E, 0x64, 0x20, 0x6F, 0x66, 0x0B, 0x00,
+        0x02, 0x99, 0x00, 0x70, 0x2E, 0x2E, 0x2E, 0x2E, 0x2E, 0x2E, 0x2E,
+    };
+    std::string expected;
+    for (int i = 0; i < 4; i++) expected += "LZ4 reference block. ";
+    for (int i = 0; i < 48; i++) expected += (char)i;
+    expected += "abcabcabcabcabcabc, the end of the block........";
+
+    std::vector<uint8_t> out(expected.size());
+    int size = LZ4Block_Decompress(block, (int)sizeof(block), out.data(), (int)out.size());
+    CHECK(size == (int)expected.size());
+    CHECK(size == (int)expected.size() && memcmp(out.data(), expected.data(), expected.size()) == 0);
+
+    // One byte less room than the output needs is refused, not overrun
+    CHECK(LZ4Block_Decompress(block, (int)sizeof(block), out.data(), (int)out.size() - 1) == -1);
+}
+
+static void Test_LZ4SpecSequences() {
+    // Hand assembled from the block format description: 3 literals, then a 9 byte match at offset 3
+    // that overlaps its own output, then the last 5 literals
+    static const uint8_t block[] = { 0x35, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'd', 'e', 'f', 'g', 'h' };
+    const char* expected = "abcabcabcabcdefgh";
+    uint8_t out[32];
+    int size = LZ4Block_Decompress(block, (int)sizeof(block), out, (int)sizeof(out));
+    CHECK(size == (int)strlen(expected));
+    CHECK(size == (int)strlen(expected) && memcmp(out, expected, size) == 0);
+
+    // Offset 0 and an offset before the start of the output are malformed
+    static const uint8_t zero_offset[] = { 0x35, 'a', 'b', 'c', 0x00, 0x00, 0x50, 'd', 'e', 'f', 'g', 'h' };
+    static const uint8_t far_offset[] = { 0x35, 'a', 'b', 'c', 0x04, 0x00, 0x50, 'd', 'e', 'f', 'g', 'h' };
+    CHECK(LZ4Block_Decompress(zero_offset, (int)sizeof(zero_offset), out, (int)sizeof(out)) == -1);
+    CHECK(LZ4Block_Decompress(far_offset, (int)sizeof(far_offset), out, (int)sizeof(out)) == -1);
+}
+
+static void Test_LZ4RoundTrip() {
+    std::vector<unsigned char> random = TestBytes(70000);
+    std::vector<unsigned char> image = TestImage(300, 200, 1);
+    std::vector<unsigned char> flat(100000, 0x5A);
+    for (const std::vector<unsigned char>* input : { &random, &image, &flat }) {
+        for (int size : { 0, 1, 12, 13, 64, 4096, (int)input->size() }) {
+            std::vector<uint8_t> compressed(LZ4Block_Bound(size));
+            int compressed_size = LZ4Block_Compress(input->data(), size, compressed.data(), (int)compressed.size());
+            CHECK(compressed_size > 0);
+            std::vector<uint8_t> out(size + 1);
+            int out_size = LZ4Block_Decompress(compressed.data(), compressed_size, out.data(), (int)out.size());
+            CHECK(out_size == size);
+            CHECK(out_size == size && memcmp(out.data(), input->data(), size) == 0);
+        }
+    }
+    // Long runs take far less than their size
+    std::vector<uint8_t> compressed(LZ4Block_Bound((int)flat.size()));
+    CHECK(LZ4Block_Compress(flat.data(), (int)flat.size(), compressed.data(), (int)compressed.size()) < 1000);
+}
+
+
+// ---------------------------------------------
+// QOI
+
+static void Test_QOIReferenceStream() {
+    // 4x4 image, encoded by a port of the reference qoi_encode; uses every op
+    // (DIFF, RUN, RGB, LUMA, INDEX, RGBA)
+    static const unsigned char pixels[16][4] = {
+        { 255, 0, 0, 255 }, { 255, 0, 0, 255 }, { 255, 0, 0, 255 }, { 0, 128, 255, 255 },
+        { 1, 129, 254, 255 }, { 10, 140, 7, 255 }, { 255, 0, 0, 255 }, { 10, 140, 7, 128 },
+        { 10, 140, 7, 128 }, { 10, 140, 7, 128 }, { 0, 0, 0, 0 }, { 20, 30, 40, 50 },
+        { 21, 30, 39, 50 }, { 20, 30, 40, 50 }, { 200, 100, 50, 255 }, { 200, 100, 50, 255 },
+    };
+    static const unsigned char stream[] = {
+        0x71, 0x6F, 0x69, 0x66, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x04, 0x00, 0x5A, 0xC1,
+        0xFE, 0x00, 0x80, 0xFF, 0x7D, 0xAB, 0x66, 0x32, 0xFF, 0x0A, 0x8C, 0x07, 0x80, 0xC1, 0xFF, 0x00,
+        0x00, 0x00, 0x00, 0xFF, 0x14, 0x1E, 0x28, 0x32, 0x79, 0x10, 0xFF, 0xC8, 0x64, 0x32, 0xFF, 0xC0,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    };
+
+    std::vector<unsigned char> encoded;
+    QOI_Encode(&pixels[0][0], 4, 4, encoded);
+    CHECK(encoded.size() == sizeof(stream));
+    CHECK(encoded.size() == sizeof(stream) && memcmp(encoded.data(), stream, sizeof(stream)) == 0);
+
+    int width = 0, height = 0;
+    CHECK(QOI_ReadHeader(stream, sizeof(stream), width, height) && width == 4 && height == 4);
+    unsigned char decoded[16][4];
+    CHECK(QOI_Decode(stream, sizeof(stream), &decoded[0][0], 4, 4));
+    CHECK(memcmp(decoded, pixels, sizeof(pixels)) == 0);
+
+    // Cut inside the pixel ops
+    CHECK(!QOI_Decode(stream, 30, &decoded[0][0], 4, 4));
+}
+
+static void Test_QOIRoundTrip() {
+    for (int size : { 1, 7, 63, 256 }) {
+        std::vector<unsigned char> image = TestImage(size, size + 3, size);
+        std::vector<unsigned char> encoded;
+        QOI_Encode(image.data(), size, size + 3, encoded);
+        int width = 0, height = 0;
+        CHECK(QOI_ReadHeader(encoded.data(), encoded.size(), width, height) && width == size && height == size + 3);
+        std::vector<unsigned char> decoded(image.size());
+        CHECK(QOI_Decode(encoded.data(), encoded.size(), decoded.data(), size, size + 3));
+        CHECK(decoded == image);
+    }
+}
+
+
+// ---------------------------------------------
+// XXH3 and the dispatched kernels
+
+static void Test_ContentHashReference() {
+    // XXH3_64bits() of libxxhash 0.8.1 over the first size bytes of TestBytes(100000),
+    // covers every input length branch and the long loop's stripe and block ends
+    static const struct { size_t size; uint64_t hash; } vectors[] = {
+        { 0, 0x2D06800538D394C2ull },       { 1, 0x32CD626F54BA457Eull },
+        { 3, 0x35C59C63F67C71A2ull },       { 4, 0x014BD96CDB45C430ull },
+        { 8, 0x065D72EAA49E406Bull },       { 9, 0xB5D7BCF9493DD00Eull },
+        { 16, 0x0C9057C1B3EF2E34ull },      { 17, 0xFEEDDBF262130327ull },
+        { 128, 0x218476E38AAED14Bull },     { 129, 0x9FD3F0D53E509B70ull },
+        { 240, 0xEC4B87AD468105D4ull },     { 241, 0x6F7BEF3AD1555088ull },
+        { 1024, 0xC768E7D19AABF178ull },    { 1025, 0xACCE310A930447F1ull },
+        { 100000, 0x3A9EA31FDBBD930Dull },
+    };
+    std::vector<unsigned char> bytes = TestBytes(100000);
+    for (const auto& vector : vectors) {
+        if (!CHECK(ContentHash_Scalar(bytes.data(), vector.size) == vector.hash)) {
+            printf("  scalar hash of %zu bytes\n", vector.size);
+        }
+        if (!CHECK(ContentHash(bytes.data(), vector.size) == vector.hash)) {
+            printf("  hash of %zu bytes at %s\n", vector.size, CpuDispatch_LevelName(CpuDispatch_Kernels().level));
+        }
+    }
+}
+
+static void Test_DispatchLevelsMatchScalar() {
+    std::vector<unsigned char> bytes = TestBytes(70000);
+    std::vector<unsigned char> image = TestImage(641, 479, 2);
+    static const struct { int src_width, src_height, dst_width, dst_height; } sizes[] = {
+        { 1, 1, 1, 1 }, { 37, 23, 5, 3 }, { 641, 479, 128, 96 }, { 333, 77, 128, 29 }, { 64, 64, 64, 64 }, { 641, 1, 17, 1 },
+    };
+
+    CpuLevel detected = CpuDispatch_Detect();
+    for (CpuLevel level : { CpuLevel::Scalar, CpuLevel::SSE2, CpuLevel::AVX2, CpuLevel::AVX512, CpuLevel::NEON }) {
+        if (!CpuDispatch_Supported(level)) continue;
+        CpuDispatch_Select(level);
+        const char* name = CpuDispatch_LevelName(level);
+        CHECK(CpuDispatch_Kernels().level == level);
+
+        for (size_t size : { (size_t)241, (size_t)1024, (size_t)1025, (size_t)4096 + 17, bytes.size() }) {
+            if (!CHECK(ContentHash(bytes.data(), size) == ContentHash_Scalar(bytes.data(), size))) {
+                printf("  %s hash of %zu bytes\n", name, size);
+            }
+        }
+        for (const auto& s : sizes) {
+            // Same source bytes, the first rows of the test image at the source width
+            std::vector<unsigned char> expected((size_t)s.dst_width * s.dst_height * 4);
+            std::vector<unsigned char> actual(expected.size(), 0xCD);
+            DownscaleBox_Scalar(image.data(), s.src_width, s.src_height, expected.data(), s.dst_width, s.dst_height);
+            DownscaleBox(image.data(), s.src_width, s.src_height, actual.data(), s.dst_width, s.dst_height);
+            if (!CHECK(actual == expected)) {
+                printf("  %s downscale %dx%d -> %dx%d\n", name, s.src_width, s.src_height, s.dst_width, s.dst_height);
+            }
+        }
+    }
+    CpuDispatch_Select(detected);
+}
+
+
+// ---------------------------------------------
+// EXIF
+
+// JPEG head with an APP1 EXIF block: IFD0 holds the orientation, IFD1 points at a 4 byte thumbnail
+static std::vector<unsigned char> ExifJpeg(bool big_endian, uint16_t orientation) {
+    std::vector<unsigned char> tiff;
+    auto put16 = [&](uint16_t v) {
+        if (big_endian) { tiff.push_back(v >> 8); tiff.push_back(v & 0xFF); }
+        else { tiff.push_back(v & 0xFF); tiff.push_back(v >> 8); }
+    };
+    auto put32 = [&](uint32_t v) {
+        if (big_endian) { put16(v >> 16); put16(v & 0xFFFF); }
+        else { put16(v & 0xFFFF); put16(v >> 16); }
+    };
+    tiff.push_back(big_endian ? 'M' : 'I');
+    tiff.push_back(big_endian ? 'M' : 'I');
+    put16(42);
+    put32(8);           // IFD0
+    put16(1);
+    put16(0x0112); put16(3); put32(1); put16(orientation); put16(0);
+    put32(26);          // IFD1
+    put16(2);
+    put16(0x0201); put16(4); put32(1); put32(56);
+    put16(0x0202); put16(4); put32(1); put32(4);
+    put32(0);
+    const unsigned char thumbnail[] = { 0xFF, 0xD8, 0xFF, 0xD9 };
+    tiff.insert(tiff.end(), thumbnail, thumbnail + 4);
+
+    size_t length = 2 + 6 + tiff.size();
+    std::vector<unsigned char> jpeg = { 0xFF, 0xD8, 0xFF, 0xE1, (unsigned char)(length >> 8), (unsigned char)length };
+    jpeg.insert(jpeg.end(), { 'E', 'x', 'i', 'f', 0, 0 });
+    jpeg.insert(jpeg.end(), tiff.begin(), tiff.end());
+    jpeg.insert(jpeg.end(), { 0xFF, 0xDA, 0x00, 0x02 });
+    return jpeg;
+}
+
+static void Test_ExifThumbnail() {
+    for (bool big_endian : { false, true }) {
+        std::vector<unsigned char> jpeg = ExifJpeg(big_endian, 6);
+        ExifInfo info;
+        CHECK(Exif_Parse(jpeg.data(), jpeg.size(), info));
+        CHECK(info.orientation == 6);
+        CHECK(info.thumbnail_offset == 12 + 56 && info.thumbnail_size == 4);
+        CHECK(info.thumbnail_offset + 4 <= jpeg.size() && jpeg[info.thumbnail_offset] == 0xFF && jpeg[info.thumbnail_offset + 1] == 0xD8);
+
+        // A head that ends inside the thumbnail keeps the orientation, not the thumbnail
+        CHECK(Exif_Parse(jpeg.data(), 12 + 58, info));
+        CHECK(info.orientation == 6 && info.thumbnail_size == 0);
+    }
+
+    // Out of range orientations read as upright
+    std::vector<unsigned char> jpeg = ExifJpeg(false, 9);
+    ExifInfo info;
+    CHECK(Exif_Parse(jpeg.data(), jpeg.size(), info) && info.orientation == 1);
+
+    // Not a JPEG, and a JPEG whose image data starts before any EXIF block
+    jpeg[0] = 0x89;
+    CHECK(!Exif_Parse(jpeg.data(), jpeg.size(), info));
+    const unsigned char no_exif[] = { 0xFF, 0xD8, 0xFF, 0xDA, 0x00, 0x02, 0x00 };
+    CHECK(!Exif_Parse(no_exif, sizeof(no_exif), info));
+}
+
+
+// ---------------------------------------------
+// GIF
+
+// width x height GIF with one graphic control extension (delay in 1/100 s) and image per frame.
+// Each frame is a single color index, written as uncompressed LZW codes.
+static std::vector<unsigned char> TestGif(int width, int height, const std::vector<int>& delays_cs) {
+    std::vector<unsigned char> gif = { 'G', 'I', 'F', '8', '9', 'a' };
+    auto put16 = [&](int v) { gif.push_back(v & 0xFF); gif.push_back(v >> 8); };
+    put16(width);
+    put16(height);
+    gif.insert(gif.end(), { 0x81, 0, 0 });      // 4 entry global color table
+    gif.insert(gif.end(), { 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255 });
+    for (size_t frame = 0; frame < delays_cs.size(); frame++) {
+        gif.insert(gif.end(), { 0x21, 0xF9, 4, 0x04 });   // disposal: leave in place
+        put16(delays_cs[frame]);
+        gif.insert(gif.end(), { 0, 0 });
+        gif.push_back(0x2C);
+        put16(0);
+        put16(0);
+        put16(width);
+        put16(height);
+        gif.push_back(0);
+
+        // Minimum code size 2: codes 0-3 are colors, 4 clear, 5 end. A clear before every second
+        // code keeps the codes 3 bits wide.
+        const int color = (int)(frame % 4), clear = 4, end = 5;
+        std::vector<int> codes;
+        int pixels = width * height;
+        for (int i = 0; i < pixels; i++) {
+            if (i % 2 == 0) codes.push_back(clear);
+            codes.push_back(color);
+        }
+        codes.push_back(end);
+        std::vector<unsigned char> lzw;
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (int code : codes) {
+            bits |= (uint32_t)code << bit_count;
+            bit_count += 3;
+            while (bit_count >= 8) {
+                lzw.push_back(bits & 0xFF);
+                bits >>= 8;
+                bit_count -= 8;
+            }
+        }
+        if (bit_count > 0) lzw.push_back(bits & 0xFF);
+
+        gif.push_back(2);
+        for (size_t pos = 0; pos < lzw.size(); pos += 255) {
+            size_t length = std::min<size_t>(255, lzw.size() - pos);
+            gif.push_back((unsigned char)length);
+            gif.insert(gif.end(), lzw.begin() + pos, lzw.begin() + pos + length);
+        }
+        gif.push_back(0);
+    }
+    gif.push_back(0x3B);
+    return gif;
+}
+
+static std::string WriteTempFile(const char* name, const std::vector<unsigned char>& data) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return path;
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    return path;
+}
+
+static void Test_GifScanBudget() {
+    std::vector<unsigned char> gif = TestGif(16, 8, { 5, 0, 20 });
+    int width = 0, height = 0;
+    std::vector<int> delays;
+    CHECK(GifScan(gif.data(), gif.size(), width, height, delays));
+    CHECK(width == 16 && height == 8);
+    CHECK(delays == std::vector<int>({ 50, 0, 200 }));
+
+    // A truncated last frame is left out, a non-GIF is refused
+    CHECK(GifScan(gif.data(), gif.size() - 6, width, height, delays) && delays.size() == 2);
+    CHECK(!GifScan(gif.data() + 1, gif.size() - 1, width, height, delays));
+
+    // Three 16x8 frames take 1536 bytes composited: turned down from the frame table alone
+    std::string path = WriteTempFile("imgui_app_core_tests.gif", gif);
+    int over_budget = animation_stats.over_budget;
+    int files_decoded = animation_stats.files_decoded;
+    GifFrames frames;
+    CHECK(!Gif_LoadFrames(path, 3 * 16 * 8 * 4 - 1, frames));
+    CHECK(animation_stats.over_budget == over_budget + 1);
+    CHECK(animation_stats.files_decoded == files_decoded);
+
+    // A still GIF is not an animation whatever the budget
+    std::string still = WriteTempFile("imgui_app_core_tests_still.gif", TestGif(16, 8, { 10 }));
+    CHECK(!Gif_LoadFrames(still, 1u << 20, frames));
+    CHECK(animation_stats.over_budget == over_budget + 1);
+    std::filesystem::remove(path);
+    std::filesystem::remove(still);
+}
+
+// 12x10, real LZW codes growing past 3 bits. Frame 1 is a sub-rectangle with a local color table and
+// a transparent index, restored afterwards; frame 2 is interlaced and cleared afterwards.
+// The hashes are Pillow's composited frames, except that the area frame 2 leaves is transparent
+// (as in browsers and stb_image) where Pillow paints the background color.
+static void Test_GifReferenceFrames() {
+    const std::vector<unsigned char> gif = {
+        0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x0C, 0x00, 0x0A, 0x00, 0xF2, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xFF, 0xFF, 0xFF, 0xC8, 0x1E, 0x1E, 0x1E, 0xC8, 0x1E, 0x1E, 0x1E, 0xC8, 0xDC, 0xDC, 0x00, 0x00,
+        0xC8, 0xDC, 0x80, 0x40, 0xC8, 0x21, 0xF9, 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00,
+        0x00, 0x00, 0x0C, 0x00, 0x0A, 0x00, 0x00, 0x03, 0x34, 0x08, 0x63, 0x41, 0x27, 0x45, 0xB1, 0x12,
+        0x8A, 0x11, 0xE6, 0x8C, 0x03, 0x08, 0x10, 0x47, 0x30, 0x7C, 0x84, 0x58, 0x08, 0x0E, 0x24, 0x35,
+        0x4F, 0xE4, 0x11, 0x94, 0x85, 0x69, 0xA1, 0xF1, 0x85, 0x23, 0x2A, 0x32, 0x69, 0xB4, 0xB0, 0x9B,
+        0xC1, 0x2B, 0x76, 0xB1, 0x15, 0x6A, 0x37, 0xD1, 0xC7, 0xC7, 0x6B, 0x49, 0x12, 0x00, 0x21, 0xF9,
+        0x04, 0x0D, 0x04, 0x00, 0x00, 0x00, 0x2C, 0x02, 0x00, 0x03, 0x00, 0x06, 0x00, 0x04, 0x00, 0x81,
+        0x0A, 0x14, 0x1E, 0xF0, 0x0A, 0x0A, 0x0A, 0xF0, 0x0A, 0xFA, 0xFA, 0xFA, 0x02, 0x08, 0x44, 0x34,
+        0x76, 0x79, 0x68, 0xC8, 0x5C, 0x01, 0x00, 0x21, 0xF9, 0x04, 0x08, 0x06, 0x00, 0x00, 0x00, 0x2C,
+        0x01, 0x00, 0x01, 0x00, 0x08, 0x00, 0x06, 0x00, 0x40, 0x03, 0x1D, 0x08, 0x21, 0x43, 0x65, 0x07,
+        0x14, 0x71, 0x48, 0x30, 0x03, 0x0C, 0x13, 0xC8, 0x11, 0x05, 0x20, 0x10, 0x86, 0x48, 0x02, 0x04,
+        0xAA, 0xA6, 0x06, 0x21, 0x00, 0xAD, 0x90, 0x00, 0x00, 0x21, 0xF9, 0x04, 0x04, 0x0A, 0x00, 0x00,
+        0x00, 0x2C, 0x04, 0x00, 0x02, 0x00, 0x05, 0x00, 0x05, 0x00, 0x00, 0x03, 0x0C, 0x08, 0x21, 0x43,
+        0x4C, 0xC5, 0x40, 0x73, 0x00, 0x55, 0x02, 0xB7, 0x04, 0x00, 0x3B,
+    };
+    const uint64_t expected[] = { 0x9A16C28D463F9A83ull, 0xFFCB7F2C5C683207ull, 0xAA70F088F35C1351ull, 0xCCEDB4429135A15Aull };
+
+    GifDecoder decoder;
+    CHECK(decoder.Open(gif));
+    CHECK(decoder.Width() == 12 && decoder.Height() == 10);
+    CHECK(decoder.DelaysMs() == std::vector<int>({ 80, 40, 60, 100 }));
+    // Twice through, the second loop starts over from a cleared canvas
+    for (int i = 0; i < 8; i++) {
+        CHECK(decoder.Next() && decoder.FrameIndex() == i % 4);
+        CHECK(ContentHash(decoder.Canvas(), 12 * 10 * 4) == expected[i % 4]);
+    }
+}
+
+// Over the budget the frames stream through a ring: played in order through two loops, each frame
+// the same as when all of them are kept
+static void Test_GifOverBudgetPlayback() {
+    std::string path = WriteTempFile("imgui_app_core_tests_stream.gif", TestGif(16, 8, { 5, 10, 10, 5, 20, 10, 10 }));
+    GifFrames all;
+    CHECK(Gif_LoadFrames(path, 1u << 20, all));
+
+    // Turned down by the budget, the decoder is left at its start ready to stream
+    GifDecoder decoder;
+    GifFrames frames;
+    CHECK(decoder.Open(path));
+    CHECK(!Gif_LoadFrames(decoder, decoder.FramesSize() - 1, frames));
+    CHECK(decoder.FrameIndex() == -1 && decoder.DelaysMs() == all.delays_ms);
+
+    const int frame_count = decoder.FrameCount(), slot_count = 3;
+    const size_t frame_size = (size_t)decoder.Width() * decoder.Height() * 4;
+    std::vector<unsigned char> slots(slot_count * frame_size);
+    GifRing ring(frame_count, slot_count);
+    auto decode_next = [&] {
+        int slot, frame;
+        if (!ring.Reserve(slot, frame)) return false;
+        CHECK(decoder.Next() && decoder.FrameIndex() == frame);
+        memcpy(slots.data() + slot * frame_size, decoder.Canvas(), frame_size);
+        ring.Push();
+        return true;
+    };
+    auto show = [&](int frame) {
+        int slot = ring.Find(frame);
+        if (slot < 0) return false;
+        CHECK(memcmp(slots.data() + slot * frame_size, all.Frame(frame), frame_size) == 0);
+        ring.Show(frame);
+        return true;
+    };
+
+    // Nothing to show before the first frame decodes. The frame on screen and two ahead then fill
+    // the ring, the decoder waits for playback to move on.
+    CHECK(!show(0));
+    while (decode_next()) {}
+    CHECK(show(0));
+    CHECK(!show(slot_count) && !decode_next());
+
+    // Decoding at half the playback rate, playback waits for frames rather than skipping them
+    int next = 1, waits = 0;
+    for (int step = 0; next <= 2 * frame_count && step < 100; step++) {
+        if (step % 2 == 0) decode_next();
+        if (show(next % frame_count)) {
+            next++;
+        } else {
+            waits++;
+        }
+    }
+    CHECK(next > 2 * frame_count && waits > 0);
+    std::filesystem::remove(path);
+}
+
+
+// ---------------------------------------------
+// Decoded cache
+
+// Flat 16 pixel wide stripes, the kind of content the LZ4 tier shrinks
+static std::shared_ptr<DecodedImage> MakeImage(int width, int height, int seed) {
+    auto image = std::make_shared<DecodedImage>();
+    image->width = width;
+    image->height = height;
+    image->pixels = (unsigned char*)malloc(image->Size());
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char* p = image->pixels + ((size_t)y * width + x) * 4;
+            p[0] = (unsigned char)(y * 255 / height);
+            p[1] = (unsigned char)(seed * 40);
+            p[2] = (unsigned char)(x / 16 * 8);
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+static bool SamePixels(const std::shared_ptr<const DecodedImage>& a, const std::shared_ptr<const DecodedImage>& b) {
+    return a && b && a->width == b->width && a->height == b->height && memcmp(a->pixels, b->pixels, a->Size()) == 0;
+}
+
+static void Test_DecodedCacheTiers() {
+    std::shared_ptr<DecodedImage> a = MakeImage(200, 150, 1);
+    std::shared_ptr<DecodedImage> b = MakeImage(200, 150, 2);
+    auto profile = std::make_shared<IccProfile>();
+    profile->hash = 42;
+    a->icc = profile;
+
+    // Room for one raw image: putting b demotes a to the LZ4 tier
+    DecodedCache cache(a->Size(), 64u << 20);
+    cache.Put("a", a);
+    cache.Put("b", b);
+    CHECK(cache.stats.demotions == 1 && cache.stats.evictions == 0);
+    CHECK(cache.stats.raw_bytes == b->Size());
+    CHECK(cache.stats.compressed_bytes > 0 && cache.stats.compressed_bytes < a->Size());
+    CHECK(cache.stats.compressed_source_bytes == a->Size());
+    CHECK(cache.Contains("a") && cache.Contains("b") && !cache.Contains("c"));
+
+    // A compressed hit expands to the same pixels and profile and goes back to raw, demoting b
+    std::shared_ptr<const DecodedImage> a_back = cache.Get("a");
+    CHECK(SamePixels(a_back, a));
+    CHECK(a_back && a_back->icc == profile);
+    CHECK(cache.stats.compressed_hits == 1);
+    CHECK(cache.stats.demotions == 2);
+    CHECK(cache.stats.compressed_source_bytes == b->Size());
+
+    CHECK(SamePixels(cache.Get("a"), a));
+    CHECK(cache.stats.raw_hits == 1);
+    CHECK(SamePixels(cache.Get("b"), b));
+    CHECK(cache.stats.compressed_hits == 2);
+
+    CHECK(!cache.Get("c"));
+    CHECK(cache.stats.misses == 1);
+
+    // Without a compressed budget demoted images are evicted
+    DecodedCache raw_only(a->Size(), 0);
+    raw_only.Put("a", a);
+    raw_only.Put("b", b);
+    CHECK(raw_only.stats.evictions == 1);
+    CHECK(!raw_only.Get("a"));
+    CHECK(SamePixels(raw_only.Get("b"), b));
+
+    // Shrinking the budgets rebalances at once, the newest image always stays raw
+    cache.SetBudgets(0, 0);
+    CHECK(cache.stats.compressed_bytes == 0);
+    CHECK(cache.stats.raw_bytes == b->Size());
+    cache.Clear();
+    CHECK(!cache.Contains("b") && cache.stats.raw_bytes == 0);
+}
+
+
+// ---------------------------------------------
+
+int main(int argc, char** argv) {
+    static const struct { const char* name; void (*run)(); } tests[] = {
+        { "lz4_reference_block", Test_LZ4ReferenceBlock },
+        { "lz4_spec_sequences", Test_LZ4SpecSequences },
+        { "lz4_round_trip", Test_LZ4RoundTrip },
+        { "qoi_reference_stream", Test_QOIReferenceStream },
+        { "qoi_round_trip", Test_QOIRoundTrip },
+        { "content_hash_reference", Test_ContentHashReference },
+        { "dispatch_levels_match_scalar", Test_DispatchLevelsMatchScalar },
+        { "exif_thumbnail", Test_ExifThumbnail },
+        { "gif_scan_budget", Test_GifScanBudget },
+        { "gif_reference_frames", Test_GifReferenceFrames },
+        { "gif_over_budget_playback", Test_GifOverBudgetPlayback },
+        { "decoded_cache_tiers", Test_DecodedCacheTiers },
+    };
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int failed_tests = 0, run = 0;
+    for (const auto& test : tests) {
+        if (filter && !strstr(test.name, filter)) continue;
+        int failures = g_failures;
+        test.run();
+        run++;
+        bool passed = g_failures == failures;
+        if (!passed) failed_tests++;
+        printf("%-32s %s\n", test.name, passed ? "ok" : "FAILED");
+    }
+    printf("%d of %d tests passed\n", run - failed_tests, run);
+    return failed_tests ? 1 : 0;
+}
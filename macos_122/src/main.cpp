@@ -8,6 +8,7 @@
 #include "imgui_impl_opengl3.h"
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 #include <filesystem>
@@ -26,9 +27,12 @@
 #pragma comment(linker, "/SUBSYSTEM:windows /ENTRY:mainCRTStartup")
 #endif
 
-#define STB_IMAGE_IMPLEMENTATION
+// stb_image is implemented once in core/src/stb_impl.cpp
 #include "stb_image.h"
 
+#include "decoded_cache.h"
+#include "image_files.h"
+
 void setup_fonts(ImGuiIO& io);
 void setup_logo(GLFWwindow* window);
 
@@ -108,27 +112,6 @@ GLuint LoadTextureFromFile(const char* filename) {
     return texture;
 }
 
-bool EndsWith(const std::string& str, const std::string& suffix) {
-    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
-}
-
-std::vector<std::string> GetImageFiles(const std::string& directory) {
-    std::vector<std::string> image_files;
-    std::filesystem::path dirPath(directory);
-    if (!std::filesystem::exists(dirPath) || !std::filesystem::is_directory(dirPath)) {
-        return image_files;
-    }
-    for (const auto& entry : std::filesystem::directory_iterator(dirPath)) {
-        if (entry.is_regular_file()) {
-            std::string path = entry.path().string();
-            if (EndsWith(path, ".png") || EndsWith(path, ".jpg") || EndsWith(path, ".jpeg")) {
-                image_files.push_back(path);
-            }
-        }
-    }
-    return image_files;
-}
-
 void ShowImageSubwindow(const char* title, const std::string& directory, int width = -1, int height = -1) {
     static std::vector<std::string> image_files;
     static std::string last_directory;
@@ -140,18 +123,26 @@ void ShowImageSubwindow(const char* title, const std::string& directory, int wid
     static GLuint texture = 0;
     static int img_width = 0, img_height = 0;
 
+    // Decoded images stay cached, going back and forth does not decode the files again
+    static DecodedCache decoded_cache((size_t)256 << 20, (size_t)128 << 20);
+
     if (texture == 0 && !image_files.empty()) {
         const std::string& image_path = image_files[current_image_index];
-        int channels;
-        unsigned char* data = stbi_load(image_path.c_str(), &img_width, &img_height, &channels, 4);
-        if (data) {
+        std::shared_ptr<const DecodedImage> image = decoded_cache.Load(image_path);
+        if (image) {
+            img_width = image->width;
+            img_height = image->height;
             glGenTextures(1, &texture);
             glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img_width, img_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            // Ensure rows are tightly packed regardless of width
+            GLint prevUnpackAlign = 0;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevUnpackAlign);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img_width, img_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, prevUnpackAlign);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glBindTexture(GL_TEXTURE_2D, 0);
-            stbi_image_free(data);
         } else {
             std::cerr << "Failed to load image: " << image_path << std::endl;
             return;
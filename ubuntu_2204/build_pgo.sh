@@ -0,0 +1,142 @@
+#!/bin/bash
+
+# Profile guided + link time optimized build
+# 1. plain Release build, kept as pgo/bin/release
+# 2. instrumented build (PGO=GENERATE) runs the headless and codec benchmarks to write profiles
+# 3. rebuild with the profiles (PGO=USE), kept as pgo/bin/pgo
+# 4. both binaries run the same workload, pgo/report.txt compares frame and decode numbers
+#
+# Usage: ./build_pgo.sh [headless frames] [runs per binary]
+
+FRAMES=${1:-600}
+RUNS=${2:-3}
+
+ROOT_DIR="$(cd "$(dirname "$0")" && pwd)"
+APP_DIR="${ROOT_DIR}/application"
+PGO_DIR="${ROOT_DIR}/pgo"
+PROFILE_DIR="${PGO_DIR}/profiles"
+BIN_DIR="${PGO_DIR}/bin"
+RUN_DIR="${PGO_DIR}/runs"
+REPORT="${PGO_DIR}/report.txt"
+
+# Function to print a separator
+print_separator() {
+    echo "============================================"
+}
+
+fail() {
+    echo "Error: $1"
+    exit 1
+}
+
+# Configures and builds in build directory $1 with the remaining cmake arguments,
+# the executable lands in application/
+build() {
+    local build_dir="$1"
+    shift
+    cmake -S "${ROOT_DIR}" -B "${build_dir}" -DCMAKE_BUILD_TYPE=Release -DPGO_PROFILE_DIR="${PROFILE_DIR}" "$@" || return 1
+    cmake --build "${build_dir}" -j"$(nproc)" || return 1
+    [ -f "${APP_DIR}/cmake-imgui-app" ]
+}
+
+# Runs the benchmark workload with binary $1, outputs go to runs/$2_*. Runs from application/
+# where the build copied data/. No preview cache so every run decodes, no hitch dumps.
+run_workload() {
+    local binary="$1"
+    local name="$2"
+    local common=(--cache-dir "" --hitch-ms 0 --log-file "${RUN_DIR}/${name}.log")
+    (cd "${APP_DIR}" && "${binary}" --headless "${FRAMES}" --headless-out "${RUN_DIR}/${name}_frame.ppm" \
+        --metrics-file "${RUN_DIR}/${name}.prom" "${common[@]}" > "${RUN_DIR}/${name}_headless.txt") || return 1
+    (cd "${APP_DIR}" && "${binary}" --bench-codec data/ "${common[@]}" > "${RUN_DIR}/${name}_codec.txt") || return 1
+}
+
+# Value of an unlabelled sample in a Prometheus text file
+prom_value() {
+    awk -v name="$2" '$1 == name { print $2 }' "$1"
+}
+
+# One line of numbers for run $1:
+# frame avg ms, frame worst ms, mean frame ms (metrics), mean decode ms (metrics), PNG decode MB/s, QOI decode MB/s, downscale MB/s
+run_numbers() {
+    local name="$1"
+    local headless codec
+    headless=$(awk '$1 == "headless:" { print $6, $9 }' "${RUN_DIR}/${name}_headless.txt")
+    codec=$(awk '$1 == "total" { png = $8; qoi = $13 } $1 == "thumbnail" { downscale = $(NF - 1) } END { print png, qoi, downscale }' "${RUN_DIR}/${name}_codec.txt")
+    local frame_sum frame_count decode_sum decode_count
+    frame_sum=$(prom_value "${RUN_DIR}/${name}.prom" app_frame_seconds_sum)
+    frame_count=$(prom_value "${RUN_DIR}/${name}.prom" app_frame_seconds_count)
+    decode_sum=$(prom_value "${RUN_DIR}/${name}.prom" image_decode_seconds_sum)
+    decode_count=$(prom_value "${RUN_DIR}/${name}.prom" image_decode_seconds_count)
+    awk -v h="${headless}" -v c="${codec}" -v fs="${frame_sum:-0}" -v fc="${frame_count:-0}" -v ds="${decode_sum:-0}" -v dc="${decode_count:-0}" \
+        'BEGIN { printf "%s %.4f %.4f %s\n", h, (fc > 0 ? fs * 1000 / fc : 0), (dc > 0 ? ds * 1000 / dc : 0), c }'
+}
+
+# Best of the runs of binary $1 per column, lower is better for the first four
+best_numbers() {
+    local name="$1"
+    for run in $(seq 1 "${RUNS}"); do
+        run_numbers "${name}_${run}"
+    done | awk '{
+        for (i = 1; i <= NF; i++) {
+            if (NR == 1) best[i] = $i
+            else if (i <= 4 && $i < best[i]) best[i] = $i
+            else if (i > 4 && $i > best[i]) best[i] = $i
+        }
+    } END { for (i = 1; i <= 7; i++) printf "%s ", best[i]; print "" }'
+}
+
+command -v cmake > /dev/null || fail "cmake not found."
+rm -rf "${PGO_DIR}"
+mkdir -p "${PROFILE_DIR}" "${BIN_DIR}" "${RUN_DIR}" || fail "Failed to create ${PGO_DIR}."
+
+# Plain Release
+print_separator
+echo "Building the Release baseline..."
+build "${ROOT_DIR}/build_release" -DPGO=OFF -DENABLE_LTO=OFF || fail "Failed to build the Release baseline."
+cp "${APP_DIR}/cmake-imgui-app" "${BIN_DIR}/release" || fail "Failed to keep the Release binary."
+
+# Instrumented build and training run, the same build directory is reused for PGO=USE
+# so the profile file names match the objects
+print_separator
+echo "Building the instrumented binary..."
+build "${ROOT_DIR}/build_pgo" -DPGO=GENERATE || fail "Failed to build the instrumented binary."
+echo "Collecting profiles (${FRAMES} headless frames and the codec benchmark)..."
+run_workload "${APP_DIR}/cmake-imgui-app" training || fail "The training run failed."
+
+if grep -qs 'CMAKE_CXX_COMPILER_ID "\(Apple\)\?Clang"' "${ROOT_DIR}"/build_pgo/CMakeFiles/*/CMakeCXXCompiler.cmake; then
+    PROFDATA=$(command -v llvm-profdata || ls /usr/bin/llvm-profdata-* 2> /dev/null | head -n 1)
+    [ -n "${PROFDATA}" ] || fail "llvm-profdata not found, needed to merge clang profiles."
+    "${PROFDATA}" merge -o "${PROFILE_DIR}/default.profdata" "${PROFILE_DIR}"/*.profraw || fail "Failed to merge the profiles."
+fi
+
+# Optimized with the profiles
+print_separator
+echo "Building with the profiles..."
+build "${ROOT_DIR}/build_pgo" -DPGO=USE || fail "Failed to build with the profiles."
+cp "${APP_DIR}/cmake-imgui-app" "${BIN_DIR}/pgo" || fail "Failed to keep the PGO binary."
+
+# Alternate the binaries so both see the same machine state
+print_separator
+echo "Running the workload ${RUNS} times per binary..."
+for run in $(seq 1 "${RUNS}"); do
+    run_workload "${BIN_DIR}/release" "release_${run}" || fail "Release run ${run} failed."
+    run_workload "${BIN_DIR}/pgo" "pgo_${run}" || fail "PGO run ${run} failed."
+done
+
+read -r -a RELEASE <<< "$(best_numbers release)"
+read -r -a OPTIMIZED <<< "$(best_numbers pgo)"
+LABELS=("frame avg ms (headless)" "frame worst ms (headless)" "frame mean ms (metrics)" "decode mean ms (metrics)"
+        "PNG decode MB/s" "QOI decode MB/s" "thumbnail downscale MB/s")
+{
+    echo "PGO + LTO vs Release, best of ${RUNS} runs, ${FRAMES} headless frames + codec benchmark"
+    printf "%-28s %12s %12s %9s\n" "" "release" "pgo" "change"
+    for i in "${!LABELS[@]}"; do
+        awk -v label="${LABELS[$i]}" -v a="${RELEASE[$i]}" -v b="${OPTIMIZED[$i]}" \
+            'BEGIN { printf "%-28s %12.3f %12.3f %8.1f%%\n", label, a, b, (a > 0 ? (b - a) * 100 / a : 0) }'
+    done
+} > "${REPORT}"
+
+print_separator
+cat "${REPORT}"
+print_separator
+echo "Binaries in ${BIN_DIR}, run outputs in ${RUN_DIR}."
@@ -0,0 +1,241 @@
+#include "color_manager.h"
+#include "gl_resources.h"
+#include "logger.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+
+// Same interface as the backend's shaders: its vertex buffer layout and ProjMtx, the image on unit 0
+static const char* VERTEX_SHADER =
+    "uniform mat4 ProjMtx;\n"
+    "in vec2 Position;\n"
+    "in vec2 UV;\n"
+    "in vec4 Color;\n"
+    "out vec2 Frag_UV;\n"
+    "out vec4 Frag_Color;\n"
+    "void main() {\n"
+    "    Frag_UV = UV;\n"
+    "    Frag_Color = Color;\n"
+    "    gl_Position = ProjMtx * vec4(Position.xy, 0, 1);\n"
+    "}\n";
+
+// Lattice points sit at texel centers, LutScaleOffset maps [0, 1] onto them
+static const char* FRAGMENT_SHADER =
+    "uniform sampler2D Texture;\n"
+    "uniform sampler3D Lut;\n"
+    "uniform vec2 LutScaleOffset;\n"
+    "in vec2 Frag_UV;\n"
+    "in vec4 Frag_Color;\n"
+    "out vec4 Out_Color;\n"
+    "void main() {\n"
+    "    vec4 color = texture(Texture, Frag_UV.st);\n"
+    "    color.rgb = texture(Lut, color.rgb * LutScaleOffset.x + LutScaleOffset.y).rgb;\n"
+    "    Out_Color = Frag_Color * color;\n"
+    "}\n";
+
+
+static GLuint CompileShader(GLenum type, const std::string& header, const char* source) {
+    GLuint shader = gl_ext.CreateShader(type);
+    const char* sources[2] = { header.c_str(), source };
+    gl_ext.ShaderSource(shader, 2, sources, nullptr);
+    gl_ext.CompileShader(shader);
+    GLint compiled = 0;
+    gl_ext.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024] = "";
+        gl_ext.GetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        LOG_ERROR("color", "Failed to compile the color LUT %s shader: %s", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+        gl_ext.DeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+
+bool ColorManager::Init(const char* glsl_version) {
+    if (Available()) return true;
+    if (!gl_ext.has_shaders) {
+        LOG_INFO("color", "Shaders or 3D textures unavailable, color management disabled");
+        return false;
+    }
+    // in/out and texture() need GLSL 1.30 or ES 3.00
+    int version = 0;
+    if (!glsl_version || sscanf(glsl_version, "#version %d", &version) != 1 || version < 130) {
+        LOG_INFO("color", "GLSL %s too old for the color LUT shader, color management disabled", glsl_version ? glsl_version : "?");
+        return false;
+    }
+
+    std::string header = std::string(glsl_version) + "\n";
+    if (strstr(glsl_version, " es")) {
+        header += "precision mediump float;\nprecision mediump sampler3D;\n";
+    }
+    vertex_shader = CompileShader(GL_VERTEX_SHADER, header, VERTEX_SHADER);
+    fragment_shader = CompileShader(GL_FRAGMENT_SHADER, header, FRAGMENT_SHADER);
+    if (!vertex_shader || !fragment_shader) {
+        if (vertex_shader) gl_ext.DeleteShader(vertex_shader);
+        if (fragment_shader) gl_ext.DeleteShader(fragment_shader);
+        vertex_shader = fragment_shader = 0;
+        return false;
+    }
+    LOG_INFO("color", "Color management on, display profile: %s", display.description.c_str());
+    return true;
+}
+
+void ColorManager::Release() {
+    worker.WaitIdle();
+    for (auto& entry : luts) {
+        Lut& lut = *entry.second;
+        if (lut.texture) {
+            GLResource_Untrack(GLResourceKind::Texture, lut.texture);
+            glDeleteTextures(1, &lut.texture);
+        }
+    }
+    luts.clear();
+    for (const Program& program : programs) {
+        if (program.program) gl_ext.DeleteProgram(program.program);
+    }
+    programs.clear();
+    if (vertex_shader) gl_ext.DeleteShader(vertex_shader);
+    if (fragment_shader) gl_ext.DeleteShader(fragment_shader);
+    vertex_shader = fragment_shader = 0;
+}
+
+void ColorManager::Poll() {
+    for (auto& entry : luts) {
+        Lut& lut = *entry.second;
+        if (lut.state.load(std::memory_order_acquire) != LUT_BAKED) continue;
+
+        GLint last_texture;
+        glGetIntegerv(GL_TEXTURE_BINDING_3D, &last_texture);
+        glGenTextures(1, &lut.texture);
+        GLResource_Track(GLResourceKind::Texture, lut.texture, LUT_SIZE, LUT_SIZE * LUT_SIZE, lut.data.size() * sizeof(uint16_t),
+                         GL_SITE, "color LUT " + lut.description);
+        glBindTexture(GL_TEXTURE_3D, lut.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        gl_ext.TexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16, LUT_SIZE, LUT_SIZE, LUT_SIZE, 0, GL_RGBA, GL_UNSIGNED_SHORT, lut.data.data());
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, (GLuint)last_texture);
+        std::vector<uint16_t>().swap(lut.data);
+
+        last_bake_ms = lut.bake_ms;
+        lut.state.store(LUT_READY, std::memory_order_relaxed);
+        LOG_INFO("color", "Color LUT for %s ready, baked in %.1f ms", lut.description.c_str(), lut.bake_ms);
+    }
+}
+
+void ColorManager::Image(ImTextureID texture, const ImVec2& size, const std::shared_ptr<const IccProfile>& source) {
+    if (!Available() || !enabled || !source) {
+        ImGui::Image(texture, size);
+        return;
+    }
+
+    std::unique_ptr<Lut>& slot = luts[source->hash];
+    if (!slot) {
+        slot = std::make_unique<Lut>();
+        Lut* lut = slot.get();
+        lut->manager = this;
+        lut->description = source->description.empty() ? "unnamed profile" : source->description;
+        std::shared_ptr<const IccProfile> profile = source;
+        IccProfile target = display;
+        worker.Submit([lut, profile, target]() {
+            auto start = std::chrono::steady_clock::now();
+            bool needed = IccProfile_BakeLut(*profile, target, LUT_SIZE, lut->data);
+            lut->bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            lut->state.store(needed ? LUT_BAKED : LUT_IDENTITY, std::memory_order_release);
+        });
+    }
+
+    Lut* lut = slot.get();
+    if (lut->state.load(std::memory_order_relaxed) != LUT_READY) {
+        ImGui::Image(texture, size);
+        return;
+    }
+    // ResetRenderState puts the backend's program and state back for the commands after the image
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddCallback(BeginLut, lut);
+    ImGui::Image(texture, size);
+    draw_list->AddCallback(EndLut, lut);
+    draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+ColorManagerStats ColorManager::Stats() const {
+    ColorManagerStats stats;
+    for (const auto& entry : luts) {
+        int state = entry.second->state.load(std::memory_order_relaxed);
+        if (state == LUT_READY) stats.luts++;
+        else if (state == LUT_IDENTITY) stats.identity++;
+        else stats.baking++;
+    }
+    stats.last_bake_ms = last_bake_ms;
+    return stats;
+}
+
+const ColorManager::Program& ColorManager::ProgramFor(GLuint backend) {
+    for (const Program& program : programs) {
+        if (program.backend == backend) return program;
+    }
+
+    // Every ImGui context has its own backend program, the attribute locations are taken from it
+    Program program;
+    program.backend = backend;
+    GLint position = gl_ext.GetAttribLocation(backend, "Position");
+    GLint uv = gl_ext.GetAttribLocation(backend, "UV");
+    GLint color = gl_ext.GetAttribLocation(backend, "Color");
+    program.backend_projection = gl_ext.GetUniformLocation(backend, "ProjMtx");
+    if (position >= 0 && uv >= 0 && color >= 0 && program.backend_projection >= 0) {
+        program.program = gl_ext.CreateProgram();
+        gl_ext.AttachShader(program.program, vertex_shader);
+        gl_ext.AttachShader(program.program, fragment_shader);
+        gl_ext.BindAttribLocation(program.program, (GLuint)position, "Position");
+        gl_ext.BindAttribLocation(program.program, (GLuint)uv, "UV");
+        gl_ext.BindAttribLocation(program.program, (GLuint)color, "Color");
+        gl_ext.LinkProgram(program.program);
+        GLint linked = 0;
+        gl_ext.GetProgramiv(program.program, GL_LINK_STATUS, &linked);
+        if (linked) {
+            program.projection = gl_ext.GetUniformLocation(program.program, "ProjMtx");
+            gl_ext.UseProgram(program.program);
+            gl_ext.Uniform1i(gl_ext.GetUniformLocation(program.program, "Texture"), 0);
+            gl_ext.Uniform1i(gl_ext.GetUniformLocation(program.program, "Lut"), 1);
+            gl_ext.Uniform2f(gl_ext.GetUniformLocation(program.program, "LutScaleOffset"), (LUT_SIZE - 1.0f) / LUT_SIZE, 0.5f / LUT_SIZE);
+        } else {
+            char log[1024] = "";
+            gl_ext.GetProgramInfoLog(program.program, sizeof(log), nullptr, log);
+            LOG_ERROR("color", "Failed to link the color LUT program: %s", log);
+            gl_ext.DeleteProgram(program.program);
+            program.program = 0;
+        }
+    } else {
+        LOG_WARNING("color", "Unexpected ImGui backend program %u, images drawn without color management", backend);
+    }
+    programs.push_back(program);
+    return programs.back();
+}
+
+void ColorManager::BeginLut(const ImDrawList*, const ImDrawCmd* cmd) {
+    Lut* lut = (Lut*)cmd->UserCallbackData;
+    GLint backend = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &backend);
+    const Program& program = lut->manager->ProgramFor((GLuint)backend);
+    if (!program.program) return;
+
+    GLfloat projection[16];
+    gl_ext.GetUniformfv((GLuint)backend, program.backend_projection, projection);
+    gl_ext.UseProgram(program.program);
+    gl_ext.UniformMatrix4fv(program.projection, 1, GL_FALSE, projection);
+    gl_ext.ActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, lut->texture);
+    gl_ext.ActiveTexture(GL_TEXTURE0);
+}
+
+void ColorManager::EndLut(const ImDrawList*, const ImDrawCmd*) {
+    gl_ext.ActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    gl_ext.ActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,104 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Color managed image drawing
+    Images with an embedded ICC profile are drawn through a 3D LUT holding the source -> display
+    transform. A LUT is baked on a worker thread the first time a profile is seen and kept for
+    the run; the fragment shader samples it, so nothing extra runs on the CPU per image or frame.
+    The shader is switched in with ImGui draw callbacks around the image and reuses the backend's
+    vertex layout and projection. Until its LUT is ready an image is drawn as encoded.
+    Untagged files are taken as sRGB. Render thread only.
+*/
+
+#pragma once
+
+#include "gl_ext.h"
+#include "icc_profile.h"
+#include "thread_pool.h"
+
+#include "imgui.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+struct ColorManagerStats {
+    int luts = 0;           // uploaded
+    int identity = 0;       // profiles that match the display, drawn without a LUT
+    int baking = 0;
+    double last_bake_ms = 0.0;
+};
+
+
+class ColorManager {
+public:
+    // Lattice points per axis
+    static const int LUT_SIZE = 33;
+
+    ColorManager() = default;
+
+    ColorManager(const ColorManager&) = delete;
+    ColorManager& operator=(const ColorManager&) = delete;
+
+    // Compiles the shaders for the backend's GLSL version, call with the main context current and
+    // GLExt_Load() done. False when shaders or 3D textures are missing, images are then drawn as encoded.
+    bool Init(const char* glsl_version);
+
+    // Frees the LUTs and programs, needs a context of the share group current
+    void Release();
+
+    bool Available() const { return vertex_shader != 0; }
+
+    // Profile the LUTs convert to, sRGB until set. Call before the first image is drawn.
+    void SetDisplayProfile(const IccProfile& profile) { display = profile; }
+    const IccProfile& DisplayProfile() const { return display; }
+
+    // Once per frame: uploads the LUTs the worker has finished
+    void Poll();
+
+    // ImGui::Image, converted from source (nullptr for untagged files) to the display profile
+    void Image(ImTextureID texture, const ImVec2& size, const std::shared_ptr<const IccProfile>& source);
+
+    ColorManagerStats Stats() const;
+
+    // Off draws every image as encoded
+    bool enabled = true;
+
+private:
+    enum LutState { LUT_BAKING, LUT_BAKED, LUT_READY, LUT_IDENTITY };
+
+    struct Lut {
+        ColorManager* manager = nullptr;
+        std::atomic<int> state{LUT_BAKING};
+        std::vector<uint16_t> data;     // filled by the worker, freed once uploaded
+        std::string description;
+        double bake_ms = 0.0;
+        GLuint texture = 0;
+    };
+
+    // The backend's program for one ImGui context, and ours linked with its attribute locations
+    struct Program {
+        GLuint backend = 0;
+        GLuint program = 0;     // 0 when linking failed
+        GLint backend_projection = -1;
+        GLint projection = -1;
+    };
+
+    static void BeginLut(const ImDrawList* draw_list, const ImDrawCmd* cmd);
+    static void EndLut(const ImDrawList* draw_list, const ImDrawCmd* cmd);
+    const Program& ProgramFor(GLuint backend);
+
+    IccProfile display = IccProfile_SRGB();
+    GLuint vertex_shader = 0;
+    GLuint fragment_shader = 0;
+    std::vector<Program> programs;
+    std::unordered_map<uint64_t, std::unique_ptr<Lut>> luts;   // by source profile hash
+    double last_bake_ms = 0.0;
+
+    // Declared last so the worker is joined before the LUTs it writes are destroyed
+    ThreadPool worker{1};
+};
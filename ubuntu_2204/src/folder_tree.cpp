@@ -0,0 +1,59 @@
+#include "folder_tree.h"
+#include "image_files.h"
+
+
+void FolderTree::SetRoot(const std::string& path) {
+    root = Node();
+    root.path = path;
+    root.name = path;
+}
+
+bool FolderTree::Draw(std::string& clicked) {
+    ImGui::TextUnformatted("Folders (images here / in tree)");
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Refresh")) {
+        counter.Invalidate();
+        SetRoot(root.path);
+    }
+
+    bool was_clicked = false;
+    ImGui::BeginChild("folder_tree");
+    ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+    DrawNode(root, clicked, was_clicked);
+    ImGui::EndChild();
+    return was_clicked;
+}
+
+void FolderTree::DrawNode(Node& node, std::string& clicked, bool& was_clicked) {
+    // Counts are requested for the rows on screen only, a walk also fills in every folder below
+    FolderCount count;
+    bool counted = counter.Find(node.path, count);
+
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_SpanAvailWidth;
+    if (node.path == current) flags |= ImGuiTreeNodeFlags_Selected;
+    if ((node.listed && node.children.empty()) || (counted && count.folders == 0)) flags |= ImGuiTreeNodeFlags_Leaf;
+    bool open = counted ? ImGui::TreeNodeEx(&node, flags, "%s  %d / %d", node.name.c_str(), count.images, count.total_images)
+                        : ImGui::TreeNodeEx(&node, flags, "%s  ...", node.name.c_str());
+    if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) {
+        clicked = node.path;
+        was_clicked = true;
+    }
+    if (!open) return;
+
+    // The walk lists the folder on a worker, the names usually arrive a frame or two after opening
+    std::vector<std::string> names;
+    if (!node.listed && counter.Subfolders(node.path, names)) {
+        for (const std::string& name : names) {
+            Node child;
+            child.path = JoinPath(node.path, name);
+            child.name = name;
+            node.children.push_back(std::move(child));
+        }
+        node.listed = true;
+    }
+    if (!node.listed) ImGui::TextDisabled("...");
+    for (Node& child : node.children) {
+        DrawNode(child, clicked, was_clicked);
+    }
+    ImGui::TreePop();
+}
@@ -0,0 +1,47 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Folder tree widget
+    Each row shows the folder's own and whole-tree image counts, taken from a FolderCounter that
+    walks the tree in the background. Its listings also give the subfolders of an expanded row,
+    so the render thread never touches the disk; "..." stands in until they arrive.
+*/
+
+#pragma once
+
+#include "folder_counts.h"
+
+#include "imgui.h"
+
+#include <string>
+#include <vector>
+
+
+class FolderTree {
+public:
+    explicit FolderTree(FolderCounter& counter) : counter(counter) {}
+
+    // Drops every listing, the tree starts again from path
+    void SetRoot(const std::string& path);
+    const std::string& Root() const { return root.path; }
+
+    // Fills the remaining space of the current window. True on the frame a folder is clicked,
+    // its path in clicked.
+    bool Draw(std::string& clicked);
+
+    // Folder highlighted as the one shown
+    std::string current;
+
+private:
+    struct Node {
+        std::string path;
+        std::string name;
+        bool listed = false;
+        std::vector<Node> children;
+    };
+
+    void DrawNode(Node& node, std::string& clicked, bool& was_clicked);
+
+    FolderCounter& counter;
+    Node root;
+};
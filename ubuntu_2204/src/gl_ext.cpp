@@ -0,0 +1,68 @@
+#include "gl_ext.h"
+
+#include <cstdio>
+
+
+GLExtFunctions gl_ext;
+
+#define GL_EXT_LOAD(member, name) gl_ext.member = (decltype(gl_ext.member))glfwGetProcAddress(name)
+
+bool GLExt_Load() {
+    GL_EXT_LOAD(GenFramebuffers, "glGenFramebuffers");
+    GL_EXT_LOAD(DeleteFramebuffers, "glDeleteFramebuffers");
+    GL_EXT_LOAD(BindFramebuffer, "glBindFramebuffer");
+    GL_EXT_LOAD(FramebufferTexture2D, "glFramebufferTexture2D");
+    GL_EXT_LOAD(CheckFramebufferStatus, "glCheckFramebufferStatus");
+    GL_EXT_LOAD(BlendFuncSeparate, "glBlendFuncSeparate");
+    GL_EXT_LOAD(FenceSync, "glFenceSync");
+    GL_EXT_LOAD(ClientWaitSync, "glClientWaitSync");
+    GL_EXT_LOAD(DeleteSync, "glDeleteSync");
+    GL_EXT_LOAD(GenQueries, "glGenQueries");
+    GL_EXT_LOAD(DeleteQueries, "glDeleteQueries");
+    GL_EXT_LOAD(BeginQuery, "glBeginQuery");
+    GL_EXT_LOAD(EndQuery, "glEndQuery");
+    GL_EXT_LOAD(GetQueryObjectiv, "glGetQueryObjectiv");
+    GL_EXT_LOAD(GetQueryObjectui64v, "glGetQueryObjectui64v");
+    if (!gl_ext.GetQueryObjectui64v) GL_EXT_LOAD(GetQueryObjectui64v, "glGetQueryObjectui64vEXT");
+    GL_EXT_LOAD(TexImage3D, "glTexImage3D");
+    GL_EXT_LOAD(ActiveTexture, "glActiveTexture");
+    GL_EXT_LOAD(CreateShader, "glCreateShader");
+    GL_EXT_LOAD(ShaderSource, "glShaderSource");
+    GL_EXT_LOAD(CompileShader, "glCompileShader");
+    GL_EXT_LOAD(GetShaderiv, "glGetShaderiv");
+    GL_EXT_LOAD(GetShaderInfoLog, "glGetShaderInfoLog");
+    GL_EXT_LOAD(DeleteShader, "glDeleteShader");
+    GL_EXT_LOAD(CreateProgram, "glCreateProgram");
+    GL_EXT_LOAD(AttachShader, "glAttachShader");
+    GL_EXT_LOAD(BindAttribLocation, "glBindAttribLocation");
+    GL_EXT_LOAD(LinkProgram, "glLinkProgram");
+    GL_EXT_LOAD(GetProgramiv, "glGetProgramiv");
+    GL_EXT_LOAD(GetProgramInfoLog, "glGetProgramInfoLog");
+    GL_EXT_LOAD(DeleteProgram, "glDeleteProgram");
+    GL_EXT_LOAD(UseProgram, "glUseProgram");
+    GL_EXT_LOAD(GetAttribLocation, "glGetAttribLocation");
+    GL_EXT_LOAD(GetUniformLocation, "glGetUniformLocation");
+    GL_EXT_LOAD(GetUniformfv, "glGetUniformfv");
+    GL_EXT_LOAD(Uniform1i, "glUniform1i");
+    GL_EXT_LOAD(Uniform2f, "glUniform2f");
+    GL_EXT_LOAD(UniformMatrix4fv, "glUniformMatrix4fv");
+
+    gl_ext.has_framebuffers = gl_ext.GenFramebuffers && gl_ext.DeleteFramebuffers && gl_ext.BindFramebuffer &&
+                              gl_ext.FramebufferTexture2D && gl_ext.CheckFramebufferStatus && gl_ext.BlendFuncSeparate;
+    gl_ext.has_sync = gl_ext.FenceSync && gl_ext.ClientWaitSync && gl_ext.DeleteSync;
+    gl_ext.has_shaders = gl_ext.TexImage3D && gl_ext.ActiveTexture && gl_ext.CreateShader && gl_ext.ShaderSource &&
+                         gl_ext.CompileShader && gl_ext.GetShaderiv && gl_ext.GetShaderInfoLog && gl_ext.DeleteShader &&
+                         gl_ext.CreateProgram && gl_ext.AttachShader && gl_ext.BindAttribLocation && gl_ext.LinkProgram &&
+                         gl_ext.GetProgramiv && gl_ext.GetProgramInfoLog && gl_ext.DeleteProgram && gl_ext.UseProgram &&
+                         gl_ext.GetAttribLocation && gl_ext.GetUniformLocation && gl_ext.GetUniformfv && gl_ext.Uniform1i &&
+                         gl_ext.Uniform2f && gl_ext.UniformMatrix4fv;
+
+    // Drivers hand out entry points they do not implement, the version or extension decides
+    int major = 0, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    bool timer_core = version && sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 3 || (major == 3 && minor >= 3));
+    bool timer_extension = glfwExtensionSupported("GL_ARB_timer_query") || glfwExtensionSupported("GL_EXT_timer_query");
+    gl_ext.has_timer_query = (timer_core || timer_extension) && gl_ext.GenQueries && gl_ext.DeleteQueries &&
+                             gl_ext.BeginQuery && gl_ext.EndQuery && gl_ext.GetQueryObjectiv && gl_ext.GetQueryObjectui64v;
+    return gl_ext.has_framebuffers;
+}
@@ -0,0 +1,152 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    GL entry points above what the system headers export
+    Resolved through GLFW once a context is current
+*/
+
+#pragma once
+
+#ifndef GL_SILENCE_DEPRECATION
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GLFW/glfw3.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_FRAMEBUFFER_BINDING
+#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_TEXTURE_3D
+#define GL_TEXTURE_3D 0x806F
+#endif
+#ifndef GL_TEXTURE_BINDING_3D
+#define GL_TEXTURE_BINDING_3D 0x806A
+#endif
+#ifndef GL_TEXTURE_WRAP_R
+#define GL_TEXTURE_WRAP_R 0x8072
+#endif
+#ifndef GL_RGBA16
+#define GL_RGBA16 0x805B
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_TEXTURE1
+#define GL_TEXTURE1 0x84C1
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM 0x8B8D
+#endif
+
+// Same underlying type as GLsync where the headers declare it
+typedef struct __GLsync* GLExtSync;
+
+
+struct GLExtFunctions {
+    // GL 3.0 / ARB_framebuffer_object
+    void (APIENTRY* GenFramebuffers)(GLsizei n, GLuint* framebuffers) = nullptr;
+    void (APIENTRY* DeleteFramebuffers)(GLsizei n, const GLuint* framebuffers) = nullptr;
+    void (APIENTRY* BindFramebuffer)(GLenum target, GLuint framebuffer) = nullptr;
+    void (APIENTRY* FramebufferTexture2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) = nullptr;
+    GLenum (APIENTRY* CheckFramebufferStatus)(GLenum target) = nullptr;
+
+    // GL 1.4
+    void (APIENTRY* BlendFuncSeparate)(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) = nullptr;
+
+    // GL 3.2 / ARB_sync
+    GLExtSync (APIENTRY* FenceSync)(GLenum condition, GLbitfield flags) = nullptr;
+    GLenum (APIENTRY* ClientWaitSync)(GLExtSync sync, GLbitfield flags, unsigned long long timeout) = nullptr;
+    void (APIENTRY* DeleteSync)(GLExtSync sync) = nullptr;
+
+    // GL 1.5 queries, GL 3.3 / ARB_timer_query (or EXT_timer_query) for GL_TIME_ELAPSED
+    void (APIENTRY* GenQueries)(GLsizei n, GLuint* ids) = nullptr;
+    void (APIENTRY* DeleteQueries)(GLsizei n, const GLuint* ids) = nullptr;
+    void (APIENTRY* BeginQuery)(GLenum target, GLuint id) = nullptr;
+    void (APIENTRY* EndQuery)(GLenum target) = nullptr;
+    void (APIENTRY* GetQueryObjectiv)(GLuint id, GLenum pname, GLint* params) = nullptr;
+    void (APIENTRY* GetQueryObjectui64v)(GLuint id, GLenum pname, unsigned long long* params) = nullptr;
+
+    // GL 1.2 3D textures, GL 1.3 multitexture, GL 2.0 shaders
+    void (APIENTRY* TexImage3D)(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth,
+                                GLint border, GLenum format, GLenum type, const void* pixels) = nullptr;
+    void (APIENTRY* ActiveTexture)(GLenum texture) = nullptr;
+    GLuint (APIENTRY* CreateShader)(GLenum type) = nullptr;
+    void (APIENTRY* ShaderSource)(GLuint shader, GLsizei count, const char* const* strings, const GLint* lengths) = nullptr;
+    void (APIENTRY* CompileShader)(GLuint shader) = nullptr;
+    void (APIENTRY* GetShaderiv)(GLuint shader, GLenum pname, GLint* params) = nullptr;
+    void (APIENTRY* GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, char* log) = nullptr;
+    void (APIENTRY* DeleteShader)(GLuint shader) = nullptr;
+    GLuint (APIENTRY* CreateProgram)() = nullptr;
+    void (APIENTRY* AttachShader)(GLuint program, GLuint shader) = nullptr;
+    void (APIENTRY* BindAttribLocation)(GLuint program, GLuint index, const char* name) = nullptr;
+    void (APIENTRY* LinkProgram)(GLuint program) = nullptr;
+    void (APIENTRY* GetProgramiv)(GLuint program, GLenum pname, GLint* params) = nullptr;
+    void (APIENTRY* GetProgramInfoLog)(GLuint program, GLsizei size, GLsizei* length, char* log) = nullptr;
+    void (APIENTRY* DeleteProgram)(GLuint program) = nullptr;
+    void (APIENTRY* UseProgram)(GLuint program) = nullptr;
+    GLint (APIENTRY* GetAttribLocation)(GLuint program, const char* name) = nullptr;
+    GLint (APIENTRY* GetUniformLocation)(GLuint program, const char* name) = nullptr;
+    void (APIENTRY* GetUniformfv)(GLuint program, GLint location, GLfloat* params) = nullptr;
+    void (APIENTRY* Uniform1i)(GLint location, GLint value) = nullptr;
+    void (APIENTRY* Uniform2f)(GLint location, GLfloat x, GLfloat y) = nullptr;
+    void (APIENTRY* UniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = nullptr;
+
+    bool has_framebuffers = false;
+    bool has_sync = false;
+    bool has_timer_query = false;
+    bool has_shaders = false;   // with 3D textures
+};
+
+extern GLExtFunctions gl_ext;
+
+// Call with the main context current. Returns false when framebuffer objects are missing,
+// the other groups are reported through their has_* flags.
+bool GLExt_Load();
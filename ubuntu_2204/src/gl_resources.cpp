@@ -0,0 +1,175 @@
+#include "gl_resources.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+
+static const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+
+static std::mutex g_mutex;
+static std::unordered_map<uint64_t, GLResourceRecord> g_records;
+static size_t g_bytes[2] = {};
+static int g_counts[2] = {};
+static size_t g_peak_bytes = 0;
+
+static uint64_t Key(GLResourceKind kind, GLuint name) {
+    return ((uint64_t)kind << 32) | name;
+}
+
+// Caller holds g_mutex
+static void Remove(std::unordered_map<uint64_t, GLResourceRecord>::iterator it) {
+    int kind = (int)it->second.kind;
+    g_bytes[kind] -= it->second.bytes;
+    g_counts[kind]--;
+    g_records.erase(it);
+}
+
+
+void GLResource_Track(GLResourceKind kind, GLuint name, int width, int height, size_t bytes, const char* site,
+                      const std::string& label) {
+    if (!name) return;
+    GLResourceRecord record;
+    record.kind = kind;
+    record.name = name;
+    record.width = width;
+    record.height = height;
+    record.bytes = bytes;
+    record.site = site ? site : "";
+    record.label = label;
+    record.created = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_start).count();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_records.find(Key(kind, name));
+    if (it != g_records.end()) Remove(it);
+    g_bytes[(int)kind] += bytes;
+    g_counts[(int)kind]++;
+    g_records.emplace(Key(kind, name), std::move(record));
+    g_peak_bytes = std::max(g_peak_bytes, g_bytes[0] + g_bytes[1]);
+}
+
+void GLResource_Untrack(GLResourceKind kind, GLuint name) {
+    if (!name) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_records.find(Key(kind, name));
+    if (it != g_records.end()) Remove(it);
+}
+
+std::vector<GLResourceRecord> GLResource_Snapshot() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::vector<GLResourceRecord> records;
+    records.reserve(g_records.size());
+    for (const auto& entry : g_records) records.push_back(entry.second);
+    return records;
+}
+
+int GLResource_Count(GLResourceKind kind) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_counts[(int)kind];
+}
+
+size_t GLResource_Bytes(GLResourceKind kind) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_bytes[(int)kind];
+}
+
+size_t GLResource_PeakBytes() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_peak_bytes;
+}
+
+int GLResource_ReportLeaks() {
+    struct SiteTotal {
+        int count = 0;
+        size_t bytes = 0;
+        std::string example;
+    };
+    std::map<std::pair<int, std::string>, SiteTotal> sites;
+    int leaks = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const auto& entry : g_records) {
+            const GLResourceRecord& record = entry.second;
+            SiteTotal& total = sites[{ (int)record.kind, record.site }];
+            total.count++;
+            total.bytes += record.bytes;
+            if (total.example.empty()) total.example = record.label;
+            leaks++;
+        }
+    }
+    for (const auto& site : sites) {
+        LOG_WARNING("gl", "Leaked %d %s%s (%.1f MB) created at %s%s%s", site.second.count,
+                    GLResource_KindName((GLResourceKind)site.first.first), site.second.count == 1 ? "" : "s",
+                    site.second.bytes / 1048576.0, site.first.second.c_str(),
+                    site.second.example.empty() ? "" : ", e.g. ", site.second.example.c_str());
+    }
+    if (leaks == 0) LOG_INFO("gl", "No GL objects leaked");
+    return leaks;
+}
+
+const char* GLResource_KindName(GLResourceKind kind) {
+    return kind == GLResourceKind::Texture ? "texture" : "framebuffer";
+}
+
+
+GLTexture& GLTexture::operator=(GLTexture&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        std::swap(name, other.name);
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+    }
+    return *this;
+}
+
+void GLTexture::Create(int texture_width, int texture_height, const void* pixels, const char* site, const std::string& label) {
+    if (!name) glGenTextures(1, &name);
+    width = texture_width;
+    height = texture_height;
+    glBindTexture(GL_TEXTURE_2D, name);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLResource_Track(GLResourceKind::Texture, name, width, height, (size_t)width * height * 4, site, label);
+}
+
+void GLTexture::Reset() {
+    if (!name) return;
+    GLResource_Untrack(GLResourceKind::Texture, name);
+    glDeleteTextures(1, &name);
+    name = 0;
+    width = height = 0;
+}
+
+GLuint GLTexture::Release() {
+    GLuint released = name;
+    name = 0;
+    width = height = 0;
+    return released;
+}
+
+
+GLFramebuffer& GLFramebuffer::operator=(GLFramebuffer&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        std::swap(name, other.name);
+    }
+    return *this;
+}
+
+void GLFramebuffer::Create(const char* site, const std::string& label) {
+    if (name || !gl_ext.GenFramebuffers) return;
+    gl_ext.GenFramebuffers(1, &name);
+    GLResource_Track(GLResourceKind::Framebuffer, name, 0, 0, 0, site, label);
+}
+
+void GLFramebuffer::Reset() {
+    if (!name) return;
+    GLResource_Untrack(GLResourceKind::Framebuffer, name);
+    gl_ext.DeleteFramebuffers(1, &name);
+    name = 0;
+}
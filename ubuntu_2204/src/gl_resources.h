@@ -0,0 +1,105 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Accounting of the GL objects the app creates
+    Every texture and framebuffer is registered with its size, creation site and a label
+    (usually the image path) and unregistered when deleted. Whatever is still registered at
+    shutdown is reported as a leak. Thread safe, textures are also made on the loader thread.
+    GLTexture and GLFramebuffer own an object and keep its record up to date; code that hands
+    names across threads or through ImTextureID calls Track/Untrack itself.
+    Objects made by the ImGui backend (font atlas, vertex buffers) are not counted.
+*/
+
+#pragma once
+
+#include "gl_ext.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+enum class GLResourceKind : uint8_t { Texture, Framebuffer };
+
+struct GLResourceRecord {
+    GLResourceKind kind = GLResourceKind::Texture;
+    GLuint name = 0;
+    int width = 0;
+    int height = 0;
+    size_t bytes = 0;               // estimated from the format, framebuffers count 0
+    const char* site = "";          // file:line that created it
+    std::string label;
+    double created = 0.0;           // seconds since start
+};
+
+#define GL_SITE_STRING(x) #x
+#define GL_SITE_LINE(x) GL_SITE_STRING(x)
+#define GL_SITE __FILE__ ":" GL_SITE_LINE(__LINE__)
+
+// site must be a string literal, GL_SITE gives the calling line. Tracking a name again
+// replaces its record (storage re-specified at another size).
+void GLResource_Track(GLResourceKind kind, GLuint name, int width, int height, size_t bytes, const char* site,
+                      const std::string& label = std::string());
+void GLResource_Untrack(GLResourceKind kind, GLuint name);
+
+// Copy of every live record
+std::vector<GLResourceRecord> GLResource_Snapshot();
+int GLResource_Count(GLResourceKind kind);
+size_t GLResource_Bytes(GLResourceKind kind);
+size_t GLResource_PeakBytes();
+
+// Logs what is still alive, grouped by creation site, call after all cleanup. Returns the count.
+int GLResource_ReportLeaks();
+
+const char* GLResource_KindName(GLResourceKind kind);
+
+
+// RGBA8 2D texture with linear filtering
+class GLTexture {
+public:
+    GLTexture() = default;
+    ~GLTexture() { Reset(); }
+
+    GLTexture(GLTexture&& other) noexcept { *this = std::move(other); }
+    GLTexture& operator=(GLTexture&& other) noexcept;
+    GLTexture(const GLTexture&) = delete;
+    GLTexture& operator=(const GLTexture&) = delete;
+
+    // (Re)specifies the storage, pixels may be null. Keeps the name when one exists, leaves it bound.
+    void Create(int width, int height, const void* pixels, const char* site, const std::string& label = std::string());
+    // Deletes the texture, needs a context of its share group current
+    void Reset();
+    // Gives up ownership without deleting, the caller must Untrack the name when it deletes it
+    GLuint Release();
+
+    GLuint Get() const { return name; }
+    int Width() const { return width; }
+    int Height() const { return height; }
+
+private:
+    GLuint name = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Framebuffer objects belong to the context that created them, Reset() needs it current
+class GLFramebuffer {
+public:
+    GLFramebuffer() = default;
+    ~GLFramebuffer() { Reset(); }
+
+    GLFramebuffer(GLFramebuffer&& other) noexcept { *this = std::move(other); }
+    GLFramebuffer& operator=(GLFramebuffer&& other) noexcept;
+    GLFramebuffer(const GLFramebuffer&) = delete;
+    GLFramebuffer& operator=(const GLFramebuffer&) = delete;
+
+    void Create(const char* site, const std::string& label = std::string());
+    void Reset();
+
+    GLuint Get() const { return name; }
+
+private:
+    GLuint name = 0;
+};
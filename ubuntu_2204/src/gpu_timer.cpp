@@ -0,0 +1,91 @@
+#include "gpu_timer.h"
+#include "flight_recorder.h"
+
+#include <cstring>
+
+
+bool GpuTimer::Init(const char* track_name) {
+    if (context || !gl_ext.has_timer_query) return false;
+    for (FrameQueries& queries : frames) {
+        gl_ext.GenQueries(MAX_PASSES, queries.queries);
+        queries.count = 0;
+    }
+    context = glfwGetCurrentContext();
+    if (!track) track = FlightRecorder_AddTrack(track_name);
+    return true;
+}
+
+void GpuTimer::Release() {
+    if (!context) return;
+    if (active) End();
+    for (FrameQueries& queries : frames) {
+        gl_ext.DeleteQueries(MAX_PASSES, queries.queries);
+        memset(queries.queries, 0, sizeof(queries.queries));
+        queries.count = 0;
+    }
+    context = nullptr;
+}
+
+void GpuTimer::BeginFrame() {
+    if (!context || glfwGetCurrentContext() != context) return;
+    if (active) End();
+
+    frame = (frame + 1) % FRAMES;
+    FrameQueries& queries = frames[frame];
+    for (int i = 0; i < queries.count; i++) {
+        GLint available = 0;
+        gl_ext.GetQueryObjectiv(queries.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            // Reusing the query discards the pending result, waiting for it would stall
+            dropped_results++;
+            continue;
+        }
+        unsigned long long elapsed_ns = 0;
+        gl_ext.GetQueryObjectui64v(queries.queries[i], GL_QUERY_RESULT, &elapsed_ns);
+        Record(queries.names[i], queries.cpu_start[i], elapsed_ns);
+    }
+    queries.count = 0;
+}
+
+void GpuTimer::Begin(const char* name) {
+    FrameQueries& queries = frames[frame];
+    if (!context || active || queries.count == MAX_PASSES || glfwGetCurrentContext() != context) return;
+    int i = queries.count++;
+    queries.names[i] = name;
+    queries.cpu_start[i] = FlightRecorder_Now();
+    gl_ext.BeginQuery(GL_TIME_ELAPSED, queries.queries[i]);
+    active = true;
+}
+
+void GpuTimer::End() {
+    if (!active) return;
+    gl_ext.EndQuery(GL_TIME_ELAPSED);
+    active = false;
+}
+
+std::vector<GpuPassTime> GpuTimer::Results() const {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    return results;
+}
+
+void GpuTimer::Record(const char* name, uint64_t cpu_start, uint64_t gpu_ns) {
+    // The GPU ran the pass some time after it was issued, traces show it from the issue time
+    FlightRecorder_TrackZone(track, name, cpu_start, cpu_start + gpu_ns);
+
+    double ms = gpu_ns / 1e6;
+    std::lock_guard<std::mutex> lock(results_mutex);
+    for (GpuPassTime& pass : results) {
+        if (strcmp(pass.name, name) == 0) {
+            pass.last_ms = ms;
+            pass.average_ms += (ms - pass.average_ms) * 0.05;
+            pass.samples++;
+            return;
+        }
+    }
+    GpuPassTime pass;
+    pass.name = name;
+    pass.last_ms = ms;
+    pass.average_ms = ms;
+    pass.samples = 1;
+    results.push_back(pass);
+}
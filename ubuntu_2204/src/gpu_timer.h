@@ -0,0 +1,97 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    GPU time of render passes and uploads with GL_TIME_ELAPSED queries
+    Queries are triple buffered: the results of a frame are read FRAMES frames later, when
+    the GPU has normally finished with them, so reading never stalls the pipeline. A result
+    still pending at that point is dropped. Queries belong to the context they were created
+    on; passes issued while another context is current are not timed.
+    Passes cannot nest, GL allows one GL_TIME_ELAPSED query at a time.
+    Does nothing when the context has no timer queries.
+*/
+
+#pragma once
+
+#include "gl_ext.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct ZoneRing;
+
+
+struct GpuPassTime {
+    const char* name = nullptr;
+    double last_ms = 0.0;
+    double average_ms = 0.0;    // exponential, about the last 20 samples
+    int samples = 0;
+};
+
+
+class GpuTimer {
+public:
+    static const int FRAMES = 3;
+    static const int MAX_PASSES = 8;    // per frame, further passes are not timed
+
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Call with the context to time current and GLExt_Load() done. track_name names the
+    // flight recorder track the passes are shown on. False when timer queries are missing.
+    bool Init(const char* track_name);
+    // Needs the same context current
+    void Release();
+
+    bool Available() const { return context != nullptr; }
+
+    // Collects the results of FRAMES frames ago and starts a new set of queries
+    void BeginFrame();
+
+    // name must be a string literal
+    void Begin(const char* name);
+    void End();
+
+    // Copy of the per-pass times, safe from any thread
+    std::vector<GpuPassTime> Results() const;
+
+    int dropped_results = 0;    // results not ready after FRAMES frames
+
+private:
+    struct FrameQueries {
+        GLuint queries[MAX_PASSES] = {};
+        const char* names[MAX_PASSES] = {};
+        uint64_t cpu_start[MAX_PASSES] = {};    // flight recorder time of Begin, where the pass is drawn in traces
+        int count = 0;
+    };
+
+    void Record(const char* name, uint64_t cpu_start, uint64_t gpu_ns);
+
+    GLFWwindow* context = nullptr;
+    ZoneRing* track = nullptr;
+    FrameQueries frames[FRAMES];
+    int frame = 0;
+    bool active = false;
+
+    mutable std::mutex results_mutex;
+    std::vector<GpuPassTime> results;
+};
+
+
+// Times the enclosing scope, nothing when timer is null or unavailable
+class GpuZone {
+public:
+    GpuZone(GpuTimer* timer, const char* name) : timer(timer && timer->Available() ? timer : nullptr) {
+        if (this->timer) this->timer->Begin(name);
+    }
+    ~GpuZone() {
+        if (timer) timer->End();
+    }
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    GpuTimer* timer;
+};
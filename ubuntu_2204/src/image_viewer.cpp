@@ -0,0 +1,211 @@
+#include "image_viewer.h"
+#include "color_manager.h"
+#include "content_index.h"
+#include "flight_recorder.h"
+#include "gif_animation.h"
+
+#include <algorithm>
+
+
+float ImageViewer::dwell_time = 0.15f;
+RefinementStats ImageViewer::stats;
+ColorManager* ImageViewer::color_manager = nullptr;
+
+
+ImageViewer::ImageViewer(TextureCache& cache, const std::string& directory)
+    : cache(cache), image_files(GetImageFiles(directory)) {
+    if (cache.content) cache.content->HashAhead(image_files);
+}
+
+ImageViewer::~ImageViewer() {
+    if (!wanted_path.empty()) cache.Release(wanted_path);
+    if (!shown_path.empty()) cache.Release(shown_path);
+}
+
+void ImageViewer::SetIndex(size_t index) {
+    if (index < image_files.size()) current_image_index = index;
+}
+
+void ImageViewer::Navigate(size_t index) {
+    // Leaving a file whose full decode was never requested
+    const std::string& image_path = image_files[current_image_index];
+    if (image_path != shown_path && image_path != wanted_path) {
+        stats.skipped_loads++;
+        if (const CachedThumbnail* thumbnail = cache.FindThumbnail(image_path)) {
+            stats.skipped_megapixels += (double)thumbnail->full_width * thumbnail->full_height / 1e6;
+        }
+    }
+    // A decode still in flight for the file being left is cancelled
+    if (!wanted_path.empty()) {
+        cache.Release(wanted_path);
+        wanted_path.clear();
+    }
+    stats.navigations++;
+    current_image_index = index;
+    navigation_time = ImGui::GetTime();
+}
+
+ImTextureID ImageViewer::AnimationTexture(const CachedTexture& shown) {
+    if (animation_path != shown_path) {
+        animation_path = shown_path;
+        animation_frame = 0;
+        frame_time = 0.0;
+    }
+    // Streamed files play on the cache's clock, see TextureCache::Animate
+    if (shown.streamed) {
+        animation_frame = shown.stream_frame;
+        return shown.stream_texture;
+    }
+    if (shown.frames.size() < 2) return 0;
+
+    // Step through the frame delays by the time since the last UI frame. After a stall the late
+    // frames are skipped rather than shown as a backlog.
+    const std::vector<int>& delays = shown.frame_delays;
+    double lag_limit = delays[animation_frame] / 1000.0 + 0.25;
+    frame_time = std::min(frame_time + ImGui::GetIO().DeltaTime, lag_limit);
+    int steps = 0;
+    for (double delay; frame_time >= (delay = delays[animation_frame] / 1000.0); steps++) {
+        frame_time -= delay;
+        animation_frame = (animation_frame + 1) % (int)shown.frames.size();
+    }
+    if (steps > 1) animation_stats.dropped_frames += steps - 1;
+    return shown.frames[animation_frame];
+}
+
+const CachedThumbnail* ImageViewer::FindInterimPreview(const std::string& path) {
+    if (ImGui::GetTime() - navigation_time >= dwell_time) {
+        if (const CachedThumbnail* preview = cache.FindPreview(path)) return preview;
+    }
+    return cache.FindThumbnail(path);
+}
+
+void ImageViewer::Show(const char* title, int width, int height) {
+    TRACE_ZONE("ImageViewer::Show");
+    // Hold a reference to the current file once the user has settled on it (or it is already in
+    // the cache); a newer request replaces one still loading
+    if (!image_files.empty()) {
+        const std::string& image_path = image_files[current_image_index];
+        bool settled = ImGui::GetTime() - navigation_time >= dwell_time || cache.Find(image_path);
+        if (image_path != shown_path && image_path != wanted_path && settled) {
+            if (!wanted_path.empty()) cache.Release(wanted_path);
+            FlightRecorder_Annotate("viewer loading", image_path);
+            cache.Acquire(image_path);
+            wanted_path = image_path;
+            stats.full_loads++;
+
+            // Neighbours are decoded ahead into RAM, one step in either direction is then a cache hit
+            std::vector<std::string> neighbours;
+            if (current_image_index + 1 < image_files.size()) neighbours.push_back(image_files[current_image_index + 1]);
+            if (current_image_index > 0) neighbours.push_back(image_files[current_image_index - 1]);
+            cache.Prefetch(neighbours);
+        } else if (image_path == shown_path && !wanted_path.empty()) {
+            cache.Release(wanted_path);
+            wanted_path.clear();
+        }
+    }
+    if (!wanted_path.empty() && cache.Find(wanted_path)) {
+        if (!shown_path.empty()) cache.Release(shown_path);
+        shown_path = wanted_path;
+        wanted_path.clear();
+        FlightRecorder_Annotate("viewer shown", shown_path);
+    }
+
+    // Current file at full resolution, else its thumbnail, else a placeholder
+    ImTextureID texture = 0;
+    int img_width = 0, img_height = 0;
+    std::shared_ptr<const IccProfile> icc;
+    if (!image_files.empty()) {
+        const std::string& image_path = image_files[current_image_index];
+        if (image_path == shown_path) {
+            const CachedTexture* shown = cache.Find(shown_path);
+            texture = shown->texture;
+            img_width = shown->width;
+            img_height = shown->height;
+            icc = shown->icc;
+            if (ImTextureID frame_texture = AnimationTexture(*shown)) {
+                texture = frame_texture;
+            }
+        } else if (const CachedThumbnail* thumbnail = FindInterimPreview(image_path)) {
+            texture = thumbnail->texture;
+            img_width = thumbnail->full_width ? thumbnail->full_width : thumbnail->width;
+            img_height = thumbnail->full_height ? thumbnail->full_height : thumbnail->height;
+            if (preview_path != image_path) {
+                preview_path = image_path;
+                stats.thumbnail_previews++;
+            }
+        }
+    }
+
+    // Determine the size of the subwindow
+    ImVec2 size = ImVec2(width, height);
+    if (width == -1 || height == -1) {
+        ImVec2 parent_size = ImGui::GetContentRegionAvail();
+        if (width == -1) size.x = parent_size.x;
+        if (height == -1) size.y = parent_size.y;
+    }
+
+    ImGui::BeginChild(title, size, true, ImGuiWindowFlags_NoScrollbar);
+
+    // Define the fixed height for the image and calculate width to maintain aspect ratio
+    // (4:3 placeholder until the first image has loaded)
+    float fixed_height = 150.0f;
+    float aspect = (texture && img_height > 0) ? static_cast<float>(img_width) / img_height : 4.0f / 3.0f;
+    float fixed_width = fixed_height * aspect;
+
+    // Set a black background for the image area
+    ImVec2 p_min = ImGui::GetCursorScreenPos();
+    ImVec2 p_max = ImVec2(p_min.x + fixed_width, p_min.y + fixed_height);
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(p_min, p_max, IM_COL32(0, 0, 0, 255));
+
+    // Draw the image with a white border
+    if (texture && color_manager) {
+        color_manager->Image(texture, ImVec2(fixed_width, fixed_height), icc);
+    } else if (texture) {
+        ImGui::Image(texture, ImVec2(fixed_width, fixed_height));
+    } else {
+        ImGui::Dummy(ImVec2(fixed_width, fixed_height));
+    }
+    ImVec2 image_p_min = ImGui::GetItemRectMin();
+    ImVec2 image_p_max = ImGui::GetItemRectMax();
+    draw_list->AddRect(image_p_min, image_p_max, IM_COL32(255, 255, 255, 255), 0.0f, 0, 2.0f);
+
+    // Navigation buttons
+    ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10); // Place buttons below the image with a small padding
+    ImGui::PushStyleColor(ImGuiCol_Button, IM_COL32(255, 192, 203, 255)); // Pink background
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, IM_COL32(255, 0, 0, 255)); // Red hover
+    ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0, 0, 0, 255)); // Black text
+
+    if (ImGui::Button("<-")) {
+        // Handle previous action
+        if (current_image_index > 0) {
+            Navigate(current_image_index - 1); // the new path is loaded at the top of the next frame
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("->")) {
+        // Handle next action
+        if (current_image_index + 1 < image_files.size()) {
+            Navigate(current_image_index + 1); // the new path is loaded at the top of the next frame
+        }
+    }
+    ImGui::PopStyleColor(3);
+
+    // Title
+    ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10); // Adjust position for title
+    ImGui::Text("%s", title);
+
+    // Current media path
+    if (!image_files.empty()) {
+        ImGui::Text("Current media: %s", image_files[current_image_index].c_str());
+        if (image_files[current_image_index] == shown_path && !texture) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Could not load this file, see View > Slowest files");
+        }
+        const CachedTexture* shown = image_files[current_image_index] == shown_path ? cache.Find(shown_path) : nullptr;
+        if (shown && shown->frame_delays.size() > 1) {
+            ImGui::Text("Frame %d/%d", animation_frame + 1, (int)shown->frame_delays.size());
+        }
+    }
+
+    ImGui::EndChild();
+}
@@ -0,0 +1,78 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Image folder navigator
+    One instance per place the navigator is shown (main window panel, tear-off windows),
+    textures come from the shared TextureCache.
+    While the user flicks through files only cached thumbnails are shown, the full decode
+    starts once the index has stayed put for dwell_time.
+    Animated GIFs play once the cache has their frames, picked by the ImGui frame clock. GIFs streamed
+    because their frames are over the budget play on the cache's clock instead.
+    Full resolution images are drawn through the color manager when one is set, thumbnails as encoded.
+*/
+
+#pragma once
+
+#include "image_files.h"
+#include "texture_cache.h"
+
+#include <string>
+#include <vector>
+
+class ColorManager;
+
+// Shared by all viewers
+struct RefinementStats {
+    int navigations = 0;
+    int full_loads = 0;             // full decodes requested after the dwell time
+    int skipped_loads = 0;          // files navigated past before their full decode was requested
+    int thumbnail_previews = 0;     // files first shown from a cached thumbnail
+    double skipped_megapixels = 0.0;    // decode work avoided, counted for files with a known size
+};
+
+
+class ImageViewer {
+public:
+    ImageViewer(TextureCache& cache, const std::string& directory);
+    ~ImageViewer();
+
+    ImageViewer(const ImageViewer&) = delete;
+    ImageViewer& operator=(const ImageViewer&) = delete;
+
+    // Child window with the current image, navigation buttons and path, -1 fills the parent
+    void Show(const char* title, int width = -1, int height = -1);
+
+    const std::vector<std::string>& Files() const { return image_files; }
+    size_t Index() const { return current_image_index; }
+    void SetIndex(size_t index);
+
+    // Seconds the index has to stay unchanged before the full resolution image is requested
+    static float dwell_time;
+    static RefinementStats stats;
+
+    // Converts tagged images to the display profile, nullptr draws every image as encoded
+    static ColorManager* color_manager;
+
+private:
+    void Navigate(size_t index);
+
+    // Advances the animation of shown_path, returns the texture of its current frame.
+    // 0 when shown_path is not animated or its frames (first streamed frame) are still loading.
+    ImTextureID AnimationTexture(const CachedTexture& shown);
+
+    // Stand-in while path is not shown at full resolution: its stored mid-resolution preview once
+    // the user has settled on it, else its thumbnail
+    const CachedThumbnail* FindInterimPreview(const std::string& path);
+
+    TextureCache& cache;
+    std::vector<std::string> image_files;
+    size_t current_image_index = 0;
+    std::string shown_path;     // acquired, on screen
+    std::string wanted_path;    // acquired, loading; the shown image stays up until it lands
+    std::string preview_path;   // last file shown from its thumbnail
+    double navigation_time = -1e9;
+
+    std::string animation_path;     // file the playback position belongs to, set even when it is not animated
+    int animation_frame = 0;
+    double frame_time = 0.0;        // seconds the current frame has been on screen
+};
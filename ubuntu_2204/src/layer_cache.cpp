@@ -0,0 +1,142 @@
+#include "layer_cache.h"
+#include "gl_ext.h"
+#include "gl_resources.h"
+
+#include "imgui_impl_opengl3.h"
+
+
+uint64_t LayerCache_Hash(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The layer texture already holds premultiplied color (the GL backend blends alpha with ONE, ONE_MINUS_SRC_ALPHA),
+// so compositing it with the default SRC_ALPHA blend would darken translucent pixels twice
+static void SetPremultipliedBlend(const ImDrawList*, const ImDrawCmd*) {
+    gl_ext.BlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+
+LayerCache::~LayerCache() {
+    // GL objects are freed by Release() while the context is still alive
+    if (draw_list) {
+        IM_DELETE(draw_list);
+    }
+}
+
+ImDrawList* LayerCache::Begin(uint64_t new_key, const ImVec2& new_pos, const ImVec2& new_size) {
+    ImVec2 new_scale = ImGui::GetIO().DisplayFramebufferScale;
+    bool unchanged = valid && new_key == key &&
+                     new_pos.x == pos.x && new_pos.y == pos.y &&
+                     new_size.x == size.x && new_size.y == size.y &&
+                     new_scale.x == scale.x && new_scale.y == scale.y;
+    if (unchanged) {
+        hits++;
+        return nullptr;
+    }
+
+    misses++;
+    key = new_key;
+    pos = new_pos;
+    size = new_size;
+    scale = new_scale;
+
+    if (!draw_list) {
+        draw_list = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+    }
+    draw_list->_ResetForNewFrame();
+    draw_list->PushClipRect(pos, ImVec2(pos.x + size.x, pos.y + size.y));
+#if IMGUI_VERSION_NUM >= 19200
+    draw_list->PushTexture(ImGui::GetIO().Fonts->TexRef);
+#else
+    draw_list->PushTextureID(ImGui::GetIO().Fonts->TexID);
+#endif
+    recording = true;
+    return draw_list;
+}
+
+void LayerCache::End() {
+    if (!recording) return;
+    recording = false;
+
+#if IMGUI_VERSION_NUM >= 19200
+    draw_list->PopTexture();
+#else
+    draw_list->PopTextureID();
+#endif
+    draw_list->PopClipRect();
+
+    int width = (int)(size.x * scale.x);
+    int height = (int)(size.y * scale.y);
+    valid = width > 0 && height > 0 && EnsureTarget(width, height);
+    if (!valid) return;
+
+    recorded_vertices = draw_list->VtxBuffer.Size;
+
+    ImDrawData draw_data;
+    draw_data.Valid = true;
+    draw_data.DisplayPos = pos;
+    draw_data.DisplaySize = size;
+    draw_data.FramebufferScale = scale;
+    draw_data.AddDrawList(draw_list);
+
+    GLint last_framebuffer;
+    GLfloat last_clear_color[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, last_clear_color);
+    GLboolean last_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+
+    gl_ext.BindFramebuffer(GL_FRAMEBUFFER, framebuffer.Get());
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ImGui_ImplOpenGL3_RenderDrawData(&draw_data);
+
+    gl_ext.BindFramebuffer(GL_FRAMEBUFFER, (GLuint)last_framebuffer);
+    glClearColor(last_clear_color[0], last_clear_color[1], last_clear_color[2], last_clear_color[3]);
+    if (last_scissor_test) glEnable(GL_SCISSOR_TEST);
+}
+
+void LayerCache::Composite(ImDrawList* target) const {
+    if (!valid) return;
+    // FBO rows start at the bottom, flip V
+    target->AddCallback(SetPremultipliedBlend, nullptr);
+    target->AddImage((ImTextureID)(intptr_t)texture.Get(), pos, ImVec2(pos.x + size.x, pos.y + size.y), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+    target->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void LayerCache::Release() {
+    framebuffer.Reset();
+    texture.Reset();
+    fb_width = fb_height = 0;
+    valid = false;
+}
+
+bool LayerCache::EnsureTarget(int width, int height) {
+    if (framebuffer.Get() && width == fb_width && height == fb_height) return true;
+
+    GLint last_texture, last_framebuffer;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+
+    texture.Create(width, height, nullptr, GL_SITE, name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    framebuffer.Create(GL_SITE, name);
+    gl_ext.BindFramebuffer(GL_FRAMEBUFFER, framebuffer.Get());
+    gl_ext.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.Get(), 0);
+    bool complete = gl_ext.CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    gl_ext.BindFramebuffer(GL_FRAMEBUFFER, (GLuint)last_framebuffer);
+    glBindTexture(GL_TEXTURE_2D, (GLuint)last_texture);
+
+    fb_width = width;
+    fb_height = height;
+    return complete;
+}
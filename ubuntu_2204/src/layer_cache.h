@@ -0,0 +1,67 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Offscreen layer for UI content that rarely changes
+    Content is recorded once into an FBO, then composited as a single textured quad
+    until the caller's key (hash of whatever the content depends on) changes
+*/
+
+#pragma once
+
+#include "gl_resources.h"
+
+#include "imgui.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+// FNV-1a, chain calls through seed to hash several fields
+uint64_t LayerCache_Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+
+class LayerCache {
+public:
+    explicit LayerCache(const char* name) : name(name) {}
+    ~LayerCache();
+
+    LayerCache(const LayerCache&) = delete;
+    LayerCache& operator=(const LayerCache&) = delete;
+
+    // Returns a draw list to record into (screen coordinates) when the key, rect or framebuffer scale changed,
+    // nullptr while the cached texture is still valid. Call End() after recording either way.
+    ImDrawList* Begin(uint64_t key, const ImVec2& pos, const ImVec2& size);
+    void End();
+
+    // False until a recording has been rendered successfully
+    bool Valid() const { return valid; }
+
+    // Adds the cached quad to target, blended as premultiplied alpha
+    void Composite(ImDrawList* target) const;
+
+    // Frees the FBO and texture, needs the GL context current
+    void Release();
+
+    const char* name;
+
+    // Stats for the overlay
+    int hits = 0;
+    int misses = 0;
+    int recorded_vertices = 0;
+
+private:
+    bool EnsureTarget(int fb_width, int fb_height);
+
+    uint64_t key = 0;
+    ImVec2 pos;
+    ImVec2 size;
+    ImVec2 scale;
+    bool valid = false;
+    bool recording = false;
+
+    GLFramebuffer framebuffer;
+    GLTexture texture;
+    int fb_width = 0;
+    int fb_height = 0;
+    ImDrawList* draw_list = nullptr;
+};
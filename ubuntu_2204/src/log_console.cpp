@@ -0,0 +1,73 @@
+#include "log_console.h"
+
+
+static const char* const LEVEL_NAMES[] = { "Debug", "Info", "Warning", "Error" };
+
+static ImVec4 LevelColor(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return ImVec4(0.6f, 0.6f, 0.6f, 1.0f);
+        case LogLevel::Warning: return ImVec4(1.0f, 0.8f, 0.3f, 1.0f);
+        case LogLevel::Error: return ImVec4(1.0f, 0.4f, 0.4f, 1.0f);
+        default: return ImGui::GetStyleColorVec4(ImGuiCol_Text);
+    }
+}
+
+
+bool LogConsole::Passes(const LogEntry& entry) const {
+    if ((int)entry.level < min_level) return false;
+    if (!filter.IsActive()) return true;
+    return filter.PassFilter(entry.text.c_str()) || filter.PassFilter(entry.category.c_str());
+}
+
+void LogConsole::Draw() {
+    // New entries; the visible list is rebuilt when old ones are trimmed or a filter changes
+    size_t first_new = entries.size();
+    Log_Fetch(last_sequence, entries);
+    bool rebuild = false;
+    if (!entries.empty()) last_sequence = entries.back().sequence;
+    if (entries.size() > max_entries) {
+        size_t excess = entries.size() - max_entries;
+        entries.erase(entries.begin(), entries.begin() + excess);
+        first_new = first_new > excess ? first_new - excess : 0;
+        rebuild = true;
+    }
+
+    ImGui::SetNextItemWidth(90.0f);
+    rebuild |= ImGui::Combo("##level", &min_level, LEVEL_NAMES, IM_ARRAYSIZE(LEVEL_NAMES));
+    ImGui::SameLine();
+    rebuild |= filter.Draw("##filter", -170.0f);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        entries.clear();
+        rebuild = true;
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Follow", &auto_scroll);
+
+    if (rebuild) {
+        visible.clear();
+        first_new = 0;
+    }
+    for (size_t i = first_new; i < entries.size(); i++) {
+        if (Passes(entries[i])) visible.push_back((int)i);
+    }
+
+    ImGui::BeginChild("log_lines", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
+    bool at_bottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+    ImGuiListClipper clipper;
+    clipper.Begin((int)visible.size());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            const LogEntry& entry = entries[visible[i]];
+            ImGui::PushStyleColor(ImGuiCol_Text, LevelColor(entry.level));
+            ImGui::Text("%9.3f %-8s %s", entry.time, entry.category.c_str(), entry.text.c_str());
+            ImGui::PopStyleColor();
+        }
+    }
+    clipper.End();
+    // Stay on the newest line unless the user scrolled up
+    if (auto_scroll && at_bottom) {
+        ImGui::SetScrollHereY(1.0f);
+    }
+    ImGui::EndChild();
+}
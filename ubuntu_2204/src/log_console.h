@@ -0,0 +1,36 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Log console widget
+    Pulls new entries from the logger each frame, filters them by level and text,
+    and only lays out the visible lines.
+*/
+
+#pragma once
+
+#include "logger.h"
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <vector>
+
+
+class LogConsole {
+public:
+    // Fills the remaining space of the current window
+    void Draw();
+
+    // Oldest entries are dropped past this count
+    size_t max_entries = 5000;
+
+private:
+    bool Passes(const LogEntry& entry) const;
+
+    std::vector<LogEntry> entries;
+    std::vector<int> visible;       // indices into entries that pass the filters
+    uint64_t last_sequence = 0;
+    ImGuiTextFilter filter;
+    int min_level = (int)LogLevel::Info;
+    bool auto_scroll = true;
+};
@@ -14,10 +14,45 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "batch_convert.h"
+#include "cache_prebuild.h"
+#include "codec_bench.h"
+#include "color_manager.h"
+#include "content_index.h"
+#include "cpu_dispatch.h"
+#include "decoded_cache.h"
+#include "file_telemetry.h"
+#include "flight_recorder.h"
+#include "folder_counts.h"
+#include "folder_tree.h"
+#include "gif_animation.h"
+#include "gl_ext.h"
+#include "gl_resources.h"
+#include "gpu_timer.h"
+#include "icc_profile.h"
+#include "image_viewer.h"
+#include "layer_cache.h"
+#include "log_console.h"
+#include "logger.h"
+#include "manifest_verify.h"
+#include "metrics.h"
+#include "preview_store.h"
+#include "session_state.h"
+#include "soft_rasterizer.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
+
 #include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
 
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -33,7 +68,7 @@
 #pragma comment(linker, "/SUBSYSTEM:windows /ENTRY:mainCRTStartup") // I believe this will run and stop console from popping up
 #endif
 
-#define STB_IMAGE_IMPLEMENTATION
+// stb_image's implementation is compiled into the core library
 #include "stb_image.h"
 
 
@@ -43,155 +78,1172 @@
 void setup_fonts(ImGuiIO& io);
 void setup_logo(GLFWwindow* window);
 
+// Set when the UI is rasterized on the CPU (headless mode, raster benchmark)
+static SoftRasterizer* g_soft_rasterizer = nullptr;
+static bool g_headless = false;
+
+// View menu toggles
+static bool g_show_stats_overlay = false;
+static bool g_show_file_report = false;
+static bool g_show_resource_inspector = false;
+static bool g_show_manifest_verify = false;
+static bool g_cache_static_panels = false;
+
+// Read, decode and upload times of every file loaded, exported as CSV from the report window
+static FileTelemetry g_file_telemetry;
+static std::string g_telemetry_csv_path = "file_telemetry.csv";
+
+// Thumbnails persisted between runs (directory set from the command line)
+static PreviewStore g_preview_store;
+
+// Content hashes of the files shown, so byte-identical copies are decoded and uploaded once.
+// This and the other worker-owning services below are created in main once the app is going to
+// draw its UI, the command line tools never start their threads.
+static std::unique_ptr<ContentIndex> g_content_index;
+
+// Delivery check of the View menu panel, its hashes land in the content index
+static std::unique_ptr<ManifestVerifier> g_manifest_verifier;
+static char g_verify_directory[512] = "data/";
+static char g_verify_manifest[512] = "data/manifest.xxh3";
+static std::vector<VerifyResult> g_verify_rows;     // problems shown, refreshed when the progress moves
+static int g_verify_rows_done = -1;
+static bool g_verify_rows_running = false;
+
+// Decoded pixels in RAM, raw then LZ4 compressed (budgets set from the command line)
+static DecodedCache g_decoded_cache(256u << 20, 256u << 20);
+
+// Decodes and uploads images off the render thread, not started headless or while benchmarking
+static TextureLoader g_texture_loader(g_decoded_cache);
+
+// Image textures shared by the main window and every tear-off viewer window
+static TextureCache g_texture_cache(g_texture_loader, g_decoded_cache);
+static std::unique_ptr<ImageViewer> g_main_viewer;
+static std::string g_viewer_directory = "data/";    // folder of the main viewer, new viewer windows open it too
+
+// Folder tree of Panel 2, rooted where the app started; clicking a folder opens it in the main viewer
+static std::unique_ptr<FolderCounter> g_folder_counter;
+static std::unique_ptr<FolderTree> g_folder_tree;
+
+// Extra top-level windows showing a viewer. Each has its own ImGui context and a GL context
+// sharing objects with the main one.
+struct ViewerWindow {
+    GLFWwindow* window = nullptr;
+    ImGuiContext* context = nullptr;
+    std::unique_ptr<ImageViewer> viewer;
+    std::string folder;
+};
+static std::vector<ViewerWindow> g_viewer_windows;
+static bool g_open_viewer_window = false;
+static const char* g_glsl_version = nullptr;
+
+// Session of the windowed app, written on exit and restored at the next start (empty when disabled).
+// The ImGui layout of the panels is saved next to it.
+static std::string g_session_path;
+static std::string g_imgui_ini_path;
+
+// View menu panels remembered by the session
+static const struct { const char* name; bool* open; } SESSION_PANELS[] = {
+    { "stats_overlay", &g_show_stats_overlay },
+    { "slowest_files", &g_show_file_report },
+    { "gl_resources", &g_show_resource_inspector },
+    { "verify_delivery", &g_show_manifest_verify },
+};
+
+// Log of this run, shown in Panel 3
+static LogConsole g_log_console;
+
+// GPU time of the main window's passes and synchronous uploads
+static GpuTimer g_gpu_timer;
+
+// Hitch traces and snapshots of the flight recorder
+static std::string g_trace_directory = "traces";
+
+// Frame period including the vsync wait, exported with the pipeline metrics
+static MetricHistogram& g_frame_seconds = Metrics_Histogram("app_frame_seconds", "Time between the starts of consecutive frames.", Metrics_TimeBuckets());
+
+// Panel backgrounds, borders and headers, re-recorded only when layout or style changes
+static LayerCache g_panel_layer("panels");
+
+// Source -> display color LUTs for images with an embedded ICC profile
+static ColorManager g_color_manager;
+
 
 void glfw_error_callback(int error, const char* description) {
-    fprintf(stderr, "Glfw Error %d: %s\n", error, description);
+    LOG_ERROR("glfw", "Glfw Error %d: %s", error, description);
 }
 
 
-GLuint LoadTextureFromFile(const char* filename) {
+// The caller owns the texture, it is deleted with the returned handle
+GLTexture LoadTextureFromFile(const char* filename) {
+    GLTexture texture;
     int width, height, channels;
     unsigned char* data = stbi_load(filename, &width, &height, &channels, 4);
     if (!data) {
-        std::cerr << "Failed to load image: " << filename << std::endl;
-        return 0;
+        LOG_ERROR("image", "Failed to load image: %s", filename);
+        return texture;
     }
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture.Create(width, height, data, GL_SITE, filename);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     stbi_image_free(data);
     return texture;
 }
 
+// Image textures go through whichever renderer is active so the same UI code runs headless
+ImTextureID CreateImageTexture(const unsigned char* pixels, int width, int height, const std::string& label) {
+    if (g_headless) {
+        return g_soft_rasterizer->CreateTexture(pixels, width, height);
+    }
 
+    GpuZone gpu_zone(&g_gpu_timer, "Upload");
+    // Owned by the texture cache from here, DestroyImageTexture deletes and untracks it
+    GLTexture created;
+    created.Create(width, height, pixels, GL_SITE, label);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GLuint texture = created.Release();
 
-// Utility function to check if a string ends with a specific suffix
-bool EndsWith(const std::string& str, const std::string& suffix) {
-    return str.size() >= suffix.size() &&
-           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    // The raster benchmark replays GL frames on the CPU, give it a copy of the pixels under the GL name
+    ImTextureID id = (ImTextureID)(intptr_t)texture;
+    if (g_soft_rasterizer) {
+        g_soft_rasterizer->AliasTexture(id, pixels, width, height);
+    }
+    return id;
 }
 
-// Function to scan the directory and get a list of image files
-std::vector<std::string> GetImageFiles(const std::string& directory) {
-    std::vector<std::string> image_files;
-    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-        if (entry.is_regular_file()) {
-            std::string path = entry.path().string();
-            if (EndsWith(path, ".png") || EndsWith(path, ".jpg") || EndsWith(path, ".jpeg")) {
-                image_files.push_back(path);
-            }
+void DestroyImageTexture(ImTextureID id) {
+    if (g_soft_rasterizer) {
+        g_soft_rasterizer->DestroyTexture(id);
+    }
+    if (!g_headless) {
+        GLuint texture = (GLuint)(intptr_t)id;
+        GLResource_Untrack(GLResourceKind::Texture, texture);
+        glDeleteTextures(1, &texture);
+    }
+}
+
+
+
+// Panel headers, in the order the panels are laid out
+static const char* const PANEL_HEADERS[3] = { "Panel 1", "Panel 2", "Panel 3" };
+
+// Everything the cached panel chrome depends on
+uint64_t PanelChromeKey(const ImVec2& origin, const ImVec2& avail, const ImVec2 panel_sizes[3]) {
+    const ImGuiStyle& style = ImGui::GetStyle();
+    ImU32 colors[3] = { ImGui::GetColorU32(ImGuiCol_ChildBg), ImGui::GetColorU32(ImGuiCol_Border), ImGui::GetColorU32(ImGuiCol_Text) };
+    float metrics[5] = { style.ChildRounding, style.ChildBorderSize, style.WindowPadding.x, style.WindowPadding.y, ImGui::GetFontSize() };
+    uint64_t key = LayerCache_Hash(&origin, sizeof(origin));
+    key = LayerCache_Hash(&avail, sizeof(avail), key);
+    key = LayerCache_Hash(panel_sizes, sizeof(ImVec2) * 3, key);
+    key = LayerCache_Hash(colors, sizeof(colors), key);
+    key = LayerCache_Hash(metrics, sizeof(metrics), key);
+    for (const char* header : PANEL_HEADERS) {
+        key = LayerCache_Hash(header, strlen(header), key);
+    }
+    return key;
+}
+
+// What BeginChild(..., true) + Text(header) would draw for each panel
+void DrawPanelChrome(ImDrawList* draw_list, const ImVec2& origin, const ImVec2 panel_sizes[3]) {
+    const ImGuiStyle& style = ImGui::GetStyle();
+    float x = origin.x;
+    for (int i = 0; i < 3; i++) {
+        ImVec2 p_min = ImVec2(x, origin.y);
+        ImVec2 p_max = ImVec2(x + panel_sizes[i].x, origin.y + panel_sizes[i].y);
+        draw_list->AddRectFilled(p_min, p_max, ImGui::GetColorU32(ImGuiCol_ChildBg), style.ChildRounding);
+        if (style.ChildBorderSize > 0.0f) {
+            draw_list->AddRect(p_min, p_max, ImGui::GetColorU32(ImGuiCol_Border), style.ChildRounding, 0, style.ChildBorderSize);
         }
+        draw_list->AddText(ImVec2(p_min.x + style.WindowPadding.x, p_min.y + style.WindowPadding.y), ImGui::GetColorU32(ImGuiCol_Text), PANEL_HEADERS[i]);
+        x = p_max.x + style.ItemSpacing.x;
     }
-    return image_files;
 }
 
+void BeginPanel(const char* id, const char* header, const ImVec2& size, bool cached_chrome) {
+    ImGui::BeginChild(id, size, true);
+    if (cached_chrome) {
+        ImGui::Dummy(ImGui::CalcTextSize(header)); // keep the layout, the header is in the cached layer
+    } else {
+        ImGui::Text("%s", header);
+    }
+}
 
+void ShowStatsOverlay() {
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 10.0f, io.DisplaySize.y - 10.0f), ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.7f);
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+                             ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+    ImGui::Begin("Stats overlay", &g_show_stats_overlay, flags);
+    ImGui::Text("%.1f FPS (%.2f ms)", io.Framerate, io.Framerate > 0.0f ? 1000.0f / io.Framerate : 0.0f);
+    ImGui::Text("Vertices: %d  Indices: %d", io.MetricsRenderVertices, io.MetricsRenderIndices);
+    ImGui::Text("Frame time p50 %.1f ms, p99 %.1f ms over %llu frames", g_frame_seconds.Quantile(0.5) * 1000.0,
+                g_frame_seconds.Quantile(0.99) * 1000.0, (unsigned long long)g_frame_seconds.Count());
+    ImGui::Text("Flight recorder: %d traces written to %s/", FlightRecorder_DumpCount(), g_trace_directory.c_str());
+    if (g_gpu_timer.Available()) {
+        // Loader passes run on its own context, shown next to the render thread's
+        for (const GpuTimer* timer : { &g_gpu_timer, &g_texture_loader.gpu_timer }) {
+            for (const GpuPassTime& pass : timer->Results()) {
+                ImGui::Text("  GPU %s%s: %.2f ms avg, %.2f ms last", timer == &g_gpu_timer ? "" : "loader ", pass.name,
+                            pass.average_ms, pass.last_ms);
+            }
+        }
+        ImGui::Text("  %d GPU results dropped (not ready after %d frames)", g_gpu_timer.dropped_results, GpuTimer::FRAMES);
+    } else if (!g_headless) {
+        ImGui::Text("GPU timer queries unavailable");
+    }
+    if (g_color_manager.Available()) {
+        ColorManagerStats color = g_color_manager.Stats();
+        ImGui::Text("Color: %s, %d LUTs, %d matching the display, %d baking, last bake %.1f ms",
+                    g_color_manager.enabled ? "on" : "off", color.luts, color.identity, color.baking, color.last_bake_ms);
+    }
 
+    ImGui::Separator();
+    const LayerCache& layer = g_panel_layer;
+    int lookups = layer.hits + layer.misses;
+    ImGui::Text("Layer '%s': %s", layer.name, g_cache_static_panels ? "on" : "off");
+    ImGui::Text("  %d hits, %d misses (%.1f%% hit rate)", layer.hits, layer.misses, lookups ? 100.0f * layer.hits / lookups : 0.0f);
+    ImGui::Text("  %d vertices replaced by one quad", layer.recorded_vertices);
+
+    ImGui::Separator();
+    ImGui::Text("GL: %d textures, %.1f MB (peak %.1f MB), see View > GL resources", GLResource_Count(GLResourceKind::Texture),
+                GLResource_Bytes(GLResourceKind::Texture) / 1048576.0, GLResource_PeakBytes() / 1048576.0);
+    ImGui::Text("Textures: %d cached, %d decodes, %d shared, %d viewer windows",
+                g_texture_cache.Size(), g_texture_cache.decodes, g_texture_cache.shared_hits, (int)g_viewer_windows.size());
+    const ContentIndexStats& content = g_content_index->stats;
+    ImGui::Text("Content: %d files hashed (%.2f GB/s), %d duplicates, %d textures shared by content",
+                content.files.load(), content.hash_us ? content.bytes / 1e3 / content.hash_us : 0.0,
+                content.duplicates.load(), g_texture_cache.content_shared);
+    const RefinementStats& refinement = ImageViewer::stats;
+    ImGui::Text("Navigation: %d moves, %d full decodes, %d skipped (%.1f MPix avoided)",
+                refinement.navigations, refinement.full_loads, refinement.skipped_loads, refinement.skipped_megapixels);
+    ImGui::Text("  %d thumbnail previews, %d thumbnails cached (%d from disk, %d from EXIF), %.0f ms dwell",
+                refinement.thumbnail_previews, g_texture_cache.ThumbnailCount(), g_texture_cache.stored_previews,
+                g_texture_cache.exif_previews, ImageViewer::dwell_time * 1000.0f);
+    ImGui::Text("Animation: %d files, %d frames decoded, %d over budget, %d dropped",
+                animation_stats.files_decoded.load(), animation_stats.frames_decoded.load(),
+                animation_stats.over_budget.load(), animation_stats.dropped_frames);
+    ImGui::Text("  over budget: %d frames streamed, %d stalls", animation_stats.frames_streamed.load(),
+                animation_stats.stream_stalls);
+    const DecodedCacheStats& decoded = g_decoded_cache.stats;
+    int decoded_lookups = decoded.raw_hits + decoded.compressed_hits + decoded.misses;
+    int decodes = decoded.misses;
+    ImGui::Text("Decoded RAM: raw %.1f MB, LZ4 %.1f MB (%.0f%% of %.1f MB)",
+                decoded.raw_bytes / 1048576.0, decoded.compressed_bytes / 1048576.0,
+                decoded.compressed_source_bytes ? 100.0 * decoded.compressed_bytes / decoded.compressed_source_bytes : 0.0,
+                decoded.compressed_source_bytes / 1048576.0);
+    ImGui::Text("  hits: raw %.0f%%, LZ4 %.0f%%, miss %.0f%% of %d lookups",
+                decoded_lookups ? 100.0f * decoded.raw_hits / decoded_lookups : 0.0f, decoded_lookups ? 100.0f * decoded.compressed_hits / decoded_lookups : 0.0f,
+                decoded_lookups ? 100.0f * decoded.misses / decoded_lookups : 0.0f, decoded_lookups);
+    ImGui::Text("  %d demoted, %d evicted; decode %.1f ms, LZ4 expand %.1f ms avg",
+                decoded.demotions.load(), decoded.evictions.load(),
+                decodes ? decoded.decode_us / 1000.0 / decodes : 0.0,
+                decoded.compressed_hits ? decoded.decompress_us / 1000.0 / decoded.compressed_hits : 0.0);
+    if (g_texture_loader.Running()) {
+        ImGui::Text("Loader: %d uploads, last %.2f ms (%s)", g_texture_loader.uploads.load(), g_texture_loader.last_upload_ms.load(),
+                    gl_ext.has_sync ? "fence" : "glFinish");
+    } else {
+        ImGui::Text("Loader: render thread");
+    }
+    ImGui::End();
+}
 
-void ShowImageSubwindow(const char* title, const char* directory, int width = -1, int height = -1) {
-    static std::vector<std::string> image_files = GetImageFiles(directory);
-    static size_t current_image_index = 0;
-    static GLuint texture = 0;
-    static int img_width = 0, img_height = 0;
+// Sortable table of every file loaded so far, slowest first, with failures and their reasons
+void ShowFileReport() {
+    ImGui::SetNextWindowSize(ImVec2(900, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Slowest files", &g_show_file_report)) {
+        ImGui::End();
+        return;
+    }
 
-    if (texture == 0 && !image_files.empty()) {
-        const std::string& image_path = image_files[current_image_index];
-        int channels;
-        unsigned char* data = stbi_load(image_path.c_str(), &img_width, &img_height, &channels, 4);
-        if (data) {
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img_width, img_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            stbi_image_free(data);
+    std::vector<FileRecord> rows = g_file_telemetry.Snapshot();
+    ImGui::Text("%d files, %d failed", (int)rows.size(), g_file_telemetry.FailureCount());
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) {
+        if (g_file_telemetry.WriteCSV(g_telemetry_csv_path)) {
+            LOG_INFO("telemetry", "File telemetry written to %s", g_telemetry_csv_path.c_str());
         } else {
-            std::cerr << "Failed to load image: " << image_path << std::endl;
-            return;
+            LOG_ERROR("telemetry", "Failed to write file telemetry: %s", g_telemetry_csv_path.c_str());
         }
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        g_file_telemetry.Clear();
+    }
 
-    // Determine the size of the subwindow
-    ImVec2 size = ImVec2(width, height);
-    if (width == -1 || height == -1) {
-        ImVec2 parent_size = ImGui::GetContentRegionAvail();
-        if (width == -1) size.x = parent_size.x;
-        if (height == -1) size.y = parent_size.y;
-    }
-
-    ImGui::BeginChild(title, size, true, ImGuiWindowFlags_NoScrollbar);
-
-    // Define the fixed height for the image and calculate width to maintain aspect ratio
-    float fixed_height = 150.0f;
-    float fixed_width = fixed_height * (static_cast<float>(img_width) / img_height);
-
-    // Set a black background for the image area
-    ImVec2 p_min = ImGui::GetCursorScreenPos();
-    ImVec2 p_max = ImVec2(p_min.x + fixed_width, p_min.y + fixed_height);
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
-    draw_list->AddRectFilled(p_min, p_max, IM_COL32(0, 0, 0, 255));
-
-    // Draw the image with a white border
-    ImGui::Image((void*)(intptr_t)texture, ImVec2(fixed_width, fixed_height));
-    ImVec2 image_p_min = ImGui::GetItemRectMin();
-    ImVec2 image_p_max = ImGui::GetItemRectMax();
-    draw_list->AddRect(image_p_min, image_p_max, IM_COL32(255, 255, 255, 255), 0.0f, 0, 2.0f);
-
-    // Navigation buttons
-    ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10); // Place buttons below the image with a small padding
-    ImGui::PushStyleColor(ImGuiCol_Button, IM_COL32(255, 192, 203, 255)); // Pink background
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, IM_COL32(255, 0, 0, 255)); // Red hover
-    ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0, 0, 0, 255)); // Black text
-
-    if (ImGui::Button("<-")) {
-        // Handle previous action
-        if (current_image_index > 0) {
-            current_image_index--;
-            glDeleteTextures(1, &texture);
-            texture = 0; // Reset texture to force reloading
+    enum Column { COLUMN_FILE, COLUMN_BYTES, COLUMN_PIXELS, COLUMN_IO, COLUMN_DECODE, COLUMN_UPLOAD, COLUMN_TOTAL, COLUMN_LOADS, COLUMN_STATUS };
+    ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("files", 9, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch, 0.0f, COLUMN_FILE);
+        ImGui::TableSetupColumn("KB", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_BYTES);
+        ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_PIXELS);
+        ImGui::TableSetupColumn("Read ms", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_IO);
+        ImGui::TableSetupColumn("Decode ms", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_DECODE);
+        ImGui::TableSetupColumn("Upload ms", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_UPLOAD);
+        ImGui::TableSetupColumn("Total ms", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_TOTAL);
+        ImGui::TableSetupColumn("Loads", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_LOADS);
+        ImGui::TableSetupColumn("Status", ImGuiTableColumnFlags_WidthStretch, 0.0f, COLUMN_STATUS);
+        ImGui::TableHeadersRow();
+
+        // Records change under us, so the copy is sorted every frame
+        if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
+            if (sort_specs->SpecsCount > 0) {
+                const ImGuiTableColumnSortSpecs& spec = sort_specs->Specs[0];
+                auto key = [&spec](const FileRecord& record) -> double {
+                    switch (spec.ColumnUserID) {
+                        case COLUMN_BYTES: return (double)record.file_bytes;
+                        case COLUMN_PIXELS: return (double)record.width * record.height;
+                        case COLUMN_IO: return record.io_ms;
+                        case COLUMN_DECODE: return record.decode_ms;
+                        case COLUMN_UPLOAD: return record.upload_ms;
+                        case COLUMN_LOADS: return record.loads;
+                        default: return record.TotalMs();
+                    }
+                };
+                bool descending = spec.SortDirection == ImGuiSortDirection_Descending;
+                std::sort(rows.begin(), rows.end(), [&](const FileRecord& a, const FileRecord& b) {
+                    if (spec.ColumnUserID == COLUMN_FILE) return descending ? b.path < a.path : a.path < b.path;
+                    if (spec.ColumnUserID == COLUMN_STATUS) return descending ? b.error < a.error : a.error < b.error;
+                    return descending ? key(b) < key(a) : key(a) < key(b);
+                });
+            }
+            sort_specs->SpecsDirty = false;
         }
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)rows.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const FileRecord& row = rows[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.path.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f", row.file_bytes / 1024.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%dx%d", row.width, row.height);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", row.io_ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", row.decode_ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", row.upload_ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", row.TotalMs());
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", row.loads);
+                ImGui::TableNextColumn();
+                if (row.error.empty()) {
+                    ImGui::TextUnformatted("ok");
+                } else {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", row.error.c_str());
+                }
+            }
+        }
+        ImGui::EndTable();
     }
-    ImGui::SameLine();
-    if (ImGui::Button("->")) {
-        // Handle next action
-        if (current_image_index < image_files.size() - 1) {
-            current_image_index++;
-            glDeleteTextures(1, &texture);
-            texture = 0; // Reset texture to force reloading
+    ImGui::End();
+}
+
+// Live GL objects with their size and where they were made, largest first
+void ShowResourceInspector() {
+    ImGui::SetNextWindowSize(ImVec2(900, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("GL resources", &g_show_resource_inspector)) {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<GLResourceRecord> rows = GLResource_Snapshot();
+    ImGui::Text("%d textures (%.1f MB, peak %.1f MB), %d framebuffers", GLResource_Count(GLResourceKind::Texture),
+                GLResource_Bytes(GLResourceKind::Texture) / 1048576.0, GLResource_PeakBytes() / 1048576.0,
+                GLResource_Count(GLResourceKind::Framebuffer));
+
+    enum Column { COLUMN_KIND, COLUMN_NAME, COLUMN_SIZE, COLUMN_BYTES, COLUMN_CREATED, COLUMN_SITE, COLUMN_LABEL };
+    ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("gl_resources", 7, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Kind", 0, 0.0f, COLUMN_KIND);
+        ImGui::TableSetupColumn("GL name", 0, 0.0f, COLUMN_NAME);
+        ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_SIZE);
+        ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_BYTES);
+        ImGui::TableSetupColumn("Created s", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_CREATED);
+        ImGui::TableSetupColumn("Created at", ImGuiTableColumnFlags_WidthStretch, 0.0f, COLUMN_SITE);
+        ImGui::TableSetupColumn("Label", ImGuiTableColumnFlags_WidthStretch, 0.0f, COLUMN_LABEL);
+        ImGui::TableHeadersRow();
+
+        if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
+            if (sort_specs->SpecsCount > 0) {
+                const ImGuiTableColumnSortSpecs& spec = sort_specs->Specs[0];
+                auto key = [&spec](const GLResourceRecord& record) -> double {
+                    switch (spec.ColumnUserID) {
+                        case COLUMN_KIND: return (double)record.kind;
+                        case COLUMN_NAME: return record.name;
+                        case COLUMN_SIZE: return (double)record.width * record.height;
+                        case COLUMN_CREATED: return record.created;
+                        default: return (double)record.bytes;
+                    }
+                };
+                bool descending = spec.SortDirection == ImGuiSortDirection_Descending;
+                std::sort(rows.begin(), rows.end(), [&](const GLResourceRecord& a, const GLResourceRecord& b) {
+                    if (spec.ColumnUserID == COLUMN_SITE) return descending ? strcmp(b.site, a.site) < 0 : strcmp(a.site, b.site) < 0;
+                    if (spec.ColumnUserID == COLUMN_LABEL) return descending ? b.label < a.label : a.label < b.label;
+                    return descending ? key(b) < key(a) : key(a) < key(b);
+                });
+            }
+            sort_specs->SpecsDirty = false;
+        }
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)rows.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const GLResourceRecord& row = rows[i];
+                const char* site = strrchr(row.site, '/');
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(GLResource_KindName(row.kind));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", row.name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%dx%d", row.width, row.height);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", row.bytes / 1048576.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", row.created);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(site ? site + 1 : row.site);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.label.c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// Folder checked against an xxhsum -H3 manifest in the background: progress, throughput and every file
+// that is missing, differs or is not listed
+void ShowManifestVerify() {
+    ImGui::SetNextWindowSize(ImVec2(700, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Verify delivery", &g_show_manifest_verify)) {
+        ImGui::End();
+        return;
+    }
+
+    bool running = g_manifest_verifier->Running();
+    ImGui::InputText("Folder", g_verify_directory, sizeof(g_verify_directory));
+    ImGui::InputText("Manifest", g_verify_manifest, sizeof(g_verify_manifest));
+    if (running) {
+        if (ImGui::Button("Cancel")) g_manifest_verifier->Cancel();
+    } else if (ImGui::Button("Verify")) {
+        g_manifest_verifier->Start(g_verify_directory, g_verify_manifest);
+    }
+
+    const VerifyProgress& progress = g_manifest_verifier->progress;
+    std::string error = g_manifest_verifier->Error();
+    double seconds = g_manifest_verifier->Seconds();
+    int total = progress.total;
+    if (!error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+    } else if (running && total == 0) {
+        ImGui::Text("Reading the manifest and scanning the folder...");
+    } else {
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%d / %d files", progress.done.load(), total);
+        ImGui::ProgressBar(total ? (float)progress.done / total : 0.0f, ImVec2(-1.0f, 0.0f), overlay);
+        ImGui::Text("%.1f MB in %.2f s (%.1f MB/s)", progress.bytes / 1e6, seconds, seconds > 0.0 ? progress.bytes / 1e6 / seconds : 0.0);
+        ImGui::Text("%d mismatched, %d missing, %d unreadable, %d not in manifest", progress.mismatches.load(),
+                    progress.missing.load(), progress.unreadable.load(), progress.unlisted.load());
+        if (!running && total > 0 && g_manifest_verifier->Succeeded()) {
+            ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.4f, 1.0f), "Every listed file matches");
+        }
+    }
+
+    // Problems() copies the list, it only changes when a file is done or the run ends
+    if (progress.done != g_verify_rows_done || running != g_verify_rows_running) {
+        g_verify_rows = g_manifest_verifier->Problems();
+        g_verify_rows_done = progress.done;
+        g_verify_rows_running = running;
+    }
+    const std::vector<VerifyResult>& rows = g_verify_rows;
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY;
+    if (!rows.empty() && ImGui::BeginTable("verify_problems", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Status");
+        ImGui::TableSetupColumn("Expected");
+        ImGui::TableSetupColumn("Found");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)rows.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const VerifyResult& row = rows[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(row.path.c_str());
+                ImGui::TableNextColumn();
+                if (row.status == VerifyStatus::Unlisted) {
+                    ImGui::TextUnformatted(VerifyStatus_Name(row.status));
+                } else {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", VerifyStatus_Name(row.status));
+                }
+                ImGui::TableNextColumn();
+                if (row.expected) ImGui::Text("%016" PRIx64, row.expected);
+                ImGui::TableNextColumn();
+                if (row.actual) ImGui::Text("%016" PRIx64, row.actual);
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// Last seconds of the flight recorder on demand, for hitches below the watchdog threshold
+void SaveTraceSnapshot() {
+    std::error_code error;
+    std::filesystem::create_directories(g_trace_directory, error);
+    std::string path = g_trace_directory + "/snapshot_" + FlightRecorder_RunTag() + "_" + std::to_string(FlightRecorder_DumpCount()) + ".json";
+    if (FlightRecorder_Dump(path, 5.0, "Snapshot from the View menu")) {
+        LOG_INFO("trace", "Trace written to %s", path.c_str());
+    } else {
+        LOG_ERROR("trace", "Failed to write trace: %s", path.c_str());
+    }
+}
+
+// Menu bar, panels and the optional extra window, shared by the GL loop and headless mode
+void ShowMainWindow(bool& show_another_window) {
+    TRACE_ZONE("ShowMainWindow");
+
+    // Menu bar
+
+    if (ImGui::BeginMainMenuBar()) {
+        if (ImGui::BeginMenu("File")) {
+            ImGui::MenuItem("#1", NULL);
+            ImGui::MenuItem("#2", NULL);
+            ImGui::MenuItem("#3", NULL);
+            ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Edit")) {
+            ImGui::MenuItem("#1", NULL);
+            ImGui::MenuItem("#2", NULL);
+            ImGui::MenuItem("#3", NULL);
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Stats overlay", NULL, &g_show_stats_overlay);
+            ImGui::MenuItem("Slowest files", NULL, &g_show_file_report);
+            ImGui::MenuItem("GL resources", NULL, &g_show_resource_inspector, !g_headless);
+            ImGui::MenuItem("Verify delivery", NULL, &g_show_manifest_verify);
+            if (ImGui::MenuItem("Save trace snapshot")) {
+                SaveTraceSnapshot();
+            }
+            ImGui::MenuItem("Cache static panels", NULL, &g_cache_static_panels, gl_ext.has_framebuffers);
+            ImGui::MenuItem("Color management", NULL, &g_color_manager.enabled, g_color_manager.Available());
+            float dwell_ms = ImageViewer::dwell_time * 1000.0f;
+            if (ImGui::SliderFloat("Full decode dwell (ms)", &dwell_ms, 0.0f, 1000.0f, "%.0f")) {
+                ImageViewer::dwell_time = dwell_ms / 1000.0f;
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("New viewer window", NULL, false, !g_headless)) {
+                g_open_viewer_window = true;
+            }
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Exit")) {
+            ImGui::MenuItem("#1", NULL);
+            ImGui::MenuItem("#2", NULL);
+            ImGui::MenuItem("#3", NULL);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
     }
-    ImGui::PopStyleColor(3);
 
-    // Title
-    ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10); // Adjust position for title
-    ImGui::Text("%s", title);
+    // Create the main window
+
+    ImGui::SetNextWindowPos(ImVec2(0, ImGui::GetFrameHeight()));
+    ImGui::SetNextWindowSize(ImVec2(ImGui::GetIO().DisplaySize.x, ImGui::GetIO().DisplaySize.y - ImGui::GetFrameHeight()));
+    ImGui::Begin("Main Window", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
+
+    // Customize style for panel windows
+    ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.4f, 0.4f, 0.4f, 0.8f));   // Light grey background
+    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.6f, 1.0f, 0.0f, 1.0f));       // White text
+
+    // Panel widths: a third, half of what remains, then the rest
+    const ImGuiStyle& style = ImGui::GetStyle();
+    ImVec2 avail = ImGui::GetContentRegionAvail();
+    ImVec2 panel_sizes[3];
+    panel_sizes[0] = ImVec2(avail.x / 3, avail.y);
+    panel_sizes[1] = ImVec2((avail.x - panel_sizes[0].x - style.ItemSpacing.x) / 2, avail.y);
+    panel_sizes[2] = ImVec2(avail.x - panel_sizes[0].x - panel_sizes[1].x - 2 * style.ItemSpacing.x, avail.y);
+
+    // With the layer cache on, the panel chrome comes from one cached quad and the children draw nothing behind their content.
+    // The quad is a GL texture composited through a GL blend callback, so frames for the soft rasterizer draw the chrome.
+    bool cached_chrome = g_cache_static_panels && gl_ext.has_framebuffers && !g_soft_rasterizer;
+    if (cached_chrome) {
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        if (ImDrawList* layer_list = g_panel_layer.Begin(PanelChromeKey(origin, avail, panel_sizes), origin, avail)) {
+            DrawPanelChrome(layer_list, origin, panel_sizes);
+        }
+        {
+            GpuZone gpu_zone(&g_gpu_timer, "Panel layer");
+            g_panel_layer.End();
+        }
+        if (g_panel_layer.Valid()) {
+            g_panel_layer.Composite(ImGui::GetWindowDrawList());
+            ImGui::PushStyleColor(ImGuiCol_ChildBg, IM_COL32(0, 0, 0, 0));
+            ImGui::PushStyleColor(ImGuiCol_Border, IM_COL32(0, 0, 0, 0));
+        } else {
+            cached_chrome = false;
+        }
+    }
 
-    // Current media path
-    if (!image_files.empty()) {
-        ImGui::Text("Current media: %s", image_files[current_image_index].c_str());
+    // Create sub-windows inside the main window
+    BeginPanel("panel_window1", "Panel 1", panel_sizes[0], cached_chrome);
+
+    if (g_main_viewer) {
+        g_main_viewer->Show("(Image Folder Navigator)", -1, 250); // Dynamic sizing
     }
 
     ImGui::EndChild();
+    ImGui::SameLine();
+    BeginPanel("panel_window2", "Panel 2", panel_sizes[1], cached_chrome);
+    std::string clicked_folder;
+    if (g_folder_tree->Draw(clicked_folder) && clicked_folder != g_viewer_directory) {
+        g_viewer_directory = clicked_folder;
+        g_folder_tree->current = clicked_folder;
+        g_main_viewer = std::make_unique<ImageViewer>(g_texture_cache, g_viewer_directory);
+    }
+    ImGui::EndChild();
+    ImGui::SameLine();
+    BeginPanel("panel_window3", "Panel 3", panel_sizes[2], cached_chrome); // Remaining space
+    g_log_console.Draw();
+    ImGui::EndChild();
+
+    // Restore style
+    if (cached_chrome) {
+        ImGui::PopStyleColor(2);
+    }
+    ImGui::PopStyleColor(2);
+    ImGui::End();
+
+    if (show_another_window)
+    {
+        ImGui::Begin("Another Window", &show_another_window); // pass a pointer to our bool variable (the window will have a closing button that will clear the bool when clicked)
+        ImGui::Text("Hello from another window!");
+        if (ImGui::Button("Close Me"))
+            show_another_window = false;
+        ImGui::End();
+    }
+
+    if (g_show_stats_overlay) {
+        ShowStatsOverlay();
+    }
+    if (g_show_file_report) {
+        ShowFileReport();
+    }
+    if (g_show_resource_inspector) {
+        ShowResourceInspector();
+    }
+    if (g_show_manifest_verify) {
+        ShowManifestVerify();
+    }
+}
+
+// Renders the UI without a window or GL context into a CPU framebuffer, then writes the last frame out
+int RunHeadless(int frame_count, const char* output_path, const ImVec4& clear_color) {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = NULL;
+    io.DisplaySize = ImVec2(1280, 720);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.BackendRendererName = "soft_rasterizer";
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+#if IMGUI_VERSION_NUM >= 19200
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+#endif
+    ImGui::StyleColorsDark();
+    setup_fonts(io);
+
+    SoftRasterizer rasterizer;
+    g_soft_rasterizer = &rasterizer;
+    g_headless = true;
+    rasterizer.UpdateTextures(nullptr);
+    g_main_viewer = std::make_unique<ImageViewer>(g_texture_cache, g_viewer_directory);
+
+    SoftFramebuffer framebuffer;
+    bool show_another_window = false;
+    double total_ms = 0.0, worst_ms = 0.0;
+    auto last_frame_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frame_count; i++) {
+        FlightRecorder_BeginFrame();
+        // Start to start like the GL loop, so app_frame_seconds means the same in both modes
+        auto frame_start = std::chrono::steady_clock::now();
+        g_frame_seconds.Observe(std::chrono::duration<double>(frame_start - last_frame_start).count());
+        last_frame_start = frame_start;
+
+        g_texture_cache.Animate(io.DeltaTime);
+        ImGui::NewFrame();
+        ShowMainWindow(show_another_window);
+        ImGui::Render();
+        ImDrawData* draw_data = ImGui::GetDrawData();
+        rasterizer.UpdateTextures(draw_data);
+        rasterizer.Render(draw_data, framebuffer, clear_color);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+        total_ms += ms;
+        if (ms > worst_ms) worst_ms = ms;
+    }
+
+    printf("headless: %d frames at %dx%d, %.3f ms avg, %.3f ms worst, %d triangles, %d threads\n",
+           frame_count, framebuffer.width, framebuffer.height, total_ms / frame_count, worst_ms,
+           rasterizer.last_triangle_count, rasterizer.ThreadCount());
+
+    bool written = EndsWith(output_path, ".qoi") ? framebuffer.WriteQOI(output_path) : framebuffer.WritePPM(output_path);
+    if (written) {
+        std::cout << "Last frame written to " << output_path << std::endl;
+    } else {
+        LOG_ERROR("headless", "Failed to write frame: %s", output_path);
+    }
+
+    g_main_viewer.reset();
+    g_texture_cache.Clear();
+    ImGui::DestroyContext();
+    g_headless = false;
+    g_soft_rasterizer = nullptr;
+    return written ? 0 : 1;
+}
+
+// Captures frames of the real UI, then replays the same draw data through the GL backend and through
+// the CPU rasterizer. Run with LIBGL_ALWAYS_SOFTWARE=1 to measure llvmpipe on the GL side.
+int RunRasterBenchmark(GLFWwindow* window, int frame_count, const ImVec4& clear_color) {
+    SoftRasterizer rasterizer;
+    g_soft_rasterizer = &rasterizer;
+    glfwSwapInterval(0);
+
+    std::vector<ImDrawData> frames(frame_count);
+    bool show_another_window = false;
+    for (ImDrawData& frame : frames) {
+        glfwPollEvents();
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ShowMainWindow(show_another_window);
+        ImGui::Render();
+
+        // The GL backend still renders the live frame so it services font atlas requests
+        ImDrawData* draw_data = ImGui::GetDrawData();
+        ImGui_ImplOpenGL3_RenderDrawData(draw_data);
+
+        frame.Valid = true;
+        frame.DisplayPos = draw_data->DisplayPos;
+        frame.DisplaySize = draw_data->DisplaySize;
+        frame.FramebufferScale = draw_data->FramebufferScale;
+        for (ImDrawList* draw_list : draw_data->CmdLists) {
+            frame.AddDrawList(draw_list->CloneOutput());
+        }
+    }
+
+    int display_w, display_h;
+    glfwGetFramebufferSize(window, &display_w, &display_h);
+    glFinish();
+    auto gl_start = std::chrono::steady_clock::now();
+    for (ImDrawData& frame : frames) {
+        glViewport(0, 0, display_w, display_h);
+        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(&frame);
+        glFinish();
+    }
+    double gl_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gl_start).count() / frame_count;
+
+    SoftFramebuffer framebuffer;
+    auto soft_start = std::chrono::steady_clock::now();
+    for (ImDrawData& frame : frames) {
+        rasterizer.Render(&frame, framebuffer, clear_color);
+    }
+    double soft_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - soft_start).count() / frame_count;
+
+    printf("raster benchmark: %d captured frames at %dx%d, %d triangles in the last frame\n",
+           frame_count, display_w, display_h, rasterizer.last_triangle_count);
+    printf("  GL (%s): %.3f ms/frame\n", (const char*)glGetString(GL_RENDERER), gl_ms);
+    printf("  soft rasterizer (%d threads): %.3f ms/frame\n", rasterizer.ThreadCount(), soft_ms);
+
+    for (ImDrawData& frame : frames) {
+        for (ImDrawList* draw_list : frame.CmdLists) {
+            IM_DELETE(draw_list);
+        }
+        frame.Clear();
+    }
+    g_soft_rasterizer = nullptr;
+    return 0;
 }
 
+// Opens a top-level window with its own viewer. Its context shares objects with main_window,
+// so textures from the cache and the font atlas texture are used without another upload.
+// Shows what the main viewer shows, or the folder, file and placement of a restored session.
+void OpenViewerWindow(GLFWwindow* main_window, const SessionViewer* restore = nullptr) {
+    ImGuiContext* main_context = ImGui::GetCurrentContext();
+    char title[64];
+    snprintf(title, sizeof(title), "Viewer %d", (int)g_viewer_windows.size() + 1);
+
+    ViewerWindow viewer_window;
+    const WindowPlacement* placement = restore ? &restore->placement : nullptr;
+    int width = placement && placement->width > 0 ? placement->width : 640;
+    int height = placement && placement->height > 0 ? placement->height : 360;
+    viewer_window.window = glfwCreateWindow(width, height, title, NULL, main_window);
+    if (!viewer_window.window) {
+        LOG_ERROR("app", "Failed to create viewer window");
+        return;
+    }
+    if (placement && placement->x >= 0) glfwSetWindowPos(viewer_window.window, placement->x, placement->y);
+    glfwMakeContextCurrent(viewer_window.window);
+    glfwSwapInterval(0); // the main window's swap paces the loop
 
+#if IMGUI_VERSION_NUM >= 19200
+    viewer_window.context = ImGui::CreateContext(ImGui::GetIO().Fonts);
+#else
+    viewer_window.context = ImGui::CreateContext();
+#endif
+    ImGui::SetCurrentContext(viewer_window.context);
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = NULL;
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(viewer_window.window, true);
+    ImGui_ImplOpenGL3_Init(g_glsl_version);
+#if IMGUI_VERSION_NUM < 19200
+    setup_fonts(io);
+#endif
+    viewer_window.folder = restore ? restore->folder : g_viewer_directory;
+    viewer_window.viewer = std::make_unique<ImageViewer>(g_texture_cache, viewer_window.folder);
+    if (restore) {
+        viewer_window.viewer->SetIndex(Session_FindIndex(viewer_window.viewer->Files(), restore->file, restore->index));
+    } else if (g_main_viewer) {
+        viewer_window.viewer->SetIndex(g_main_viewer->Index());
+    }
+    g_viewer_windows.push_back(std::move(viewer_window));
+
+    ImGui::SetCurrentContext(main_context);
+    glfwMakeContextCurrent(main_window);
+}
 
+void CloseViewerWindow(ViewerWindow& viewer_window) {
+    glfwMakeContextCurrent(viewer_window.window);
+    ImGui::SetCurrentContext(viewer_window.context);
+    viewer_window.viewer.reset();
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext(viewer_window.context);
+    glfwDestroyWindow(viewer_window.window);
+}
 
+static WindowPlacement GetPlacement(GLFWwindow* window) {
+    WindowPlacement placement;
+    glfwGetWindowPos(window, &placement.x, &placement.y);
+    glfwGetWindowSize(window, &placement.width, &placement.height);
+    placement.maximized = glfwGetWindowAttrib(window, GLFW_MAXIMIZED) != 0;
+    return placement;
+}
 
+static SessionViewer GetSessionViewer(const ImageViewer& viewer, const std::string& folder) {
+    SessionViewer session_viewer;
+    session_viewer.folder = folder;
+    session_viewer.index = (int)viewer.Index();
+    if (viewer.Index() < viewer.Files().size()) session_viewer.file = viewer.Files()[viewer.Index()];
+    return session_viewer;
+}
 
+// Called before the viewer windows close, while everything to remember is still open
+void SaveSession(GLFWwindow* main_window) {
+    Session session;
+    session.window = GetPlacement(main_window);
+    session.tree_root = g_folder_tree->Root();
+    if (g_main_viewer) session.viewers.push_back(GetSessionViewer(*g_main_viewer, g_viewer_directory));
+    for (const ViewerWindow& viewer_window : g_viewer_windows) {
+        SessionViewer session_viewer = GetSessionViewer(*viewer_window.viewer, viewer_window.folder);
+        session_viewer.placement = GetPlacement(viewer_window.window);
+        session.viewers.push_back(std::move(session_viewer));
+    }
+    for (const auto& panel : SESSION_PANELS) {
+        if (*panel.open) session.panels.push_back(panel.name);
+    }
+    if (!Session_Save(g_session_path, session)) {
+        LOG_WARNING("app", "Failed to save the session: %s", g_session_path.c_str());
+    }
+}
+
+// Draws every viewer window, closes the ones whose close button was pressed.
+// Leaves main_window's GL and ImGui contexts current.
+void RenderViewerWindows(GLFWwindow* main_window, const ImVec4& clear_color) {
+    TRACE_ZONE("RenderViewerWindows");
+    ImGuiContext* main_context = ImGui::GetCurrentContext();
+    for (size_t i = 0; i < g_viewer_windows.size();) {
+        ViewerWindow& viewer_window = g_viewer_windows[i];
+        if (glfwWindowShouldClose(viewer_window.window)) {
+            CloseViewerWindow(viewer_window);
+            g_viewer_windows.erase(g_viewer_windows.begin() + i);
+            continue;
+        }
+
+        glfwMakeContextCurrent(viewer_window.window);
+        ImGui::SetCurrentContext(viewer_window.context);
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+        ImGui::Begin("Viewer", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings);
+        viewer_window.viewer->Show("(Image Folder Navigator)");
+        ImGui::End();
+
+        ImGui::Render();
+        int display_w, display_h;
+        glfwGetFramebufferSize(viewer_window.window, &display_w, &display_h);
+        glViewport(0, 0, display_w, display_h);
+        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glfwSwapBuffers(viewer_window.window);
+        i++;
+    }
+    ImGui::SetCurrentContext(main_context);
+    glfwMakeContextCurrent(main_window);
+}
+
+// Cache and loader counts are kept in their own atomics, copied into metrics when exported
+void RegisterPipelineMetrics() {
+    struct CacheMetrics {
+        MetricCounter& raw_hits = Metrics_Counter("decoded_cache_raw_hits_total", "Decoded cache lookups served from the raw tier.");
+        MetricCounter& compressed_hits = Metrics_Counter("decoded_cache_lz4_hits_total", "Decoded cache lookups served from the LZ4 tier.");
+        MetricCounter& misses = Metrics_Counter("decoded_cache_misses_total", "Decoded cache lookups that needed a decode.");
+        MetricCounter& evictions = Metrics_Counter("decoded_cache_evictions_total", "Images dropped from the decoded cache.");
+        MetricGauge& raw_bytes = Metrics_Gauge("decoded_cache_raw_bytes", "Bytes held by the raw tier.");
+        MetricGauge& compressed_bytes = Metrics_Gauge("decoded_cache_lz4_bytes", "Bytes held by the LZ4 tier.");
+        MetricCounter& uploads = Metrics_Counter("texture_loader_uploads_total", "Textures uploaded by the loader thread.");
+        MetricGauge& texture_bytes = Metrics_Gauge("gl_texture_bytes", "Estimated size of the live textures the app created.");
+        MetricGauge& textures = Metrics_Gauge("gl_textures", "Live textures the app created.");
+    };
+    static CacheMetrics metrics;
+    Metrics_AddCollector([]() {
+        const DecodedCacheStats& decoded = g_decoded_cache.stats;
+        metrics.raw_hits.Set(decoded.raw_hits.load());
+        metrics.compressed_hits.Set(decoded.compressed_hits.load());
+        metrics.misses.Set(decoded.misses.load());
+        metrics.evictions.Set(decoded.evictions.load());
+        metrics.raw_bytes.Set((double)decoded.raw_bytes.load());
+        metrics.compressed_bytes.Set((double)decoded.compressed_bytes.load());
+        metrics.uploads.Set(g_texture_loader.uploads.load());
+        metrics.texture_bytes.Set((double)GLResource_Bytes(GLResourceKind::Texture));
+        metrics.textures.Set(GLResource_Count(GLResourceKind::Texture));
+    });
+}
+
+// Per user and absolute, so the viewer and a --prebuild-cache cron job share one store whatever
+// folder they start in: $XDG_CACHE_HOME/cmake-imgui-app, else ~/.cache/cmake-imgui-app
+static std::string DefaultCacheDirectory() {
+    const char* xdg_cache = getenv("XDG_CACHE_HOME");
+    if (xdg_cache && xdg_cache[0] == '/') return std::string(xdg_cache) + "/cmake-imgui-app";
+    const char* home = getenv("HOME");
+    if (home && home[0]) return std::string(home) + "/.cache/cmake-imgui-app";
+    return "cache";
+}
 
 // ---------------------------------------------
 // ---------------------------------------------
 
-int main(int, char**) {
-    
+int main(int argc, char** argv) {
+
+    // command line options
+
+    ImVec4 clear_color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+    int headless_frames = 0;
+    const char* headless_output = "headless_frame.ppm";
+    const char* bench_codec_directory = nullptr;
+    BatchConvertOptions batch_convert;
+    const char* prebuild_directory = nullptr;
+    const char* verify_directory = nullptr;
+    const char* verify_manifest = nullptr;
+    bool folder_given = false;
+    bool use_session = true;
+    std::string cache_directory = DefaultCacheDirectory();
+    std::string log_path;   // empty: no log file, only the console history and stderr
+    std::string metrics_path;
+    std::string display_icc_path;
+    double hitch_ms = 100.0;
+    const char* cpu_level_name = "auto";
+    int metrics_port = 0;
+    double metrics_interval = 10.0;
+    int bench_raster_frames = 0;
+    int raw_cache_mb = 256;
+    int lz4_cache_mb = 256;
+    int gif_cache_mb = 64;
+    bool write_telemetry_on_exit = false;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc && argv[i + 1][0] != '-';
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless_frames = has_value ? atoi(argv[++i]) : 120;
+        } else if (strcmp(argv[i], "--folder") == 0 && has_value) {
+            g_viewer_directory = argv[++i];
+            folder_given = true;
+        } else if (strcmp(argv[i], "--no-session") == 0) {
+            use_session = false;
+        } else if (strcmp(argv[i], "--headless-out") == 0 && has_value) {
+            headless_output = argv[++i];
+        } else if (strcmp(argv[i], "--bench-codec") == 0) {
+            bench_codec_directory = has_value ? argv[++i] : "data/";
+        } else if (strcmp(argv[i], "--batch-convert") == 0 && i + 2 < argc) {
+            batch_convert.input = argv[++i];
+            batch_convert.output = argv[++i];
+        } else if (strcmp(argv[i], "--max-size") == 0 && has_value) {
+            batch_convert.max_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && has_value) {
+            batch_convert.format = argv[++i];
+        } else if (strcmp(argv[i], "--quality") == 0 && has_value) {
+            batch_convert.quality = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log-file") == 0 && has_value) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && has_value) {
+            metrics_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics-file") == 0 && has_value) {
+            metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && has_value) {
+            metrics_interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--hitch-ms") == 0 && has_value) {
+            hitch_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--trace-dir") == 0 && has_value) {
+            g_trace_directory = argv[++i];
+        } else if (strcmp(argv[i], "--cpu-level") == 0 && has_value) {
+            cpu_level_name = argv[++i];
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && has_value) {
+            cache_directory = argv[++i];
+        } else if (strcmp(argv[i], "--prebuild-cache") == 0 && has_value) {
+            prebuild_directory = argv[++i];
+        } else if (strcmp(argv[i], "--verify-manifest") == 0 && i + 2 < argc) {
+            verify_directory = argv[++i];
+            verify_manifest = argv[++i];
+        } else if (strcmp(argv[i], "--raw-cache-mb") == 0 && has_value) {
+            raw_cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lz4-cache-mb") == 0 && has_value) {
+            lz4_cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--telemetry-csv") == 0 && has_value) {
+            g_telemetry_csv_path = argv[++i];
+            write_telemetry_on_exit = true;
+        } else if (strcmp(argv[i], "--gif-cache-mb") == 0 && has_value) {
+            gif_cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--display-icc") == 0 && has_value) {
+            display_icc_path = argv[++i];
+        } else if (strcmp(argv[i], "--dwell-ms") == 0 && has_value) {
+            ImageViewer::dwell_time = atoi(argv[++i]) / 1000.0f;
+        } else if (strcmp(argv[i], "--bench-raster") == 0) {
+            bench_raster_frames = has_value ? atoi(argv[++i]) : 120;
+        } else {
+            LOG_WARNING("app", "Unknown option: %s", argv[i]);
+        }
+    }
+
+    // From here on messages go through the writer thread, it is drained at exit
+    Log_Start(log_path);
+    FlightRecorder_SetThreadName("render");
+    // Headless frames are software rendered and routinely run past the threshold
+    if (headless_frames == 0) {
+        FlightRecorder_StartWatchdog(hitch_ms, g_trace_directory);
+    }
+    CpuLevel cpu_level = CpuDispatch_Detect();
+    if (!CpuDispatch_ParseLevel(cpu_level_name, cpu_level)) {
+        LOG_WARNING("cpu", "Unknown --cpu-level %s, expected scalar, sse2, avx2, avx512, neon or auto", cpu_level_name);
+    }
+    CpuDispatch_Select(cpu_level);
+    RegisterPipelineMetrics();
+    if (metrics_port > 0 || !metrics_path.empty()) {
+        Metrics_StartExport(metrics_port, metrics_path, metrics_interval);
+    }
+
+    g_decoded_cache.SetBudgets((size_t)raw_cache_mb << 20, (size_t)lz4_cache_mb << 20);
+    g_texture_loader.animation_budget = (size_t)gif_cache_mb << 20;
+    if (bench_codec_directory) {
+        return RunCodecBenchmark(bench_codec_directory);
+    }
+    if (!batch_convert.input.empty()) {
+        return RunBatchConvert(batch_convert);
+    }
+    if (verify_directory) {
+        return RunManifestVerify(verify_directory, verify_manifest, nullptr);
+    }
+
+    g_preview_store.SetDirectory(cache_directory.empty() ? std::string() : cache_directory + "/previews");
+    if (prebuild_directory) {
+        return RunCachePrebuild(prebuild_directory, g_preview_store);
+    }
+
+    g_content_index = std::make_unique<ContentIndex>();
+    g_manifest_verifier = std::make_unique<ManifestVerifier>(g_content_index.get());
+    g_folder_counter = std::make_unique<FolderCounter>();
+    g_folder_tree = std::make_unique<FolderTree>(*g_folder_counter);
+    // Wired before the session warm-up so its entries land under the content keys the viewers look up
+    g_decoded_cache.telemetry = &g_file_telemetry;
+    g_decoded_cache.content = g_content_index.get();
+
+    // The session is read before any window exists: the files shown at exit decode on these workers
+    // while GLFW, GL and ImGui start up, and the viewers find them in the decoded cache
+    Session session;
+    bool restore_session = false;
+    std::unique_ptr<ThreadPool> session_warmup;
+    if (use_session && !cache_directory.empty() && headless_frames == 0 && bench_raster_frames == 0) {
+        g_session_path = cache_directory + "/session.txt";
+        g_imgui_ini_path = cache_directory + "/imgui.ini";
+        std::error_code error;
+        std::filesystem::create_directories(cache_directory, error);
+        restore_session = Session_Load(g_session_path, session);
+    }
+    if (restore_session) {
+        // A folder from the command line replaces the main viewer's, the viewer windows come back as they were
+        if (folder_given && !session.viewers.empty() && session.viewers[0].folder != g_viewer_directory) {
+            session.viewers[0] = SessionViewer{ g_viewer_directory };
+        } else if (!session.viewers.empty()) {
+            g_viewer_directory = session.viewers[0].folder;
+        }
+        session_warmup = std::make_unique<ThreadPool>(2);
+        for (const SessionViewer& viewer : session.viewers) {
+            if (viewer.file.empty()) continue;
+            std::string path = viewer.file;
+            session_warmup->Submit([path] { g_decoded_cache.Load(path); });
+        }
+        for (const auto& panel : SESSION_PANELS) {
+            *panel.open = std::find(session.panels.begin(), session.panels.end(), panel.name) != session.panels.end();
+        }
+    }
+
+    g_texture_loader.previews = &g_preview_store;
+    g_texture_cache.previews = &g_preview_store;
+    g_texture_cache.create_texture = CreateImageTexture;
+    g_folder_tree->SetRoot(restore_session && !folder_given && !session.tree_root.empty() ? session.tree_root : g_viewer_directory);
+    g_folder_tree->current = g_viewer_directory;
+    g_texture_cache.content = g_content_index.get();
+    g_texture_cache.destroy_texture = DestroyImageTexture;
+    ImageViewer::color_manager = &g_color_manager;
+    if (!display_icc_path.empty()) {
+        IccProfile display_profile;
+        if (IccProfile_Load(display_icc_path, display_profile)) {
+            g_color_manager.SetDisplayProfile(display_profile);
+        } else {
+            LOG_WARNING("color", "Cannot use display profile %s (not an RGB matrix/TRC profile), assuming sRGB", display_icc_path.c_str());
+        }
+    }
+
+    if (headless_frames > 0) {
+        int headless_result = RunHeadless(headless_frames, headless_output, clear_color);
+        if (write_telemetry_on_exit && !g_file_telemetry.WriteCSV(g_telemetry_csv_path)) {
+            LOG_ERROR("telemetry", "Failed to write file telemetry: %s", g_telemetry_csv_path.c_str());
+        }
+        return headless_result;
+    }
+
     // setup window
 
     glfwSetErrorCallback(glfw_error_callback);
@@ -221,18 +1273,34 @@ int main(int, char**) {
     // glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
 #endif
 
-    // create 720p window with graphics context
-    GLFWwindow* window = glfwCreateWindow(1280, 720, "scons-imgui-app", NULL, NULL);
+    // the raster benchmark only needs the context, keep its window off screen
+    if (bench_raster_frames > 0) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+
+    // create 720p window with graphics context, or the size and place it had at the end of the last session
+    const WindowPlacement& placement = session.window;
+    GLFWwindow* window = glfwCreateWindow(placement.width > 0 ? placement.width : 1280, placement.height > 0 ? placement.height : 720,
+                                          "scons-imgui-app", NULL, NULL);
 
     if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+        LOG_ERROR("app", "Failed to create GLFW window");
         glfwTerminate();
         return -1;
     }
+    if (placement.x >= 0) glfwSetWindowPos(window, placement.x, placement.y);
+    if (placement.maximized) glfwMaximizeWindow(window);
 
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1); // enable vsync
 
+    if (!GLExt_Load()) {
+        LOG_WARNING("gl", "Framebuffer objects unavailable, panel layer cache disabled");
+    }
+    if (!g_gpu_timer.Init("GPU render")) {
+        LOG_INFO("gl", "Timer queries unavailable, GPU pass times disabled");
+    }
+
     // setup Dear ImGui context
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -240,7 +1308,7 @@ int main(int, char**) {
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     //io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
     //io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
-    io.IniFilename = NULL; // disable imgui.ini
+    io.IniFilename = g_imgui_ini_path.empty() ? NULL : g_imgui_ini_path.c_str(); // panel layout, kept with the session
 
     // Setup Dear ImGui style
     ImGui::StyleColorsDark();
@@ -249,6 +1317,8 @@ int main(int, char**) {
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    g_glsl_version = glsl_version;
+    g_color_manager.Init(glsl_version);
 
     
 
@@ -259,11 +1329,28 @@ int main(int, char**) {
 
     bool show_demo_window = false;
     bool show_another_window = false;
-    ImVec4 clear_color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+    g_main_viewer = std::make_unique<ImageViewer>(g_texture_cache, g_viewer_directory);
+    if (restore_session && !session.viewers.empty()) {
+        g_main_viewer->SetIndex(Session_FindIndex(g_main_viewer->Files(), session.viewers[0].file, session.viewers[0].index));
+    }
+
+    int exit_code = 0;
+    if (bench_raster_frames > 0) {
+        exit_code = RunRasterBenchmark(window, bench_raster_frames, clear_color);
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    } else {
+        g_texture_loader.Start(window);
+    }
+    for (size_t i = 1; restore_session && i < session.viewers.size(); i++) {
+        OpenViewerWindow(window, &session.viewers[i]);
+    }
 
 
     // Main loop
 
+    auto last_frame_start = std::chrono::steady_clock::now();
+
     while (!glfwWindowShouldClose(window))
     {
         // poll and handle events (inputs, window resize, etc.)
@@ -273,6 +1360,23 @@ int main(int, char**) {
         // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
         glfwPollEvents();
 
+        FlightRecorder_BeginFrame();
+        auto frame_start = std::chrono::steady_clock::now();
+        double frame_seconds = std::chrono::duration<double>(frame_start - last_frame_start).count();
+        g_frame_seconds.Observe(frame_seconds);
+        last_frame_start = frame_start;
+        g_gpu_timer.BeginFrame();
+
+        // publish textures whose upload has completed on the loader context
+        g_texture_cache.Poll();
+        // Streamed GIFs step once per frame whichever windows show them
+        g_texture_cache.Animate(frame_seconds);
+        g_color_manager.Poll();
+        // The warm-up threads go once the restored images are in the decoded cache
+        if (session_warmup && session_warmup->Idle()) {
+            session_warmup.reset();
+        }
+
         // Start the Dear ImGui frame
 
         ImGui_ImplOpenGL3_NewFrame();
@@ -280,84 +1384,56 @@ int main(int, char**) {
         ImGui::NewFrame();
 
 
-        // Menu bar
-
-        if (ImGui::BeginMainMenuBar()) {
-            if (ImGui::BeginMenu("File")) {
-                ImGui::MenuItem("#1", NULL);
-                ImGui::MenuItem("#2", NULL);
-                ImGui::MenuItem("#3", NULL);
-                ImGui::EndMenu();
-            }
-            if (ImGui::BeginMenu("Edit")) {
-                ImGui::MenuItem("#1", NULL);
-                ImGui::MenuItem("#2", NULL);
-                ImGui::MenuItem("#3", NULL);
-                ImGui::EndMenu();
-            }
-            if (ImGui::BeginMenu("Exit")) {
-                ImGui::MenuItem("#1", NULL);
-                ImGui::MenuItem("#2", NULL);
-                ImGui::MenuItem("#3", NULL);
-                ImGui::EndMenu();
-            }
-            ImGui::EndMainMenuBar();
-        }
-
-        // Create the main window
-
-        ImGui::SetNextWindowPos(ImVec2(0, ImGui::GetFrameHeight()));
-        ImGui::SetNextWindowSize(ImVec2(ImGui::GetIO().DisplaySize.x, ImGui::GetIO().DisplaySize.y - ImGui::GetFrameHeight()));
-        ImGui::Begin("Main Window", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
-
-        // Customize style for panel windows
-        ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.4f, 0.4f, 0.4f, 0.8f));   // Light grey background
-        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.6f, 1.0f, 0.0f, 1.0f));       // White text
-
-        // Create sub-windows inside the main window
-        ImGui::BeginChild("panel_window1", ImVec2(ImGui::GetContentRegionAvail().x / 3, ImGui::GetContentRegionAvail().y), true);
-        ImGui::Text("Panel 1");
-
-        ShowImageSubwindow("(Image Folder Navigator)", "data/", -1, 250); // Dynamic sizing
-
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("panel_window2", ImVec2(ImGui::GetContentRegionAvail().x / 2, ImGui::GetContentRegionAvail().y), true);
-        ImGui::Text("Panel 2");
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("panel_window3", ImVec2(0, ImGui::GetContentRegionAvail().y), true); // Remaining space
-        ImGui::Text("Panel 3");
-        ImGui::EndChild();
-
-        // Restore style
-        ImGui::PopStyleColor(2);
-        ImGui::End();
-
-        if (show_another_window)
-        {
-            ImGui::Begin("Another Window", &show_another_window); // pass a pointer to our bool variable (the window will have a closing button that will clear the bool when clicked)
-            ImGui::Text("Hello from another window!");
-            if (ImGui::Button("Close Me"))
-                show_another_window = false;
-            ImGui::End();
-        }
+        ShowMainWindow(show_another_window);
 
         // Rendering
 
+        uint64_t render_start = FlightRecorder_Now();
         ImGui::Render();
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
         glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            GpuZone gpu_zone(&g_gpu_timer, "Clear");
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        {
+            GpuZone gpu_zone(&g_gpu_timer, "RenderDrawData");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        FlightRecorder_Zone("Render", render_start, FlightRecorder_Now());
 
+        uint64_t swap_start = FlightRecorder_Now();
         glfwSwapBuffers(window);
+        FlightRecorder_Zone("SwapBuffers", swap_start, FlightRecorder_Now());
+
+        // tear-off viewers, opened after the frame so no ImGui frame is in progress
+        RenderViewerWindows(window, clear_color);
+        if (g_open_viewer_window) {
+            g_open_viewer_window = false;
+            OpenViewerWindow(window);
+        }
     }
 
     // Cleanup
 
+    if (!g_session_path.empty()) {
+        SaveSession(window);
+    }
+    for (ViewerWindow& viewer_window : g_viewer_windows) {
+        CloseViewerWindow(viewer_window);
+    }
+    g_viewer_windows.clear();
+    glfwMakeContextCurrent(window);
+    g_main_viewer.reset();
+    g_texture_cache.Clear();
+    g_texture_loader.Stop();
+    g_panel_layer.Release();
+    g_color_manager.Release();
+    g_gpu_timer.Release();
+    // Everything the app created is deleted by now, what is left leaked
+    GLResource_ReportLeaks();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -365,7 +1441,10 @@ int main(int, char**) {
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    if (write_telemetry_on_exit && !g_file_telemetry.WriteCSV(g_telemetry_csv_path)) {
+        LOG_ERROR("telemetry", "Failed to write file telemetry: %s", g_telemetry_csv_path.c_str());
+    }
+    return exit_code;
 }
 
 // ---------------------------------------------
@@ -377,7 +1456,7 @@ void setup_fonts(ImGuiIO& io) {
     if (std::filesystem::exists(font_path)) {
         io.Fonts->AddFontFromFileTTF(font_path.string().c_str(), 14.0f);
     } else {
-        std::cerr << "Font file not found: " << font_path << std::endl;
+        LOG_WARNING("app", "Font file not found: %s", font_path.string().c_str());
     }
 }
 
@@ -394,10 +1473,10 @@ void setup_logo(GLFWwindow* window) {
             glfwSetWindowIcon(window, 1, images);
             stbi_image_free(logo_pixels);
         } else {
-            std::cerr << "Failed to load logo image: " << logo_path << std::endl;
+            LOG_WARNING("app", "Failed to load logo image: %s", logo_path.string().c_str());
         }
     } else {
-        std::cerr << "Logo file not found: " << logo_path << std::endl;
+        LOG_WARNING("app", "Logo file not found: %s", logo_path.string().c_str());
     }
 }
 
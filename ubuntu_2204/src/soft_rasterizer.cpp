@@ -0,0 +1,518 @@
+#include "soft_rasterizer.h"
+#include "qoi_codec.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Triangle setup
+
+// ImGui only draws 2D geometry, so every attribute is an affine plane: value = dx * x + dy * y + c
+struct Plane {
+    float dx, dy, c;
+};
+
+struct SoftRasterizer::Triangle {
+    // Edge functions E(x, y) = a * x + b * y + c, all >= 0 inside (winding is normalized at setup)
+    float edge_a[3], edge_b[3], edge_c[3];
+    bool edge_top_left[3];
+
+    // Vertex color planes in 0..255, pre-multiplied by the texel when the UVs are constant
+    Plane r, g, b, a;
+    Plane u, v;
+
+    // Pixel bounds already intersected with the scissor rect, max is exclusive
+    int min_x, min_y, max_x, max_y;
+
+    // nullptr when the texture was folded into the color planes
+    const SoftRasterizer::Texture* texture;
+};
+
+void SoftFramebuffer::Resize(int w, int h) {
+    width = w;
+    height = h;
+    stride = (w + 3) & ~3;
+    pixels.resize((size_t)stride * h);
+}
+
+bool SoftFramebuffer::WritePPM(const char* path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = 0; y < height; y++) {
+        const ImU32* src = &pixels[(size_t)y * stride];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = (unsigned char)(src[x] >> IM_COL32_R_SHIFT);
+            row[x * 3 + 1] = (unsigned char)(src[x] >> IM_COL32_G_SHIFT);
+            row[x * 3 + 2] = (unsigned char)(src[x] >> IM_COL32_B_SHIFT);
+        }
+        file.write((const char*)row.data(), (std::streamsize)row.size());
+    }
+    return (bool)file;
+}
+
+bool SoftFramebuffer::WriteQOI(const char* path) const {
+    std::vector<unsigned char> rgba((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        const ImU32* src = &pixels[(size_t)y * stride];
+        unsigned char* dst = &rgba[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++) {
+            dst[x * 4 + 0] = (unsigned char)(src[x] >> IM_COL32_R_SHIFT);
+            dst[x * 4 + 1] = (unsigned char)(src[x] >> IM_COL32_G_SHIFT);
+            dst[x * 4 + 2] = (unsigned char)(src[x] >> IM_COL32_B_SHIFT);
+            dst[x * 4 + 3] = (unsigned char)(src[x] >> IM_COL32_A_SHIFT);
+        }
+    }
+    return QOI_WriteFile(path, rgba.data(), width, height);
+}
+
+// Scales by the reciprocal like the SSE2 path (a division rounds differently), so both give the same bytes
+static constexpr float INV_255 = 1.0f / 255.0f;
+
+static inline ImU32 SampleTexture(const SoftRasterizer::Texture* tex, float u, float v) {
+    int x = (int)(u * tex->width);
+    int y = (int)(v * tex->height);
+    x = x < 0 ? 0 : (x >= tex->width ? tex->width - 1 : x);
+    y = y < 0 ? 0 : (y >= tex->height ? tex->height - 1 : y);
+    if (tex->bytes_per_pixel == 1) {
+        return IM_COL32(255, 255, 255, tex->pixels[(size_t)y * tex->width + x]);
+    }
+    ImU32 texel;
+    memcpy(&texel, tex->pixels + ((size_t)y * tex->width + x) * 4, 4);
+    return texel;
+}
+
+static inline Plane MakePlane(float a0, float a1, float a2, const float ea[3], const float eb[3], const ImVec2& p0, float inv_area) {
+    // Barycentric weights are E12 / area, E20 / area, E01 / area for vertices 0, 1, 2
+    Plane plane;
+    plane.dx = (a0 * ea[1] + a1 * ea[2] + a2 * ea[0]) * inv_area;
+    plane.dy = (a0 * eb[1] + a1 * eb[2] + a2 * eb[0]) * inv_area;
+    plane.c = a0 - plane.dx * p0.x - plane.dy * p0.y;
+    return plane;
+}
+
+static inline void ScalePlane(Plane& plane, float scale) {
+    plane.dx *= scale;
+    plane.dy *= scale;
+    plane.c *= scale;
+}
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Construction and textures
+
+SoftRasterizer::SoftRasterizer(int thread_count) {
+    // A pool of 0 would mean one worker per hardware thread, so a single thread renders inline
+    if (thread_count != 1) pool.reset(new ThreadPool(thread_count > 0 ? (size_t)thread_count - 1 : 0));
+}
+
+SoftRasterizer::~SoftRasterizer() = default;
+
+int SoftRasterizer::ThreadCount() const {
+    // ParallelFor also runs work on the calling thread
+    return pool ? (int)pool->Size() + 1 : 1;
+}
+
+ImTextureID SoftRasterizer::CreateTexture(const unsigned char* rgba, int width, int height) {
+    // The texture's own address is its id, unique for as long as it is alive
+    std::unique_ptr<Texture> tex(new Texture());
+    ImTextureID id = (ImTextureID)(intptr_t)tex.get();
+    {
+        std::lock_guard<std::mutex> lock(textures_mutex);
+        textures[id] = std::move(tex);
+    }
+    AliasTexture(id, rgba, width, height);
+    return id;
+}
+
+void SoftRasterizer::AliasTexture(ImTextureID id, const unsigned char* rgba, int width, int height) {
+    std::lock_guard<std::mutex> lock(textures_mutex);
+    std::unique_ptr<Texture>& tex = textures[id];
+    if (!tex) tex.reset(new Texture());
+    tex->storage.assign(rgba, rgba + (size_t)width * height * 4);
+    tex->pixels = tex->storage.data();
+    tex->width = width;
+    tex->height = height;
+    tex->bytes_per_pixel = 4;
+}
+
+void SoftRasterizer::DestroyTexture(ImTextureID id) {
+    std::lock_guard<std::mutex> lock(textures_mutex);
+    textures.erase(id);
+}
+
+void SoftRasterizer::UpdateTextures(ImDrawData* draw_data) {
+#if IMGUI_VERSION_NUM >= 19200
+    // Pixels stay owned by ImGui and are sampled in place, so creation and updates only need acknowledging
+    if (draw_data == nullptr || draw_data->Textures == nullptr) return;
+    for (ImTextureData* tex : *draw_data->Textures) {
+        if (tex->Status == ImTextureStatus_WantCreate) {
+            tex->SetTexID((ImTextureID)(intptr_t)tex);
+            tex->SetStatus(ImTextureStatus_OK);
+        } else if (tex->Status == ImTextureStatus_WantUpdates) {
+            tex->SetStatus(ImTextureStatus_OK);
+        } else if (tex->Status == ImTextureStatus_WantDestroy && tex->UnusedFrames > 0) {
+            tex->SetTexID(ImTextureID_Invalid);
+            tex->SetStatus(ImTextureStatus_Destroyed);
+        }
+    }
+#else
+    (void)draw_data;
+    ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+    if (atlas->TexID == (ImTextureID)0) {
+        unsigned char* pixels;
+        int width, height;
+        atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+        atlas->SetTexID(CreateTexture(pixels, width, height));
+    }
+#endif
+}
+
+const SoftRasterizer::Texture* SoftRasterizer::ResolveTexture(const ImDrawCmd* cmd) {
+#if IMGUI_VERSION_NUM >= 19200
+    if (ImTextureData* tex_data = cmd->TexRef._TexData) {
+        frame_textures.emplace_back();
+        Texture& view = frame_textures.back();
+        view.pixels = tex_data->GetPixels();
+        view.width = tex_data->Width;
+        view.height = tex_data->Height;
+        view.bytes_per_pixel = tex_data->Format == ImTextureFormat_Alpha8 ? 1 : 4;
+        return view.pixels ? &view : nullptr;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(textures_mutex);
+    auto it = textures.find(cmd->GetTexID());
+    return it != textures.end() ? it->second.get() : nullptr;
+}
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Frame
+
+void SoftRasterizer::Render(ImDrawData* draw_data, SoftFramebuffer& target, const ImVec4& clear_color) {
+    int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+    int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+    if (fb_width <= 0 || fb_height <= 0) return;
+    target.Resize(fb_width, fb_height);
+
+    ImU32 clear_pixel = IM_COL32(
+        (int)(clear_color.x * clear_color.w * 255.0f + 0.5f),
+        (int)(clear_color.y * clear_color.w * 255.0f + 0.5f),
+        (int)(clear_color.z * clear_color.w * 255.0f + 0.5f),
+        (int)(clear_color.w * 255.0f + 0.5f));
+
+    tiles_x = (target.stride + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (fb_height + TILE_SIZE - 1) / TILE_SIZE;
+    tile_bins.resize((size_t)tiles_x * tiles_y);
+    for (auto& bin : tile_bins) bin.clear();
+    triangles.clear();
+    frame_textures.clear();
+
+    // Setup and binning stay serial so every tile sees triangles in submission order
+    for (const ImDrawList* draw_list : draw_data->CmdLists) {
+        SetupDrawList(draw_list, draw_data, fb_width, fb_height);
+    }
+
+    last_triangle_count = (int)triangles.size();
+    last_tile_count = tiles_x * tiles_y;
+
+    if (!pool) {
+        for (int tile_index = 0; tile_index < tiles_x * tiles_y; tile_index++) {
+            RasterizeTile(tile_index, target, clear_pixel);
+        }
+        return;
+    }
+    pool->ParallelFor(tiles_x * tiles_y, [&](int tile_index) {
+        RasterizeTile(tile_index, target, clear_pixel);
+    });
+}
+
+void SoftRasterizer::SetupDrawList(const ImDrawList* draw_list, const ImDrawData* draw_data, int fb_width, int fb_height) {
+    const ImVec2 clip_off = draw_data->DisplayPos;
+    const ImVec2 clip_scale = draw_data->FramebufferScale;
+    const ImDrawVert* vtx_buffer = draw_list->VtxBuffer.Data;
+    const ImDrawIdx* idx_buffer = draw_list->IdxBuffer.Data;
+
+    for (const ImDrawCmd& cmd : draw_list->CmdBuffer) {
+        if (cmd.UserCallback != nullptr) {
+            if (cmd.UserCallback != ImDrawCallback_ResetRenderState) {
+                cmd.UserCallback(draw_list, &cmd);
+            }
+            continue;
+        }
+
+        int clip_min_x = std::max(0, (int)((cmd.ClipRect.x - clip_off.x) * clip_scale.x));
+        int clip_min_y = std::max(0, (int)((cmd.ClipRect.y - clip_off.y) * clip_scale.y));
+        int clip_max_x = std::min(fb_width, (int)((cmd.ClipRect.z - clip_off.x) * clip_scale.x));
+        int clip_max_y = std::min(fb_height, (int)((cmd.ClipRect.w - clip_off.y) * clip_scale.y));
+        if (clip_max_x <= clip_min_x || clip_max_y <= clip_min_y) continue;
+
+        const Texture* texture = ResolveTexture(&cmd);
+
+        for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3) {
+            const ImDrawVert* v[3] = {
+                &vtx_buffer[cmd.VtxOffset + idx_buffer[cmd.IdxOffset + i + 0]],
+                &vtx_buffer[cmd.VtxOffset + idx_buffer[cmd.IdxOffset + i + 1]],
+                &vtx_buffer[cmd.VtxOffset + idx_buffer[cmd.IdxOffset + i + 2]],
+            };
+            ImVec2 p[3];
+            for (int k = 0; k < 3; k++) {
+                p[k] = ImVec2((v[k]->pos.x - clip_off.x) * clip_scale.x, (v[k]->pos.y - clip_off.y) * clip_scale.y);
+            }
+
+            // Normalize winding so the area is positive, zero area contributes no pixels
+            float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+            if (area == 0.0f || std::isnan(area)) continue;
+            if (area < 0.0f) {
+                std::swap(v[1], v[2]);
+                std::swap(p[1], p[2]);
+                area = -area;
+            }
+
+            Triangle tri;
+            tri.min_x = std::max(clip_min_x, (int)std::floor(std::min({ p[0].x, p[1].x, p[2].x })));
+            tri.min_y = std::max(clip_min_y, (int)std::floor(std::min({ p[0].y, p[1].y, p[2].y })));
+            tri.max_x = std::min(clip_max_x, (int)std::ceil(std::max({ p[0].x, p[1].x, p[2].x })));
+            tri.max_y = std::min(clip_max_y, (int)std::ceil(std::max({ p[0].y, p[1].y, p[2].y })));
+            if (tri.max_x <= tri.min_x || tri.max_y <= tri.min_y) continue;
+
+            // Edge k runs from vertex k to vertex k + 1. Reversed shared edges negate exactly, and the
+            // top-left rule picks a single owner for pixel centers that fall on them.
+            for (int k = 0; k < 3; k++) {
+                const ImVec2& from = p[k];
+                const ImVec2& to = p[(k + 1) % 3];
+                tri.edge_a[k] = from.y - to.y;
+                tri.edge_b[k] = to.x - from.x;
+                tri.edge_c[k] = from.x * to.y - from.y * to.x;
+                tri.edge_top_left[k] = tri.edge_a[k] > 0.0f || (tri.edge_a[k] == 0.0f && tri.edge_b[k] > 0.0f);
+            }
+
+            const float inv_area = 1.0f / area;
+            auto channel = [&](int k, int shift) { return (float)((v[k]->col >> shift) & 0xFF); };
+            tri.r = MakePlane(channel(0, IM_COL32_R_SHIFT), channel(1, IM_COL32_R_SHIFT), channel(2, IM_COL32_R_SHIFT), tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.g = MakePlane(channel(0, IM_COL32_G_SHIFT), channel(1, IM_COL32_G_SHIFT), channel(2, IM_COL32_G_SHIFT), tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.b = MakePlane(channel(0, IM_COL32_B_SHIFT), channel(1, IM_COL32_B_SHIFT), channel(2, IM_COL32_B_SHIFT), tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.a = MakePlane(channel(0, IM_COL32_A_SHIFT), channel(1, IM_COL32_A_SHIFT), channel(2, IM_COL32_A_SHIFT), tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.u = MakePlane(v[0]->uv.x, v[1]->uv.x, v[2]->uv.x, tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.v = MakePlane(v[0]->uv.y, v[1]->uv.y, v[2]->uv.y, tri.edge_a, tri.edge_b, p[0], inv_area);
+            tri.texture = texture;
+
+            // Most ImGui geometry samples the atlas white pixel with constant UVs, fold that texel into the colors
+            bool constant_uv = v[0]->uv.x == v[1]->uv.x && v[0]->uv.x == v[2]->uv.x &&
+                               v[0]->uv.y == v[1]->uv.y && v[0]->uv.y == v[2]->uv.y;
+            if (texture == nullptr || constant_uv) {
+                ImU32 texel = texture ? SampleTexture(texture, v[0]->uv.x, v[0]->uv.y) : IM_COL32_WHITE;
+                ScalePlane(tri.r, ((texel >> IM_COL32_R_SHIFT) & 0xFF) * INV_255);
+                ScalePlane(tri.g, ((texel >> IM_COL32_G_SHIFT) & 0xFF) * INV_255);
+                ScalePlane(tri.b, ((texel >> IM_COL32_B_SHIFT) & 0xFF) * INV_255);
+                ScalePlane(tri.a, ((texel >> IM_COL32_A_SHIFT) & 0xFF) * INV_255);
+                tri.texture = nullptr;
+            }
+
+            unsigned int tri_index = (unsigned int)triangles.size();
+            triangles.push_back(tri);
+            for (int ty = tri.min_y / TILE_SIZE; ty <= (tri.max_y - 1) / TILE_SIZE; ty++) {
+                for (int tx = tri.min_x / TILE_SIZE; tx <= (tri.max_x - 1) / TILE_SIZE; tx++) {
+                    tile_bins[(size_t)ty * tiles_x + tx].push_back(tri_index);
+                }
+            }
+        }
+    }
+}
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Per-tile rasterization
+
+static inline bool Inside(float w, bool top_left) {
+    return w > 0.0f || (w == 0.0f && top_left);
+}
+
+static inline float Clamp255(float x) {
+    return x < 0.0f ? 0.0f : (x > 255.0f ? 255.0f : x);
+}
+
+static inline ImU32 ShadePixel(const SoftRasterizer::Triangle& tri, float px, float py, ImU32 dst) {
+    float sr = tri.r.dx * px + (tri.r.dy * py + tri.r.c);
+    float sg = tri.g.dx * px + (tri.g.dy * py + tri.g.c);
+    float sb = tri.b.dx * px + (tri.b.dy * py + tri.b.c);
+    float sa = tri.a.dx * px + (tri.a.dy * py + tri.a.c);
+    if (tri.texture) {
+        float u = tri.u.dx * px + (tri.u.dy * py + tri.u.c);
+        float v = tri.v.dx * px + (tri.v.dy * py + tri.v.c);
+        ImU32 texel = SampleTexture(tri.texture, u, v);
+        sr *= ((texel >> IM_COL32_R_SHIFT) & 0xFF) * INV_255;
+        sg *= ((texel >> IM_COL32_G_SHIFT) & 0xFF) * INV_255;
+        sb *= ((texel >> IM_COL32_B_SHIFT) & 0xFF) * INV_255;
+        sa *= ((texel >> IM_COL32_A_SHIFT) & 0xFF) * INV_255;
+    }
+    sr = Clamp255(sr); sg = Clamp255(sg); sb = Clamp255(sb); sa = Clamp255(sa);
+
+    // Same blend as the GL backend: src alpha over for color, one / one-minus-src-alpha for alpha
+    float k = sa * INV_255;
+    float inv = 1.0f - k;
+    float dr = (float)((dst >> IM_COL32_R_SHIFT) & 0xFF);
+    float dg = (float)((dst >> IM_COL32_G_SHIFT) & 0xFF);
+    float db = (float)((dst >> IM_COL32_B_SHIFT) & 0xFF);
+    float da = (float)((dst >> IM_COL32_A_SHIFT) & 0xFF);
+    return IM_COL32(
+        (int)(sr * k + dr * inv + 0.5f),
+        (int)(sg * k + dg * inv + 0.5f),
+        (int)(sb * k + db * inv + 0.5f),
+        (int)(sa + da * inv + 0.5f));
+}
+
+#if defined(SOFT_RASTER_SSE2)
+
+static inline __m128 EvalPlane(const Plane& plane, __m128 px, float py) {
+    return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.dx), px), _mm_set1_ps(plane.dy * py + plane.c));
+}
+
+static inline __m128 InsideMask(__m128 w, bool top_left) {
+    __m128 zero = _mm_setzero_ps();
+    __m128 mask = _mm_cmpgt_ps(w, zero);
+    if (top_left) mask = _mm_or_ps(mask, _mm_cmpeq_ps(w, zero));
+    return mask;
+}
+
+static inline __m128 Channel(__m128i pixels, int shift) {
+    return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xFF)));
+}
+
+// Shades and blends four horizontally adjacent pixels, lanes outside `mask` keep the destination value
+static inline void ShadeQuad(const SoftRasterizer::Triangle& tri, __m128 px, float py, __m128 mask, ImU32* dst_ptr) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 c255 = _mm_set1_ps(255.0f);
+    const __m128 inv255 = _mm_set1_ps(INV_255);
+
+    __m128 sr = EvalPlane(tri.r, px, py);
+    __m128 sg = EvalPlane(tri.g, px, py);
+    __m128 sb = EvalPlane(tri.b, px, py);
+    __m128 sa = EvalPlane(tri.a, px, py);
+
+    if (tri.texture) {
+        alignas(16) float u[4], v[4];
+        alignas(16) ImU32 texels[4];
+        _mm_store_ps(u, EvalPlane(tri.u, px, py));
+        _mm_store_ps(v, EvalPlane(tri.v, px, py));
+        int lanes = _mm_movemask_ps(mask);
+        for (int i = 0; i < 4; i++) {
+            texels[i] = (lanes & (1 << i)) ? SampleTexture(tri.texture, u[i], v[i]) : 0;
+        }
+        __m128i t = _mm_load_si128((const __m128i*)texels);
+        sr = _mm_mul_ps(sr, _mm_mul_ps(Channel(t, IM_COL32_R_SHIFT), inv255));
+        sg = _mm_mul_ps(sg, _mm_mul_ps(Channel(t, IM_COL32_G_SHIFT), inv255));
+        sb = _mm_mul_ps(sb, _mm_mul_ps(Channel(t, IM_COL32_B_SHIFT), inv255));
+        sa = _mm_mul_ps(sa, _mm_mul_ps(Channel(t, IM_COL32_A_SHIFT), inv255));
+    }
+    sr = _mm_min_ps(_mm_max_ps(sr, zero), c255);
+    sg = _mm_min_ps(_mm_max_ps(sg, zero), c255);
+    sb = _mm_min_ps(_mm_max_ps(sb, zero), c255);
+    sa = _mm_min_ps(_mm_max_ps(sa, zero), c255);
+
+    __m128i dst = _mm_loadu_si128((const __m128i*)dst_ptr);
+    __m128 k = _mm_mul_ps(sa, inv255);
+    __m128 inv = _mm_sub_ps(_mm_set1_ps(1.0f), k);
+    __m128 out_r = _mm_add_ps(_mm_mul_ps(sr, k), _mm_mul_ps(Channel(dst, IM_COL32_R_SHIFT), inv));
+    __m128 out_g = _mm_add_ps(_mm_mul_ps(sg, k), _mm_mul_ps(Channel(dst, IM_COL32_G_SHIFT), inv));
+    __m128 out_b = _mm_add_ps(_mm_mul_ps(sb, k), _mm_mul_ps(Channel(dst, IM_COL32_B_SHIFT), inv));
+    __m128 out_a = _mm_add_ps(sa, _mm_mul_ps(Channel(dst, IM_COL32_A_SHIFT), inv));
+
+    // Rounded like the scalar path, (int)(x + 0.5f)
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i packed = _mm_or_si128(
+        _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(out_r, half)), IM_COL32_R_SHIFT),
+                     _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(out_g, half)), IM_COL32_G_SHIFT)),
+        _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(out_b, half)), IM_COL32_B_SHIFT),
+                     _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(out_a, half)), IM_COL32_A_SHIFT)));
+    __m128i imask = _mm_castps_si128(mask);
+    __m128i result = _mm_or_si128(_mm_and_si128(imask, packed), _mm_andnot_si128(imask, dst));
+    _mm_storeu_si128((__m128i*)dst_ptr, result);
+}
+
+// Pixels of tri inside [x0, x1) x [y0, y1), four at a time
+static void RasterizeSpansSSE2(const SoftRasterizer::Triangle& tri, int x0, int y0, int x1, int y1, SoftFramebuffer& target) {
+    // Quads start on a 4-pixel boundary so a store never crosses into another tile
+    const int quad_x0 = x0 & ~3;
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128i lane_index = _mm_setr_epi32(0, 1, 2, 3);
+    for (int y = y0; y < y1; y++) {
+        const float py = (float)y + 0.5f;
+        const float row_c[3] = {
+            tri.edge_b[0] * py + tri.edge_c[0],
+            tri.edge_b[1] * py + tri.edge_c[1],
+            tri.edge_b[2] * py + tri.edge_c[2],
+        };
+        ImU32* row = &target.pixels[(size_t)y * target.stride];
+        for (int x = quad_x0; x < x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+            __m128 mask = InsideMask(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edge_a[0]), px), _mm_set1_ps(row_c[0])), tri.edge_top_left[0]);
+            mask = _mm_and_ps(mask, InsideMask(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edge_a[1]), px), _mm_set1_ps(row_c[1])), tri.edge_top_left[1]));
+            mask = _mm_and_ps(mask, InsideMask(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edge_a[2]), px), _mm_set1_ps(row_c[2])), tri.edge_top_left[2]));
+
+            // Lanes left of x0 or right of x1 belong to the scissor or the next triangle bounds
+            __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lane_index);
+            __m128i in_span = _mm_and_si128(
+                _mm_cmpgt_epi32(xs, _mm_set1_epi32(x0 - 1)),
+                _mm_cmplt_epi32(xs, _mm_set1_epi32(x1)));
+            mask = _mm_and_ps(mask, _mm_castsi128_ps(in_span));
+            if (_mm_movemask_ps(mask) == 0) continue;
+
+            ShadeQuad(tri, px, py, mask, &row[x]);
+        }
+    }
+}
+
+#endif
+
+void SoftRasterizer::RasterizeTile(int tile_index, SoftFramebuffer& target, ImU32 clear_pixel) {
+    const int tile_x0 = (tile_index % tiles_x) * TILE_SIZE;
+    const int tile_y0 = (tile_index / tiles_x) * TILE_SIZE;
+    const int tile_x1 = std::min(tile_x0 + TILE_SIZE, target.stride);
+    const int tile_y1 = std::min(tile_y0 + TILE_SIZE, target.height);
+
+    for (int y = tile_y0; y < tile_y1; y++) {
+        std::fill_n(&target.pixels[(size_t)y * target.stride + tile_x0], tile_x1 - tile_x0, clear_pixel);
+    }
+
+    for (unsigned int tri_index : tile_bins[tile_index]) {
+        const Triangle& tri = triangles[tri_index];
+        const int x0 = std::max(tri.min_x, tile_x0);
+        const int y0 = std::max(tri.min_y, tile_y0);
+        const int x1 = std::min(tri.max_x, tile_x1);
+        const int y1 = std::min(tri.max_y, tile_y1);
+
+#if defined(SOFT_RASTER_SSE2)
+        if (simd) {
+            RasterizeSpansSSE2(tri, x0, y0, x1, y1, target);
+            continue;
+        }
+#endif
+        for (int y = y0; y < y1; y++) {
+            const float py = (float)y + 0.5f;
+            ImU32* row = &target.pixels[(size_t)y * target.stride];
+            for (int x = x0; x < x1; x++) {
+                const float px = (float)x + 0.5f;
+                if (!Inside(tri.edge_a[0] * px + (tri.edge_b[0] * py + tri.edge_c[0]), tri.edge_top_left[0])) continue;
+                if (!Inside(tri.edge_a[1] * px + (tri.edge_b[1] * py + tri.edge_c[1]), tri.edge_top_left[1])) continue;
+                if (!Inside(tri.edge_a[2] * px + (tri.edge_b[2] * py + tri.edge_c[2]), tri.edge_top_left[2])) continue;
+                row[x] = ShadePixel(tri, px, py, row[x]);
+            }
+        }
+    }
+}
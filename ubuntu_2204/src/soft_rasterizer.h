@@ -0,0 +1,88 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    CPU renderer for ImDrawData
+    Tiled, multi-threaded, SSE2 when available, no GL needed
+*/
+
+#pragma once
+
+#include "imgui.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+
+// RGBA8 target, one ImU32 per pixel in IM_COL32 byte order. Stride is padded to 4 pixels for the SIMD path.
+struct SoftFramebuffer {
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    std::vector<ImU32> pixels;
+
+    void Resize(int w, int h);
+    bool WritePPM(const char* path) const;
+    bool WriteQOI(const char* path) const;      // lossless with alpha, much faster to write than PNG
+};
+
+
+class SoftRasterizer {
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    // thread_count == 0 uses every hardware thread
+    explicit SoftRasterizer(int thread_count = 0);
+    ~SoftRasterizer();
+
+    // Only needed when this is the active ImGui renderer (headless mode), handles the font atlas lifecycle.
+    // Accepts nullptr before the first frame so older ImGui versions get their atlas texture.
+    void UpdateTextures(ImDrawData* draw_data);
+
+    // Rasterize a whole frame into target, resizing it to the display size first
+    void Render(ImDrawData* draw_data, SoftFramebuffer& target, const ImVec4& clear_color);
+
+    // User textures, pixels are copied. AliasTexture binds pixels to an id owned by another renderer (benchmarks)
+    ImTextureID CreateTexture(const unsigned char* rgba, int width, int height);
+    void AliasTexture(ImTextureID id, const unsigned char* rgba, int width, int height);
+    void DestroyTexture(ImTextureID id);
+
+    int ThreadCount() const;
+
+    // Work done by the last Render() call
+    int last_triangle_count = 0;
+    int last_tile_count = 0;
+
+    // SSE2 spans where compiled in, false runs the scalar path (tests compare the two)
+    bool simd = true;
+
+    struct Texture {
+        const unsigned char* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        int bytes_per_pixel = 4;
+        std::vector<unsigned char> storage;
+    };
+
+    struct Triangle;
+
+private:
+    const Texture* ResolveTexture(const ImDrawCmd* cmd);
+    void SetupDrawList(const ImDrawList* draw_list, const ImDrawData* draw_data, int fb_width, int fb_height);
+    void RasterizeTile(int tile_index, SoftFramebuffer& target, ImU32 clear_pixel);
+
+    std::unique_ptr<ThreadPool> pool;
+    std::mutex textures_mutex;
+    std::unordered_map<ImTextureID, std::unique_ptr<Texture>> textures;
+
+    // Per-frame scratch, kept between frames to avoid reallocating
+    std::vector<Triangle> triangles;
+    std::deque<Texture> frame_textures;
+    std::vector<std::vector<unsigned int>> tile_bins;
+    int tiles_x = 0;
+    int tiles_y = 0;
+};
@@ -0,0 +1,416 @@
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "content_index.h"
+#include "decoded_cache.h"
+#include "file_telemetry.h"
+#include "flight_recorder.h"
+#include "gif_animation.h"
+#include "image_files.h"
+#include "logger.h"
+#include "preview_store.h"
+#include "image_ops.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+
+static MetricHistogram& g_upload_seconds = Metrics_Histogram("image_upload_seconds", "Time to upload a full resolution image texture.", Metrics_TimeBuckets());
+
+
+void TextureCache::Acquire(const std::string& path) {
+    // Without the loader the file is read here anyway, hashing it first costs little more
+    auto [acquired_it, first] = acquired.try_emplace(path);
+    if (first) acquired_it->second.key = KeyFor(path, !loader.Running());
+    acquired_it->second.refs++;
+    const std::string& key = acquired_it->second.key;
+
+    CachedTexture& entry = entries[key];
+    if (entry.refs++ > 0) {
+        shared_hits++;
+        if (first && entry.path != path) content_shared++;
+        return;
+    }
+
+    entry.path = path;
+    decodes++;
+    if (loader.Running()) {
+        loader.Request(path);
+        return;
+    }
+
+    TRACE_ZONE("Synchronous load");
+    if (std::shared_ptr<const DecodedImage> image = decoded.Load(path)) {
+        entry.width = image->width;
+        entry.height = image->height;
+        entry.icc = image->icc;
+        auto upload_start = std::chrono::steady_clock::now();
+        entry.texture = create_texture(image->pixels, entry.width, entry.height, path);
+        double upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count();
+        g_upload_seconds.Observe(upload_ms / 1000.0);
+        if (decoded.telemetry) {
+            decoded.telemetry->RecordUpload(path, upload_ms);
+        }
+
+        int thumbnail_width, thumbnail_height;
+        FitInside(entry.width, entry.height, THUMBNAIL_SIZE, thumbnail_width, thumbnail_height);
+        std::vector<unsigned char> thumbnail_pixels((size_t)thumbnail_width * thumbnail_height * 4);
+        DownscaleBox(image->pixels, entry.width, entry.height, thumbnail_pixels.data(), thumbnail_width, thumbnail_height);
+        missing_previews.erase(path);
+        AddThumbnail(key, create_texture(thumbnail_pixels.data(), thumbnail_width, thumbnail_height, path),
+                     thumbnail_width, thumbnail_height, entry.width, entry.height);
+        if (previews) {
+            previews->Save(path, thumbnail_pixels.data(), thumbnail_width, thumbnail_height);
+        }
+    }
+    entry.loaded = true;
+    LoadAnimation(entry);
+}
+
+void TextureCache::Prefetch(const std::vector<std::string>& paths) {
+    if (loader.Running()) loader.Prefetch(paths);
+}
+
+void TextureCache::Release(const std::string& path) {
+    auto acquired_it = acquired.find(path);
+    if (acquired_it == acquired.end()) return;
+    auto it = entries.find(acquired_it->second.key);
+    if (--acquired_it->second.refs == 0) acquired.erase(acquired_it);
+    if (it == entries.end() || --it->second.refs > 0) return;
+
+    Free(it->second);
+    entries.erase(it);
+}
+
+const CachedTexture* TextureCache::Find(const std::string& path) const {
+    auto acquired_it = acquired.find(path);
+    if (acquired_it == acquired.end()) return nullptr;
+    auto it = entries.find(acquired_it->second.key);
+    return it != entries.end() && it->second.loaded ? &it->second : nullptr;
+}
+
+void TextureCache::Poll() {
+    if (!loader.Running()) return;
+    TRACE_ZONE("TextureCache::Poll");
+
+    loader.Poll();
+    RekeyHashed();
+    for (auto& [key, entry] : entries) {
+        LoadedAnimation animation;
+        if (entry.animation_pending && loader.TakeAnimation(entry.path, animation)) {
+            entry.animation_pending = false;
+            for (GLuint frame : animation.frames) {
+                entry.frames.push_back((ImTextureID)(intptr_t)frame);
+            }
+            entry.frame_delays = std::move(animation.delays_ms);
+            entry.streamed = animation.streamed;
+        }
+
+        LoadedTexture loaded;
+        if (entry.loaded || !loader.Take(entry.path, loaded)) continue;
+        entry.texture = loaded.texture ? (ImTextureID)(intptr_t)loaded.texture : 0;
+        entry.width = loaded.width;
+        entry.height = loaded.height;
+        entry.icc = std::move(loaded.icc);
+        entry.loaded = true;
+        LoadAnimation(entry);
+        if (loaded.thumbnail) {
+            missing_previews.erase(entry.path);
+            AddThumbnail(key, (ImTextureID)(intptr_t)loaded.thumbnail, loaded.thumbnail_width, loaded.thumbnail_height,
+                         loaded.width, loaded.height);
+        }
+    }
+
+    std::vector<LoadedPreview> previews_read;
+    loader.TakePreviews(previews_read);
+    for (const LoadedPreview& preview : previews_read) {
+        if (preview.max_side == PREVIEW_SIZE) {
+            pending_midres.erase(preview.path);
+            if (preview.texture) {
+                AddPreview(preview.path, (ImTextureID)(intptr_t)preview.texture, preview.width, preview.height);
+            } else {
+                missing_midres.insert(preview.path);
+            }
+            continue;
+        }
+        pending_thumbnails.erase(preview.path);
+        if (!preview.texture) {
+            missing_previews.insert(preview.path);
+            continue;
+        }
+        AddStoredThumbnail(preview.path, (ImTextureID)(intptr_t)preview.texture, preview.width, preview.height,
+                           preview.full_width, preview.full_height, preview.from_exif);
+    }
+}
+
+void TextureCache::Animate(double delta_time) {
+    TRACE_ZONE("TextureCache::Animate");
+    for (auto& [key, entry] : entries) {
+        if (!entry.streamed) continue;
+        if (!entry.stream_texture) {
+            entry.stream_texture = StreamFrame(entry, 0);
+            continue;
+        }
+
+        // Same clock as ImageViewer::AnimationTexture, except that a frame only shows once it is
+        // decoded: skipping ahead means decoding every frame in between anyway
+        const std::vector<int>& delays = entry.frame_delays;
+        double lag_limit = delays[entry.stream_frame] / 1000.0 + 0.25;
+        entry.stream_time = std::min(entry.stream_time + delta_time, lag_limit);
+        int steps = 0;
+        for (double delay; entry.stream_time >= (delay = delays[entry.stream_frame] / 1000.0); steps++) {
+            int next = (entry.stream_frame + 1) % (int)delays.size();
+            ImTextureID texture = StreamFrame(entry, next);
+            if (!texture) {
+                if (!entry.stream_waiting) animation_stats.stream_stalls++;
+                entry.stream_waiting = true;
+                break;
+            }
+            entry.stream_waiting = false;
+            entry.stream_time -= delay;
+            entry.stream_frame = next;
+            entry.stream_texture = texture;
+        }
+        if (steps > 1) animation_stats.dropped_frames += steps - 1;
+    }
+}
+
+ImTextureID TextureCache::StreamFrame(CachedTexture& entry, int frame) {
+    if (loader.Running()) {
+        GLuint texture = loader.StreamFrame(entry.path, frame);
+        return texture ? (ImTextureID)(intptr_t)texture : 0;
+    }
+
+    // Decoded here one frame at a time, each texture replacing the one before
+    GifDecoder* decoder = entry.stream_decoder.get();
+    if (!decoder) return 0;
+    if (!decoder->Next() || decoder->FrameIndex() != frame) {
+        LOG_ERROR("gif", "Failed to decode frame %d of %s, playback stops there", frame, entry.path.c_str());
+        entry.stream_decoder = nullptr;
+        return 0;
+    }
+    ImTextureID texture = create_texture(decoder->Canvas(), decoder->Width(), decoder->Height(), entry.path);
+    if (entry.stream_texture) destroy_texture(entry.stream_texture);
+    animation_stats.frames_streamed++;
+    return texture;
+}
+
+const CachedThumbnail* TextureCache::FindThumbnail(const std::string& path) {
+    std::string key = KeyFor(path, false);
+    if (key != path) RekeyThumbnail(path, key);
+    auto it = thumbnails.find(key);
+    if (it != thumbnails.end()) {
+        it->second.last_used = ++use_counter;
+        return &it->second;
+    }
+
+    // A previous run may have left one on disk, camera JPEGs carry one of their own in the EXIF block.
+    // Both are file reads, the loader does them while it runs.
+    if (missing_previews.count(path) || pending_thumbnails.count(path)) return nullptr;
+    if (loader.Running()) {
+        pending_thumbnails.insert(path);
+        loader.RequestPreview(path, THUMBNAIL_SIZE);
+        return nullptr;
+    }
+
+    PreviewPixels pixels;
+    if (!ReadPreview(previews, path, THUMBNAIL_SIZE, pixels)) {
+        missing_previews.insert(path);
+        return nullptr;
+    }
+    AddStoredThumbnail(path, create_texture(pixels.rgba.data(), pixels.width, pixels.height, path), pixels.width, pixels.height,
+                       pixels.full_width, pixels.full_height, pixels.from_exif);
+    it = thumbnails.find(key);
+    return it != thumbnails.end() ? &it->second : nullptr;
+}
+
+const CachedThumbnail* TextureCache::FindPreview(const std::string& path) {
+    auto it = midres.find(path);
+    if (it != midres.end()) {
+        it->second.last_used = ++use_counter;
+        return &it->second;
+    }
+    if (!previews || !previews->Enabled() || missing_midres.count(path) || pending_midres.count(path)) return nullptr;
+
+    // A 1024 px QOI file takes a few milliseconds to read and upload, the loader does it while it runs
+    if (loader.Running()) {
+        pending_midres.insert(path);
+        loader.RequestPreview(path, PREVIEW_SIZE);
+        return nullptr;
+    }
+    PreviewPixels pixels;
+    if (!ReadPreview(previews, path, PREVIEW_SIZE, pixels)) {
+        missing_midres.insert(path);
+        return nullptr;
+    }
+    AddPreview(path, create_texture(pixels.rgba.data(), pixels.width, pixels.height, path), pixels.width, pixels.height);
+    it = midres.find(path);
+    return it != midres.end() ? &it->second : nullptr;
+}
+
+void TextureCache::LoadAnimation(CachedTexture& entry) {
+    // GIF is the only animated format decoded, a file that fails to decode has nothing to animate
+    if (!entry.texture || !EndsWith(entry.path, ".gif")) return;
+    if (loader.Running()) {
+        loader.RequestAnimation(entry.path);
+        entry.animation_pending = true;
+        return;
+    }
+
+    auto decoder = std::make_shared<GifDecoder>();
+    if (!decoder->Open(entry.path)) return;
+    GifFrames frames;
+    if (Gif_LoadFrames(*decoder, loader.animation_budget, frames)) {
+        for (int i = 0; i < frames.FrameCount(); i++) {
+            entry.frames.push_back(create_texture(frames.Frame(i), frames.width, frames.height, entry.path));
+        }
+        entry.frame_delays = std::move(frames.delays_ms);
+        return;
+    }
+    if (decoder->FramesSize() <= loader.animation_budget) return;
+    entry.frame_delays = decoder->DelaysMs();
+    entry.stream_decoder = std::move(decoder);
+    entry.streamed = true;
+}
+
+void TextureCache::Free(CachedTexture& entry) {
+    if (!entry.loaded) {
+        loader.Release(entry.path);
+        return;
+    }
+    if (entry.texture) destroy_texture(entry.texture);
+    for (ImTextureID frame : entry.frames) {
+        destroy_texture(frame);
+    }
+    if (entry.animation_pending || (entry.streamed && loader.Running())) {
+        loader.ReleaseAnimation(entry.path);
+    } else if (entry.stream_texture) {
+        destroy_texture(entry.stream_texture);
+    }
+}
+
+void TextureCache::RekeyHashed() {
+    if (!content) return;
+    for (auto& [path, acquired_path] : acquired) {
+        uint64_t hash;
+        if (acquired_path.key != path || !content->Peek(path, hash)) continue;
+
+        std::string key = ContentIndex::Key(hash);
+        RekeyThumbnail(path, key);
+        auto existing = entries.find(key);
+        if (existing != entries.end()) {
+            // Another file with the same content holds the key: the path joins that entry and the
+            // duplicate is freed, keeping whichever of the two has its texture already
+            auto own = entries.find(path);
+            if (own != entries.end()) {
+                CachedTexture& kept = existing->second;
+                int refs = kept.refs + own->second.refs;
+                if (own->second.loaded && !kept.loaded) std::swap(kept, own->second);
+                kept.refs = refs;
+                Free(own->second);
+                entries.erase(own);
+                content_shared++;
+            }
+            acquired_path.key = key;
+            continue;
+        }
+        auto node = entries.extract(path);
+        if (node.empty()) continue;
+        node.key() = key;
+        entries.insert(std::move(node));
+        acquired_path.key = key;
+    }
+}
+
+void TextureCache::RekeyThumbnail(const std::string& path, const std::string& key) {
+    auto it = thumbnails.find(path);
+    if (it == thumbnails.end()) return;
+    if (thumbnails.count(key)) {
+        destroy_texture(it->second.texture);
+        thumbnails.erase(it);
+        return;
+    }
+    auto node = thumbnails.extract(it);
+    node.key() = key;
+    thumbnails.insert(std::move(node));
+}
+
+std::string TextureCache::KeyFor(const std::string& path, bool hash_now) const {
+    uint64_t hash;
+    if (content && (hash_now ? content->Lookup(path, hash) : content->Peek(path, hash))) {
+        return ContentIndex::Key(hash);
+    }
+    return path;
+}
+
+void TextureCache::AddStoredThumbnail(const std::string& path, ImTextureID texture, int width, int height,
+                                      int full_width, int full_height, bool from_exif) {
+    // A full load may have made one while the lookup was queued
+    std::string key = KeyFor(path, false);
+    if (thumbnails.count(key)) {
+        destroy_texture(texture);
+        return;
+    }
+    if (from_exif) {
+        exif_previews++;
+    } else {
+        stored_previews++;
+    }
+    AddThumbnail(key, texture, width, height, full_width, full_height);
+}
+
+void TextureCache::AddThumbnail(const std::string& key, ImTextureID texture, int width, int height, int full_width, int full_height) {
+    CachedThumbnail& thumbnail = thumbnails[key];
+    if (thumbnail.texture) destroy_texture(thumbnail.texture);
+    thumbnail.texture = texture;
+    thumbnail.width = width;
+    thumbnail.height = height;
+    thumbnail.full_width = full_width;
+    thumbnail.full_height = full_height;
+    thumbnail.last_used = ++use_counter;
+    TrimLeastRecent(thumbnails, max_thumbnails);
+}
+
+void TextureCache::AddPreview(const std::string& path, ImTextureID texture, int width, int height) {
+    CachedThumbnail& preview = midres[path];
+    if (preview.texture) destroy_texture(preview.texture);
+    preview.texture = texture;
+    preview.width = width;
+    preview.height = height;
+    preview.last_used = ++use_counter;
+    stored_midres++;
+    TrimLeastRecent(midres, max_previews);
+}
+
+void TextureCache::TrimLeastRecent(std::unordered_map<std::string, CachedThumbnail>& cached, int max_count) {
+    while ((int)cached.size() > max_count) {
+        auto oldest = cached.begin();
+        for (auto it = cached.begin(); it != cached.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) oldest = it;
+        }
+        destroy_texture(oldest->second.texture);
+        cached.erase(oldest);
+    }
+}
+
+void TextureCache::Clear() {
+    for (auto& [key, entry] : entries) {
+        Free(entry);
+    }
+    entries.clear();
+    acquired.clear();
+
+    for (auto& [path, thumbnail] : thumbnails) {
+        destroy_texture(thumbnail.texture);
+    }
+    thumbnails.clear();
+    pending_thumbnails.clear();
+
+    for (auto& [path, preview] : midres) {
+        destroy_texture(preview.texture);
+    }
+    midres.clear();
+    pending_midres.clear();
+}
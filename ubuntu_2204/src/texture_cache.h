@@ -0,0 +1,160 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Reference counted image textures shared by every viewer
+    All windows share one GL object namespace, so an image shown in several windows
+    is decoded and uploaded once. With a content index, so is an image stored under several names.
+*/
+
+#pragma once
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ContentIndex;
+class DecodedCache;
+class GifDecoder;
+struct IccProfile;
+class PreviewStore;
+class TextureLoader;
+
+
+struct CachedTexture {
+    ImTextureID texture = 0;    // 0 when the file could not be decoded
+    int width = 0;
+    int height = 0;
+    int refs = 0;
+    bool loaded = false;
+    std::string path;           // file the load was started for, the loader's key
+    std::shared_ptr<const IccProfile> icc;     // color profile of the file, nullptr when untagged
+
+    // Animated files once their frames are in, shared by every viewer showing the file. Empty while
+    // loading and for still images.
+    std::vector<ImTextureID> frames;
+    std::vector<int> frame_delays;      // ms
+    bool animation_pending = false;     // frames requested from the loader
+
+    // Animations over the loader's budget stream instead, a few frames decoded ahead of one playback
+    // position, see TextureCache::Animate. frames stays empty.
+    bool streamed = false;
+    int stream_frame = 0;               // frame on screen
+    ImTextureID stream_texture = 0;     // its texture, 0 until the first frame is in. The loader's while it runs.
+    double stream_time = 0.0;           // seconds stream_frame has been on screen
+    bool stream_waiting = false;        // the next frame is due and not decoded yet
+    std::shared_ptr<GifDecoder> stream_decoder;     // without the loader, frames decode on the render thread
+};
+
+// Small preview kept after the full texture is released, shown during fast navigation
+struct CachedThumbnail {
+    ImTextureID texture = 0;
+    int width = 0;
+    int height = 0;
+    int full_width = 0;     // 0 when unknown (preview store, EXIF block without the frame size nearby)
+    int full_height = 0;
+    uint64_t last_used = 0;
+};
+
+
+class TextureCache {
+public:
+    // Textures come from loader while it is running, otherwise files are decoded on the calling thread
+    TextureCache(TextureLoader& loader, DecodedCache& decoded) : loader(loader), decoded(decoded) {}
+    ~TextureCache() { Clear(); }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Texture creation for the synchronous path and deletion, supplied by the app so headless mode works.
+    // label names the texture in the GL resource inspector, the image path.
+    ImTextureID (*create_texture)(const unsigned char* pixels, int width, int height, const std::string& label) = nullptr;
+    void (*destroy_texture)(ImTextureID texture) = nullptr;
+
+    // Persisted thumbnails, read when a file has no thumbnail in memory
+    const PreviewStore* previews = nullptr;
+
+    // Keys textures and thumbnails by file content when set. The render thread only uses hashes
+    // already computed (ContentIndex::HashAhead), a file not hashed yet is keyed by its path
+    // and moves to its content key once the hash lands.
+    ContentIndex* content = nullptr;
+
+    // Adds a reference to path and starts loading it on first use. Balance every Acquire with a Release.
+    void Acquire(const std::string& path);
+    void Release(const std::string& path);
+
+    // Warms the decoded cache with files likely to be shown next, only while the loader runs
+    void Prefetch(const std::vector<std::string>& paths);
+
+    // The entry for an acquired path once loaded, nullptr while the load is in flight
+    const CachedTexture* Find(const std::string& path) const;
+
+    // Thumbnail of any file loaded before, in this run or a previous one when a preview store is set,
+    // else the one embedded in a JPEG's EXIF block. nullptr when there is none. While the loader runs
+    // the store and EXIF lookups happen there, nullptr until the result is in.
+    const CachedThumbnail* FindThumbnail(const std::string& path);
+
+    // Mid-resolution preview from the preview store (written by --prebuild-cache), nullptr when there is
+    // none or, while the loader reads it, not yet. The last max_previews are kept.
+    const CachedThumbnail* FindPreview(const std::string& path);
+
+    // Render thread, once per frame: collects finished loads
+    void Poll();
+
+    // Render thread, once per frame: steps streamed animations by delta_time seconds. A frame not
+    // decoded in time holds the one on screen until it is.
+    void Animate(double delta_time);
+
+    // Frees every texture, needs a context of the share group current
+    void Clear();
+
+    int Size() const { return (int)entries.size(); }
+    int ThumbnailCount() const { return (int)thumbnails.size(); }
+
+    // Least recently used thumbnails and previews are dropped past these counts
+    int max_thumbnails = 256;
+    int max_previews = 4;
+
+    // Stats for the overlay
+    int decodes = 0;        // loads started
+    int shared_hits = 0;    // Acquire calls served by an existing entry
+    int content_shared = 0;     // files served by an entry loaded for another file with the same content
+    int stored_previews = 0;    // thumbnails read back from the preview store
+    int exif_previews = 0;      // thumbnails taken from EXIF blocks
+    int stored_midres = 0;      // mid-resolution previews read back from the preview store
+
+private:
+    struct Acquired {
+        std::string key;
+        int refs = 0;
+    };
+
+    // Content key of path when known (or computed when hash_now), else path
+    std::string KeyFor(const std::string& path, bool hash_now) const;
+    void RekeyHashed();
+    void RekeyThumbnail(const std::string& path, const std::string& key);
+    void LoadAnimation(CachedTexture& entry);
+    ImTextureID StreamFrame(CachedTexture& entry, int frame);
+    void Free(CachedTexture& entry);
+    void AddStoredThumbnail(const std::string& path, ImTextureID texture, int width, int height,
+                            int full_width, int full_height, bool from_exif);
+    void AddThumbnail(const std::string& key, ImTextureID texture, int width, int height, int full_width, int full_height);
+    void AddPreview(const std::string& path, ImTextureID texture, int width, int height);
+    void TrimLeastRecent(std::unordered_map<std::string, CachedThumbnail>& cached, int max_count);
+
+    TextureLoader& loader;
+    DecodedCache& decoded;
+    std::unordered_map<std::string, CachedTexture> entries;         // by key
+    std::unordered_map<std::string, Acquired> acquired;             // by path, the key fixed at the first Acquire
+    std::unordered_map<std::string, CachedThumbnail> thumbnails;    // by key
+    std::unordered_set<std::string> missing_previews;   // store lookups that failed, not retried
+    std::unordered_set<std::string> pending_thumbnails; // store lookups queued on the loader, by path
+    std::unordered_map<std::string, CachedThumbnail> midres;   // mid-resolution previews, by path
+    std::unordered_set<std::string> missing_midres;
+    std::unordered_set<std::string> pending_midres;
+    uint64_t use_counter = 0;
+};
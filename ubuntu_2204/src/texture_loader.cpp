@@ -0,0 +1,511 @@
+#include "texture_loader.h"
+#include "exif_reader.h"
+#include "file_telemetry.h"
+#include "flight_recorder.h"
+#include "gl_resources.h"
+#include "image_files.h"
+#include "image_ops.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <vector>
+
+
+static MetricHistogram& g_upload_seconds = Metrics_Histogram("image_upload_seconds", "Time to upload a full resolution image texture.", Metrics_TimeBuckets());
+
+
+static GLuint UploadTexture(const unsigned char* pixels, int width, int height, const char* site, const std::string& label) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLResource_Track(GLResourceKind::Texture, texture, width, height, (size_t)width * height * 4, site, label);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+static void DeleteTexture(GLuint texture) {
+    if (!texture) return;
+    GLResource_Untrack(GLResourceKind::Texture, texture);
+    glDeleteTextures(1, &texture);
+}
+
+static void DeleteTextures(const LoadedTexture& result) {
+    DeleteTexture(result.texture);
+    DeleteTexture(result.thumbnail);
+}
+
+static void DeleteTextures(const LoadedAnimation& animation) {
+    for (GLuint frame : animation.frames) DeleteTexture(frame);
+}
+
+static bool FenceSignalled(GLExtSync fence) {
+    GLenum status = gl_ext.ClientWaitSync(fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED;
+}
+
+// The flush makes the fence visible to the render context. Without sync objects
+// wait here instead, which only blocks this thread.
+static GLExtSync FenceUploads() {
+    if (gl_ext.has_sync) {
+        GLExtSync fence = gl_ext.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        return fence;
+    }
+    glFinish();
+    return nullptr;
+}
+
+
+bool ReadPreview(const PreviewStore* previews, const std::string& path, int max_side, PreviewPixels& out) {
+    out.full_width = out.full_height = 0;
+    out.from_exif = false;
+    if (previews && previews->Load(path, out.rgba, out.width, out.height, max_side)) return true;
+    // Only JPEG files carry an EXIF block, the other formats would be opened for nothing
+    if (max_side != THUMBNAIL_SIZE || !(EndsWith(path, ".jpg") || EndsWith(path, ".jpeg"))) return false;
+    out.from_exif = Exif_LoadThumbnail(path, out.rgba, out.width, out.height, out.full_width, out.full_height);
+    return out.from_exif;
+}
+
+
+TextureLoader::~TextureLoader() {
+    Stop();
+}
+
+bool TextureLoader::Start(GLFWwindow* main_window) {
+    if (upload_window) return true;
+
+    // Same context hints as the main window are still set, only hide this one
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    upload_window = glfwCreateWindow(1, 1, "texture loader", NULL, main_window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!upload_window) {
+        LOG_WARNING("loader", "Failed to create the texture upload context, loading on the render thread");
+        return false;
+    }
+
+    stopping = false;
+    thread = std::thread(&TextureLoader::ThreadMain, this);
+    return true;
+}
+
+void TextureLoader::Stop() {
+    if (!upload_window) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+
+    glfwDestroyWindow(upload_window);
+    upload_window = nullptr;
+}
+
+void TextureLoader::Request(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!wanted.insert(path).second) return;
+        queue.push_back(path);
+    }
+    wake.notify_one();
+}
+
+void TextureLoader::RequestPreview(const std::string& path, int max_side) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        preview_queue.push_back(PreviewRequest{ path, max_side });
+    }
+    wake.notify_one();
+}
+
+void TextureLoader::RequestAnimation(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!wanted_animations.insert(path).second) return;
+        animation_queue.push_back(path);
+    }
+    wake.notify_one();
+}
+
+void TextureLoader::ReleaseAnimation(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // A stream outlives TakeAnimation, its textures are freed on the loader thread
+    auto stream = streams.find(path);
+    if (stream != streams.end()) {
+        closed_streams.push_back(std::move(stream->second));
+        streams.erase(stream);
+        wake.notify_one();
+    }
+    if (wanted_animations.erase(path) == 0) return;
+
+    animation_queue.erase(std::remove(animation_queue.begin(), animation_queue.end(), path), animation_queue.end());
+    auto it = ready_animations.find(path);
+    if (it != ready_animations.end()) {
+        DeleteTextures(it->second);
+        ready_animations.erase(it);
+    }
+}
+
+void TextureLoader::Prefetch(const std::vector<std::string>& paths) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        prefetch_queue.assign(paths.rbegin(), paths.rend());
+    }
+    wake.notify_one();
+}
+
+void TextureLoader::Release(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (wanted.erase(path) == 0) return;
+
+    queue.erase(std::remove(queue.begin(), queue.end(), path), queue.end());
+    auto it = ready.find(path);
+    if (it != ready.end()) {
+        DeleteTextures(it->second);
+        ready.erase(it);
+    }
+}
+
+void TextureLoader::Poll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < in_flight.size();) {
+        Upload& upload = in_flight[i];
+        if (upload.fence) {
+            if (!FenceSignalled(upload.fence)) {
+                i++;
+                continue;
+            }
+            gl_ext.DeleteSync(upload.fence);
+        }
+
+        if (upload.kind == UploadKind::Preview) {
+            ready_previews.push_back(std::move(upload.preview));
+        } else if (upload.kind == UploadKind::Animation) {
+            // A release and a new request can leave two loads of the same file, the first one wins
+            if (wanted_animations.count(upload.path) && !ready_animations.count(upload.path)) {
+                ready_animations[upload.path] = std::move(upload.animation);
+            } else {
+                DeleteTextures(upload.animation);
+            }
+        } else if (wanted.count(upload.path) && !ready.count(upload.path)) {
+            // Same rule as the frames: a release and a new request while decoding leave two loads
+            ready[upload.path] = upload.result;
+        } else {
+            DeleteTextures(upload.result);
+        }
+        if (i + 1 < in_flight.size()) in_flight[i] = std::move(in_flight.back());
+        in_flight.pop_back();
+    }
+}
+
+bool TextureLoader::Take(const std::string& path, LoadedTexture& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ready.find(path);
+    if (it == ready.end()) return false;
+
+    out = it->second;
+    ready.erase(it);
+    wanted.erase(path);
+    return true;
+}
+
+void TextureLoader::TakePreviews(std::vector<LoadedPreview>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.insert(out.end(), std::make_move_iterator(ready_previews.begin()), std::make_move_iterator(ready_previews.end()));
+    ready_previews.clear();
+}
+
+bool TextureLoader::TakeAnimation(const std::string& path, LoadedAnimation& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ready_animations.find(path);
+    if (it == ready_animations.end()) return false;
+
+    out = std::move(it->second);
+    ready_animations.erase(it);
+    wanted_animations.erase(path);
+    return true;
+}
+
+GLuint TextureLoader::StreamFrame(const std::string& path, int frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(path);
+    if (it == streams.end()) return 0;
+
+    Stream& stream = *it->second;
+    int slot = stream.ring.Find(frame);
+    if (slot < 0) return 0;
+    GLExtSync& fence = stream.fences[slot];
+    if (fence) {
+        if (!FenceSignalled(fence)) return 0;
+        gl_ext.DeleteSync(fence);
+        fence = nullptr;
+    }
+    // The frames played so far leave the ring, their slots take the next ones
+    stream.ring.Show(frame);
+    wake.notify_one();
+    return stream.textures[slot];
+}
+
+void TextureLoader::LoadPreview(const PreviewRequest& request) {
+    TRACE_ZONE("Stored preview");
+    Upload upload;
+    upload.kind = UploadKind::Preview;
+    upload.path = request.path;
+    LoadedPreview& preview = upload.preview;
+    preview.path = request.path;
+    preview.max_side = request.max_side;
+
+    PreviewPixels pixels;
+    if (ReadPreview(previews, request.path, request.max_side, pixels)) {
+        preview.texture = UploadTexture(pixels.rgba.data(), pixels.width, pixels.height, GL_SITE, request.path);
+        preview.width = pixels.width;
+        preview.height = pixels.height;
+        preview.full_width = pixels.full_width;
+        preview.full_height = pixels.full_height;
+        preview.from_exif = pixels.from_exif;
+        upload.fence = FenceUploads();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    in_flight.push_back(std::move(upload));
+}
+
+void TextureLoader::LoadAnimation(const std::string& path) {
+    Upload upload;
+    upload.kind = UploadKind::Animation;
+    upload.path = path;
+
+    // Every frame becomes a texture, the render thread then only picks one per frame. Over the budget
+    // the decoder is kept instead and fills a ring of stream_frames textures ahead of playback.
+    auto stream = std::make_shared<Stream>();
+    GifFrames frames;
+    if (!stream->decoder.Open(path)) {
+        stream = nullptr;
+    } else if (Gif_LoadFrames(stream->decoder, animation_budget, frames)) {
+        TRACE_ZONE("Upload frames");
+        GpuZone gpu_zone(&gpu_timer, "Animation frames");
+        for (int i = 0; i < frames.FrameCount(); i++) {
+            upload.animation.frames.push_back(UploadTexture(frames.Frame(i), frames.width, frames.height, GL_SITE, path));
+        }
+        upload.animation.delays_ms = std::move(frames.delays_ms);
+        upload.fence = FenceUploads();
+        stream = nullptr;
+    } else if (stream->decoder.FramesSize() > animation_budget) {
+        int frame_count = stream->decoder.FrameCount();
+        int slot_count = std::min(std::max(stream_frames, 2), frame_count);
+        stream->ring = GifRing(frame_count, slot_count);
+        stream->textures.assign(slot_count, 0);
+        stream->fences.assign(slot_count, nullptr);
+        upload.animation.delays_ms = stream->decoder.DelaysMs();
+        upload.animation.streamed = true;
+    } else {
+        stream = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Filling starts now so the first frames are in when the render thread takes the animation.
+    // A stream of a released request is never registered, one of a newer request may be already.
+    if (stream && wanted_animations.count(path) && !streams.count(path)) {
+        streams[path] = std::move(stream);
+    }
+    in_flight.push_back(std::move(upload));
+}
+
+std::shared_ptr<TextureLoader::Stream> TextureLoader::StreamToFill(int& slot, int& frame) {
+    for (auto& entry : streams) {
+        if (!entry.second->failed && entry.second->ring.Reserve(slot, frame)) return entry.second;
+    }
+    return nullptr;
+}
+
+void TextureLoader::FillStream(Stream& stream, int slot, int frame) {
+    TRACE_ZONE("Stream frame");
+    // Frames decode in playback order, the one reserved is always the decoder's next
+    GifDecoder& decoder = stream.decoder;
+    bool decoded = decoder.Next() && decoder.FrameIndex() == frame;
+    GLuint texture = 0;
+    GLExtSync fence = nullptr;
+    if (decoded) {
+        GpuZone gpu_zone(&gpu_timer, "Stream frame");
+        texture = UploadTexture(decoder.Canvas(), decoder.Width(), decoder.Height(), GL_SITE, decoder.Path());
+        fence = FenceUploads();
+        animation_stats.frames_streamed++;
+    } else {
+        LOG_ERROR("gif", "Failed to decode frame %d of %s, playback stops there", frame, decoder.Path().c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!decoded) {
+        stream.failed = true;
+        return;
+    }
+    // The frame the slot held has been played, the render thread moved on from its texture
+    DeleteTexture(stream.textures[slot]);
+    if (stream.fences[slot]) gl_ext.DeleteSync(stream.fences[slot]);
+    stream.textures[slot] = texture;
+    stream.fences[slot] = fence;
+    stream.ring.Push();
+}
+
+void TextureLoader::Stream::Free() {
+    for (GLuint texture : textures) DeleteTexture(texture);
+    for (GLExtSync fence : fences) {
+        if (fence) gl_ext.DeleteSync(fence);
+    }
+    textures.clear();
+    fences.clear();
+}
+
+void TextureLoader::ThreadMain() {
+    glfwMakeContextCurrent(upload_window);
+    FlightRecorder_SetThreadName("loader");
+    gpu_timer.Init("GPU loader");
+
+    std::vector<unsigned char> thumbnail_pixels;
+    for (;;) {
+        std::string path;
+        bool prefetch = false;
+        int slot = 0;
+        int frame = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] {
+                return stopping || !preview_queue.empty() || !queue.empty() || !animation_queue.empty() ||
+                       !closed_streams.empty() || StreamToFill(slot, frame) || !prefetch_queue.empty();
+            });
+            if (stopping) break;
+
+            if (!closed_streams.empty()) {
+                std::vector<std::shared_ptr<Stream>> closed = std::move(closed_streams);
+                closed_streams.clear();
+                lock.unlock();
+                for (auto& stream : closed) stream->Free();
+                continue;
+            }
+
+            // Previews are a small file read each and stand in while the user flicks through files
+            if (!preview_queue.empty()) {
+                PreviewRequest request = std::move(preview_queue.back());
+                preview_queue.pop_back();
+                lock.unlock();
+                LoadPreview(request);
+                continue;
+            }
+            // Animations play once their first frame is up, so the frames wait for the images
+            if (queue.empty() && !animation_queue.empty()) {
+                path = std::move(animation_queue.back());
+                animation_queue.pop_back();
+                lock.unlock();
+                FlightRecorder_Annotate("loader frames", path);
+                gpu_timer.BeginFrame();
+                LoadAnimation(path);
+                continue;
+            }
+            // Streamed frames are due on playback's clock, ahead of any prefetch
+            if (queue.empty()) {
+                if (std::shared_ptr<Stream> stream = StreamToFill(slot, frame)) {
+                    lock.unlock();
+                    gpu_timer.BeginFrame();
+                    FillStream(*stream, slot, frame);
+                    continue;
+                }
+            }
+            std::vector<std::string>& source = queue.empty() ? prefetch_queue : queue;
+            prefetch = &source == &prefetch_queue;
+            path = std::move(source.back());
+            source.pop_back();
+        }
+
+        FlightRecorder_Annotate(prefetch ? "loader prefetch" : "loader decode", path);
+        gpu_timer.BeginFrame();
+        if (prefetch) {
+            if (!decoded.Contains(path)) decoded.Load(path);
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Upload upload;
+        upload.path = path;
+
+        if (std::shared_ptr<const DecodedImage> image = decoded.Load(path)) {
+            LoadedTexture& result = upload.result;
+            result.width = image->width;
+            result.height = image->height;
+            result.icc = image->icc;
+            TRACE_ZONE("Upload");
+            auto upload_start = std::chrono::steady_clock::now();
+            {
+                GpuZone gpu_zone(&gpu_timer, "Upload");
+                result.texture = UploadTexture(image->pixels, result.width, result.height, GL_SITE, path);
+            }
+            double upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count();
+
+            FitInside(result.width, result.height, THUMBNAIL_SIZE, result.thumbnail_width, result.thumbnail_height);
+            thumbnail_pixels.resize((size_t)result.thumbnail_width * result.thumbnail_height * 4);
+            DownscaleBox(image->pixels, result.width, result.height, thumbnail_pixels.data(), result.thumbnail_width, result.thumbnail_height);
+            result.thumbnail = UploadTexture(thumbnail_pixels.data(), result.thumbnail_width, result.thumbnail_height, GL_SITE, path);
+            g_upload_seconds.Observe(upload_ms / 1000.0);
+            if (decoded.telemetry) {
+                decoded.telemetry->RecordUpload(path, upload_ms);
+            }
+            if (previews) {
+                previews->Save(path, thumbnail_pixels.data(), result.thumbnail_width, result.thumbnail_height);
+            }
+
+            upload.fence = FenceUploads();
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight.push_back(std::move(upload));
+        uploads++;
+        last_upload_ms = ms;
+    }
+
+    // Nothing handed out yet outlives the loader
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Upload& upload : in_flight) {
+        if (upload.fence) gl_ext.DeleteSync(upload.fence);
+        DeleteTextures(upload.result);
+        DeleteTexture(upload.preview.texture);
+        DeleteTextures(upload.animation);
+    }
+    for (auto& entry : ready) {
+        DeleteTextures(entry.second);
+    }
+    for (LoadedPreview& preview : ready_previews) {
+        DeleteTexture(preview.texture);
+    }
+    for (auto& entry : ready_animations) {
+        DeleteTextures(entry.second);
+    }
+    for (auto& entry : streams) {
+        entry.second->Free();
+    }
+    for (auto& stream : closed_streams) {
+        stream->Free();
+    }
+    in_flight.clear();
+    ready.clear();
+    ready_previews.clear();
+    ready_animations.clear();
+    streams.clear();
+    closed_streams.clear();
+    preview_queue.clear();
+    queue.clear();
+    animation_queue.clear();
+    wanted_animations.clear();
+    prefetch_queue.clear();
+    wanted.clear();
+    gpu_timer.Release();
+    glFinish();
+    glfwMakeContextCurrent(NULL);
+}
@@ -0,0 +1,199 @@
+// ---------------------------------------------
+// ---------------------------------------------
+/*
+    Background image loader
+    Decodes and uploads on its own thread through a hidden window whose context shares
+    objects with the main one. A texture is handed to the UI only once the fence placed
+    after its upload has signalled, so the render thread never waits on a transfer.
+    Stored thumbnails and previews are read and uploaded there as well, and so are the frames of
+    animated files. Animations over the frame budget stream: a few frames ahead of playback are kept
+    as textures and refilled as the render thread moves past them.
+*/
+
+#pragma once
+
+#include "decoded_cache.h"
+#include "gif_animation.h"
+#include "gl_ext.h"
+#include "gpu_timer.h"
+#include "preview_store.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+struct LoadedTexture {
+    GLuint texture = 0;     // 0 when the file could not be decoded
+    int width = 0;
+    int height = 0;
+    GLuint thumbnail = 0;   // THUMBNAIL_SIZE preview, uploaded with the full image
+    int thumbnail_width = 0;
+    int thumbnail_height = 0;
+    std::shared_ptr<const IccProfile> icc;
+};
+
+// Stored preview read on the loader thread, see TextureLoader::RequestPreview
+struct LoadedPreview {
+    std::string path;
+    int max_side = 0;
+    GLuint texture = 0;     // 0 when the file has none
+    int width = 0;
+    int height = 0;
+    int full_width = 0;     // size of the image itself when the EXIF block gives it, else 0
+    int full_height = 0;
+    bool from_exif = false;
+};
+
+// Frames of an animated file, see TextureLoader::RequestAnimation
+struct LoadedAnimation {
+    std::vector<GLuint> frames;     // empty when the file is not animated or streamed
+    std::vector<int> delays_ms;
+    bool streamed = false;          // over the budget, frames come from StreamFrame
+};
+
+// Pixels behind a LoadedPreview
+struct PreviewPixels {
+    std::vector<unsigned char> rgba;
+    int width = 0;
+    int height = 0;
+    int full_width = 0;
+    int full_height = 0;
+    bool from_exif = false;
+};
+
+// The preview of path at max_side from previews (may be nullptr). A thumbnail missing there is taken
+// from the EXIF block of a camera JPEG (.jpg, .jpeg). Safe on any thread.
+bool ReadPreview(const PreviewStore* previews, const std::string& path, int max_side, PreviewPixels& out);
+
+
+class TextureLoader {
+public:
+    // Decoded pixels go through decoded, so revisits and prefetched files skip the decode
+    explicit TextureLoader(DecodedCache& decoded) : decoded(decoded) {}
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // Creates the upload context sharing main_window's objects and starts the thread.
+    // Call on the main thread with GLExt_Load() done. False when the context cannot be created.
+    bool Start(GLFWwindow* main_window);
+
+    // Joins the thread and frees anything not handed out yet, call before the main window is destroyed
+    void Stop();
+
+    bool Running() const { return upload_window != nullptr; }
+
+    // Queues path unless it is wanted already (requested and neither released nor taken).
+    // The newest request is served first.
+    void Request(const std::string& path);
+
+    // Queues a ReadPreview of path, served before any image. Every request is answered through
+    // TakePreviews, with no texture when there is no preview.
+    void RequestPreview(const std::string& path, int max_side = THUMBNAIL_SIZE);
+
+    // Queues the frames of an animated file, decoded and uploaded once no image request waits.
+    // Balance with ReleaseAnimation unless TakeAnimation has handed them over.
+    void RequestAnimation(const std::string& path);
+    void ReleaseAnimation(const std::string& path);
+
+    // Replaces the files to decode into the decoded cache while no request is waiting, nothing is uploaded
+    void Prefetch(const std::vector<std::string>& paths);
+
+    // Drops interest in path: a queued request is cancelled, a finished texture is deleted
+    // and one still in flight is deleted as soon as its fence signals
+    void Release(const std::string& path);
+
+    // Render thread, once per frame: moves uploads whose fence has signalled to the ready set
+    void Poll();
+
+    // Hands over the texture for path once it is ready, the caller then owns it
+    bool Take(const std::string& path, LoadedTexture& out);
+
+    // Hands over every preview whose fence has signalled, the caller then owns their textures
+    void TakePreviews(std::vector<LoadedPreview>& out);
+
+    // Hands over the frames of path once they are ready, the caller then owns them
+    bool TakeAnimation(const std::string& path, LoadedAnimation& out);
+
+    // Render thread: the texture of frame in the stream of path once it is decoded and uploaded, else 0.
+    // Asking for a frame frees the ones before it, so frames are asked in playback order and a texture
+    // returned stays valid until the next frame is returned. The loader owns the textures, which go
+    // with ReleaseAnimation.
+    GLuint StreamFrame(const std::string& path, int frame);
+
+    // Thumbnails made here are also persisted when set
+    const PreviewStore* previews = nullptr;
+
+    // Composited frames an animation may hold, longer animations stream stream_frames frames at a time
+    size_t animation_budget = 64u << 20;
+    int stream_frames = 4;
+
+    // Stats for the overlay, decode + upload time on the loader thread
+    std::atomic<int> uploads{0};
+    std::atomic<double> last_upload_ms{0.0};
+
+    // GPU time of the uploads, on the loader's context
+    GpuTimer gpu_timer;
+
+private:
+    enum class UploadKind { Image, Preview, Animation };
+
+    struct Upload {
+        UploadKind kind = UploadKind::Image;
+        std::string path;
+        LoadedTexture result;
+        LoadedPreview preview;
+        LoadedAnimation animation;
+        GLExtSync fence = nullptr;
+    };
+
+    struct PreviewRequest {
+        std::string path;
+        int max_side;
+    };
+
+    // An animation over the budget, decoded here into the frame textures of the ring's slots
+    struct Stream {
+        GifDecoder decoder;             // loader thread only
+        GifRing ring;
+        std::vector<GLuint> textures;   // by slot
+        std::vector<GLExtSync> fences;  // by slot, until the render thread sees the upload done
+        bool failed = false;            // a frame did not decode, playback stays where it is
+
+        void Free();
+    };
+
+    void ThreadMain();
+    void LoadPreview(const PreviewRequest& request);
+    void LoadAnimation(const std::string& path);
+    std::shared_ptr<Stream> StreamToFill(int& slot, int& frame);
+    void FillStream(Stream& stream, int slot, int frame);
+
+    DecodedCache& decoded;
+    GLFWwindow* upload_window = nullptr;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<PreviewRequest> preview_queue;                  // served from the back, before queue
+    std::vector<std::string> queue;                             // requests, served from the back
+    std::vector<std::string> animation_queue;                   // served from the back when queue is empty
+    std::vector<std::string> prefetch_queue;                    // served from the back when queue is empty
+    std::unordered_set<std::string> wanted;                     // requested and not released
+    std::unordered_set<std::string> wanted_animations;
+    std::vector<Upload> in_flight;                              // uploaded, fence pending
+    std::unordered_map<std::string, LoadedTexture> ready;       // fence signalled, waiting for Take()
+    std::vector<LoadedPreview> ready_previews;                  // fence signalled, waiting for TakePreviews()
+    std::unordered_map<std::string, LoadedAnimation> ready_animations;  // fence signalled, waiting for TakeAnimation()
+    std::unordered_map<std::string, std::shared_ptr<Stream>> streams;   // by path, until ReleaseAnimation()
+    std::vector<std::shared_ptr<Stream>> closed_streams;                // released, textures freed here
+};
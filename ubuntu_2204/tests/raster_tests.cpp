@@ -0,0 +1,315 @@
+// Unit tests of the CPU rasterizer, no window or GL context needed: hand-built ImDrawData is rendered
+// and the pixels read back. Covers the top-left fill rule, scissor clipping, the constant-UV fold
+// and the SSE2 path against the scalar one.
+//
+//   imgui_app_raster_tests [name filter]
+//
+// Registered with ctest, a failed check prints its expression and the run exits with 1.
+
+#include "soft_rasterizer.h"
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+static int g_failures = 0;
+
+static bool Check(bool ok, const char* expression, const char* file, int line) {
+    if (!ok) {
+        printf("  %s:%d: check failed: %s\n", file, line, expression);
+        g_failures++;
+    }
+    return ok;
+}
+
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+static const ImVec4 CLEAR_COLOR(0.0f, 0.0f, 0.0f, 1.0f);
+static const ImU32 CLEAR_PIXEL = IM_COL32(0, 0, 0, 255);
+
+// One draw list and the ImDrawData around it, laid out the way ImGui::Render() leaves them
+struct TestFrame {
+    ImDrawList list{ nullptr };
+    ImDrawData data;
+
+    TestFrame(int width, int height, ImVec2 display_pos = ImVec2(0.0f, 0.0f)) {
+        data.Valid = true;
+        data.DisplayPos = display_pos;
+        data.DisplaySize = ImVec2((float)width, (float)height);
+        data.FramebufferScale = ImVec2(1.0f, 1.0f);
+        data.CmdLists.push_back(&list);
+        data.CmdListsCount = 1;
+    }
+
+    TestFrame(const TestFrame&) = delete;
+    TestFrame& operator=(const TestFrame&) = delete;
+
+    // Following triangles are clipped to clip_rect (display coordinates) and sample texture
+    void Command(const ImVec4& clip_rect, ImTextureID texture = 0) {
+        ImDrawCmd cmd = ImDrawCmd();
+        cmd.ClipRect = clip_rect;
+#if IMGUI_VERSION_NUM >= 19200
+        cmd.TexRef = ImTextureRef(texture);
+#else
+        cmd.TextureId = texture;
+#endif
+        cmd.IdxOffset = (unsigned int)list.IdxBuffer.Size;
+        list.CmdBuffer.push_back(cmd);
+    }
+
+    void Triangle(ImVec2 a, ImVec2 b, ImVec2 c, ImU32 col_a, ImU32 col_b, ImU32 col_c,
+                  ImVec2 uv_a = ImVec2(0.0f, 0.0f), ImVec2 uv_b = ImVec2(0.0f, 0.0f), ImVec2 uv_c = ImVec2(0.0f, 0.0f)) {
+        if (list.CmdBuffer.Size == 0) Command(ImVec4(-1e6f, -1e6f, 1e6f, 1e6f));
+        ImDrawIdx base = (ImDrawIdx)list.VtxBuffer.Size;
+        ImDrawVert vertex;
+        vertex.pos = a; vertex.uv = uv_a; vertex.col = col_a; list.VtxBuffer.push_back(vertex);
+        vertex.pos = b; vertex.uv = uv_b; vertex.col = col_b; list.VtxBuffer.push_back(vertex);
+        vertex.pos = c; vertex.uv = uv_c; vertex.col = col_c; list.VtxBuffer.push_back(vertex);
+        for (int k = 0; k < 3; k++) list.IdxBuffer.push_back((ImDrawIdx)(base + k));
+        list.CmdBuffer.back().ElemCount += 3;
+        data.TotalVtxCount += 3;
+        data.TotalIdxCount += 3;
+    }
+
+    // Two triangles sharing the diagonal from min to max, like ImDrawList::PrimRectUV
+    void Quad(ImVec2 min, ImVec2 max, ImU32 col, ImVec2 uv_min = ImVec2(0.0f, 0.0f), ImVec2 uv_max = ImVec2(0.0f, 0.0f)) {
+        Triangle(min, ImVec2(max.x, min.y), max, col, col, col, uv_min, ImVec2(uv_max.x, uv_min.y), uv_max);
+        Triangle(min, max, ImVec2(min.x, max.y), col, col, col, uv_min, uv_max, ImVec2(uv_min.x, uv_max.y));
+    }
+};
+
+static ImU32 Pixel(const SoftFramebuffer& target, int x, int y) {
+    return target.pixels[(size_t)y * target.stride + x];
+}
+
+static bool SamePixels(const SoftFramebuffer& a, const SoftFramebuffer& b) {
+    if (a.width != b.width || a.height != b.height) return false;
+    for (int y = 0; y < a.height; y++) {
+        if (memcmp(&a.pixels[(size_t)y * a.stride], &b.pixels[(size_t)y * b.stride], (size_t)a.width * sizeof(ImU32)) != 0) return false;
+    }
+    return true;
+}
+
+// Pixels in [x0, x1) x [y0, y1) equal to inside, every other pixel equal to outside
+static bool RegionIs(const SoftFramebuffer& target, int x0, int y0, int x1, int y1, ImU32 inside, ImU32 outside) {
+    for (int y = 0; y < target.height; y++) {
+        for (int x = 0; x < target.width; x++) {
+            bool in = x >= x0 && x < x1 && y >= y0 && y < y1;
+            if (Pixel(target, x, y) != (in ? inside : outside)) {
+                printf("  pixel %d,%d is %08x\n", x, y, Pixel(target, x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void Render(SoftRasterizer& rasterizer, TestFrame& frame, SoftFramebuffer& target, bool simd) {
+    rasterizer.simd = simd;
+    rasterizer.Render(&frame.data, target, CLEAR_COLOR);
+}
+
+
+// ---------------------------------------------
+// ---------------------------------------------
+// Tests
+
+// Translucent geometry whose shared edges pass through pixel centers: a double blend or a gap shows
+// as a pixel off the single-blend color
+static void Test_TopLeftSharedEdge() {
+    const ImU32 color = IM_COL32(255, 0, 0, 128);
+    const ImU32 once = IM_COL32(128, 0, 0, 255);    // color blended once over CLEAR_PIXEL
+
+    // Quad split on its diagonal, the diagonal runs through the center of every (i, i) pixel
+    {
+        TestFrame frame(96, 80);
+        frame.Quad(ImVec2(4.0f, 4.0f), ImVec2(76.0f, 76.0f), color);
+        SoftRasterizer rasterizer(1);
+        SoftFramebuffer target;
+        for (bool simd : { false, true }) {
+            Render(rasterizer, frame, target, simd);
+            CHECK(RegionIs(target, 4, 4, 76, 76, once, CLEAR_PIXEL));
+        }
+    }
+
+    // Vertical and horizontal edges on pixel centers (x = 10.5, y = 20.5): the pixels on them belong to
+    // the quad whose left or top edge it is. So do those on the outer left and top edges, not those on
+    // the right and bottom ones.
+    {
+        TestFrame frame(32, 32);
+        frame.Quad(ImVec2(2.5f, 2.5f), ImVec2(10.5f, 20.5f), color);
+        frame.Quad(ImVec2(10.5f, 2.5f), ImVec2(27.5f, 20.5f), color);
+        frame.Quad(ImVec2(2.5f, 20.5f), ImVec2(27.5f, 30.5f), color);
+        SoftRasterizer rasterizer(1);
+        SoftFramebuffer target;
+        for (bool simd : { false, true }) {
+            Render(rasterizer, frame, target, simd);
+            CHECK(RegionIs(target, 2, 2, 27, 30, once, CLEAR_PIXEL));
+        }
+    }
+
+    // Fan of eight triangles around a pixel center, each spoke is shared by two of them
+    {
+        TestFrame frame(40, 40);
+        const ImVec2 center(16.5f, 16.5f);
+        const ImVec2 rim[8] = {
+            ImVec2(4.5f, 4.5f), ImVec2(16.5f, 4.5f), ImVec2(28.5f, 4.5f), ImVec2(28.5f, 16.5f),
+            ImVec2(28.5f, 28.5f), ImVec2(16.5f, 28.5f), ImVec2(4.5f, 28.5f), ImVec2(4.5f, 16.5f),
+        };
+        for (int i = 0; i < 8; i++) frame.Triangle(center, rim[i], rim[(i + 1) % 8], color, color, color);
+        SoftRasterizer rasterizer(1);
+        SoftFramebuffer target;
+        for (bool simd : { false, true }) {
+            Render(rasterizer, frame, target, simd);
+            CHECK(RegionIs(target, 4, 4, 28, 28, once, CLEAR_PIXEL));
+        }
+    }
+}
+
+// Clip rects are in display coordinates, DisplayPos is subtracted before they become pixel bounds
+static void Test_ScissorClip() {
+    const ImU32 color = IM_COL32(40, 200, 90, 255);
+    const ImVec2 origin(100.0f, 50.0f);
+    TestFrame frame(150, 100, origin);
+
+    // Crosses the tile boundary at x = 64
+    frame.Command(ImVec4(origin.x + 50.0f, origin.y + 10.0f, origin.x + 90.0f, origin.y + 37.0f));
+    frame.Quad(origin, ImVec2(origin.x + 150.0f, origin.y + 100.0f), color);
+
+    // Entirely outside the framebuffer, and empty
+    frame.Command(ImVec4(origin.x + 160.0f, origin.y, origin.x + 200.0f, origin.y + 100.0f));
+    frame.Quad(origin, ImVec2(origin.x + 300.0f, origin.y + 100.0f), color);
+    frame.Command(ImVec4(origin.x + 20.0f, origin.y + 20.0f, origin.x + 20.0f, origin.y + 80.0f));
+    frame.Quad(origin, ImVec2(origin.x + 150.0f, origin.y + 100.0f), color);
+
+    for (int threads : { 1, 4 }) {
+        SoftRasterizer rasterizer(threads);
+        SoftFramebuffer target;
+        for (bool simd : { false, true }) {
+            Render(rasterizer, frame, target, simd);
+            CHECK(target.width == 150 && target.height == 100);
+            CHECK(RegionIs(target, 50, 10, 90, 37, color, CLEAR_PIXEL));
+        }
+    }
+}
+
+// Constant UVs fold the texel into the vertex colors at setup, which must match sampling the same
+// texel per pixel
+static void Test_ConstantUVFold() {
+    std::vector<unsigned char> atlas(4 * 4 * 4);
+    for (int i = 0; i < 16; i++) {
+        atlas[i * 4 + 0] = (unsigned char)(i * 16);
+        atlas[i * 4 + 1] = (unsigned char)(255 - i * 9);
+        atlas[i * 4 + 2] = (unsigned char)(i * 5 + 30);
+        atlas[i * 4 + 3] = (unsigned char)(i * 12 + 60);
+    }
+    const int texel_x = 1, texel_y = 2;
+    const unsigned char* texel = &atlas[(texel_y * 4 + texel_x) * 4];
+    std::vector<unsigned char> uniform(8 * 8 * 4);
+    for (size_t i = 0; i < uniform.size(); i += 4) memcpy(&uniform[i], texel, 4);
+
+    SoftRasterizer rasterizer(1);
+    ImTextureID atlas_id = rasterizer.CreateTexture(atlas.data(), 4, 4);
+    ImTextureID uniform_id = rasterizer.CreateTexture(uniform.data(), 8, 8);
+    const ImVec2 texel_uv((texel_x + 0.5f) / 4.0f, (texel_y + 0.5f) / 4.0f);
+    const ImU32 colors[] = { IM_COL32_WHITE, IM_COL32(200, 150, 100, 180), IM_COL32(13, 250, 77, 64) };
+
+    for (ImU32 color : colors) {
+        TestFrame folded(64, 48);
+        folded.Command(ImVec4(0.0f, 0.0f, 64.0f, 48.0f), atlas_id);
+        folded.Quad(ImVec2(3.0f, 5.0f), ImVec2(45.0f, 40.0f), color, texel_uv, texel_uv);
+
+        TestFrame textured(64, 48);
+        textured.Command(ImVec4(0.0f, 0.0f, 64.0f, 48.0f), uniform_id);
+        textured.Quad(ImVec2(3.0f, 5.0f), ImVec2(45.0f, 40.0f), color, ImVec2(0.0f, 0.0f), ImVec2(1.0f, 1.0f));
+
+        SoftFramebuffer folded_target, textured_target;
+        for (bool simd : { false, true }) {
+            Render(rasterizer, folded, folded_target, simd);
+            Render(rasterizer, textured, textured_target, simd);
+            CHECK(SamePixels(folded_target, textured_target));
+            CHECK(Pixel(folded_target, 20, 20) != CLEAR_PIXEL);
+            CHECK(Pixel(folded_target, 50, 20) == CLEAR_PIXEL);
+        }
+    }
+    rasterizer.DestroyTexture(atlas_id);
+    rasterizer.DestroyTexture(uniform_id);
+}
+
+// Random overlapping triangles, gradients, textured and folded, several clip rects, a width that is
+// not a multiple of 4: the SSE2 spans and any thread count give the scalar path's bytes
+static void Test_SimdMatchesScalar() {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto next = [&state](int range) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (int)((state >> 33) % (uint64_t)range);
+    };
+
+    std::vector<unsigned char> pixels(16 * 16 * 4);
+    for (unsigned char& byte : pixels) byte = (unsigned char)next(256);
+
+    const int width = 203, height = 150;
+    SoftRasterizer scalar(1);
+    ImTextureID texture = scalar.CreateTexture(pixels.data(), 16, 16);
+
+    TestFrame frame(width, height);
+    for (int c = 0; c < 6; c++) {
+        float x0 = (float)next(width / 2), y0 = (float)next(height / 2);
+        frame.Command(ImVec4(x0, y0, x0 + 40.0f + next(width), y0 + 30.0f + next(height)), c % 2 ? texture : 0);
+        for (int t = 0; t < 40; t++) {
+            // Eighth-pixel positions, some past the framebuffer edges
+            auto position = [&] { return ImVec2((next(width * 8 + 160) - 80) / 8.0f, (next(height * 8 + 160) - 80) / 8.0f); };
+            auto color = [&] { return IM_COL32(next(256), next(256), next(256), next(256)); };
+            auto uv = [&] { return ImVec2(next(1024) / 1024.0f, next(1024) / 1024.0f); };
+            if (t % 4 == 0) {
+                ImVec2 constant = uv();
+                frame.Triangle(position(), position(), position(), color(), color(), color(), constant, constant, constant);
+            } else {
+                frame.Triangle(position(), position(), position(), color(), color(), color(), uv(), uv(), uv());
+            }
+        }
+    }
+
+    SoftFramebuffer expected;
+    Render(scalar, frame, expected, false);
+    CHECK(scalar.last_triangle_count > 100);
+
+    SoftFramebuffer target;
+    Render(scalar, frame, target, true);
+    CHECK(SamePixels(expected, target));
+
+    SoftRasterizer threaded(4);
+    threaded.AliasTexture(texture, pixels.data(), 16, 16);
+    for (bool simd : { false, true }) {
+        Render(threaded, frame, target, simd);
+        CHECK(SamePixels(expected, target));
+    }
+    scalar.DestroyTexture(texture);
+}
+
+
+int main(int argc, char** argv) {
+    static const struct { const char* name; void (*run)(); } tests[] = {
+        { "top_left_shared_edge", Test_TopLeftSharedEdge },
+        { "scissor_clip", Test_ScissorClip },
+        { "constant_uv_fold", Test_ConstantUVFold },
+        { "simd_matches_scalar", Test_SimdMatchesScalar },
+    };
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int failed_tests = 0, run = 0;
+    for (const auto& test : tests) {
+        if (filter && !strstr(test.name, filter)) continue;
+        int failures = g_failures;
+        test.run();
+        run++;
+        bool passed = g_failures == failures;
+        if (!passed) failed_tests++;
+        printf("%-32s %s\n", test.name, passed ? "ok" : "FAILED");
+    }
+    printf("%d of %d tests passed\n", run - failed_tests, run);
+    return failed_tests ? 1 : 0;
+}